@@ -36,6 +36,7 @@ if test "$PHP_XDEBUG" != "no"; then
   AC_CHECK_HEADERS([netinet/in.h poll.h sys/poll.h])
   case $host_os in
   linux*)
+    AC_CHECK_HEADERS([linux/perf_event.h])
     AC_CHECK_HEADERS([linux/rtnetlink.h], [], [
       case $host_os in
         linux-musl*)
@@ -47,6 +48,10 @@ if test "$PHP_XDEBUG" != "no"; then
 
   PHP_CHECK_FUNC(res_ninit, resolv)
   PHP_CHECK_FUNC(res_nclose, resolv)
+  AC_CHECK_FUNCS([sigtimedwait])
+
+  AC_SEARCH_LIBS([timer_create], [rt], [AC_DEFINE(HAVE_XDEBUG_TIMER_CREATE,1,[ ])])
+  AC_SEARCH_LIBS([pthread_create], [pthread], [AC_DEFINE(HAVE_XDEBUG_PTHREADS,1,[ ])])
 
   PHP_CHECK_LIBRARY(m, cos, [ PHP_ADD_LIBRARY(m,, XDEBUG_SHARED_LIBADD) ])
 
@@ -106,15 +111,15 @@ if test "$PHP_XDEBUG" != "no"; then
 
   PHP_XDEBUG_CFLAGS="$STD_CFLAGS $MAINTAINER_CFLAGS"
 
-  XDEBUG_BASE_SOURCES="src/base/base.c src/base/filter.c"
-  XDEBUG_LIB_SOURCES="src/lib/usefulstuff.c src/lib/compat.c src/lib/crc32.c src/lib/file.c src/lib/hash.c src/lib/headers.c src/lib/lib.c src/lib/llist.c src/lib/log.c src/lib/set.c src/lib/str.c src/lib/timing.c src/lib/var.c src/lib/var_export_html.c src/lib/var_export_line.c src/lib/var_export_text.c src/lib/var_export_xml.c src/lib/xml.c"
+  XDEBUG_BASE_SOURCES="src/base/base.c src/base/filter.c src/base/function_identity.c"
+  XDEBUG_LIB_SOURCES="src/lib/usefulstuff.c src/lib/arena.c src/lib/async_writer.c src/lib/compat.c src/lib/crc32.c src/lib/file.c src/lib/hash.c src/lib/headers.c src/lib/lib.c src/lib/llist.c src/lib/log.c src/lib/set.c src/lib/sink.c src/lib/str.c src/lib/timing.c src/lib/var.c src/lib/var_export_html.c src/lib/var_export_line.c src/lib/var_export_text.c src/lib/var_export_xml.c src/lib/xml.c"
 
-  XDEBUG_COVERAGE_SOURCES="src/coverage/branch_info.c src/coverage/code_coverage.c"
+  XDEBUG_COVERAGE_SOURCES="src/coverage/analysis_cache.c src/coverage/branch_info.c src/coverage/code_coverage.c"
   XDEBUG_DEBUGGER_SOURCES="src/debugger/com.c src/debugger/debugger.c src/debugger/handler_dbgp.c src/debugger/handlers.c src/debugger/ip_info.c"
   XDEBUG_DEVELOP_SOURCES="src/develop/develop.c src/develop/monitor.c src/develop/php_functions.c src/develop/stack.c src/develop/superglobals.c"
   XDEBUG_GCSTATS_SOURCES="src/gcstats/gc_stats.c"
-  XDEBUG_PROFILER_SOURCES="src/profiler/profiler.c"
-  XDEBUG_TRACING_SOURCES="src/tracing/trace_computerized.c src/tracing/trace_html.c src/tracing/trace_textual.c src/tracing/tracing.c"
+  XDEBUG_PROFILER_SOURCES="src/profiler/perf_events.c src/profiler/profile_cachegrind.c src/profiler/profile_collapsed.c src/profiler/profiler.c src/profiler/sampler.c"
+  XDEBUG_TRACING_SOURCES="src/tracing/trace_binary.c src/tracing/trace_computerized.c src/tracing/trace_html.c src/tracing/trace_summary.c src/tracing/trace_textual.c src/tracing/tracing.c"
 
   PHP_NEW_EXTENSION(xdebug, xdebug.c $XDEBUG_BASE_SOURCES $XDEBUG_LIB_SOURCES $XDEBUG_COVERAGE_SOURCES $XDEBUG_DEBUGGER_SOURCES $XDEBUG_DEVELOP_SOURCES $XDEBUG_GCSTATS_SOURCES $XDEBUG_PROFILER_SOURCES $XDEBUG_TRACING_SOURCES, $ext_shared,,$PHP_XDEBUG_CFLAGS,,yes)
   PHP_ADD_BUILD_DIR(PHP_EXT_BUILDDIR(xdebug)[/src/base])
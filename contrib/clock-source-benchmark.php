@@ -0,0 +1,91 @@
+<?php
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+/*
+ * Compares the cost of reading the clock with each value of
+ * xdebug.clock_source. For every clock source, a separate PHP process is
+ * started that calls xdebug_time_index() a number of times, and reports the
+ * clock source that Xdebug ended up using, and the average time per call.
+ *
+ * The time per call includes the overhead of calling a PHP function, which is
+ * the same for every clock source, so only the differences between them are
+ * meaningful.
+ *
+ * Usage: php clock-source-benchmark.php [readings]
+ */
+const CLOCK_SOURCES = [ 'default', 'tsc' ];
+
+function selectedClockSource()
+{
+	ob_start();
+	phpinfo( INFO_MODULES );
+	$info = ob_get_clean();
+
+	if ( preg_match( '/^Clock Source\s*(=>\s*)?(.+)$/m', strip_tags( $info ), $matches ) )
+	{
+		return trim( $matches[2] );
+	}
+
+	return 'unknown';
+}
+
+function runBenchmark( $readings )
+{
+	$start = hrtime( true );
+	for ( $i = 0; $i < $readings; $i++ )
+	{
+		xdebug_time_index();
+	}
+	$end = hrtime( true );
+
+	printf( "%s\t%.1f\n", selectedClockSource(), ( $end - $start ) / $readings );
+}
+
+if ( $argc > 2 && $argv[1] === '--run' )
+{
+	runBenchmark( (int) $argv[2] );
+	exit();
+}
+
+$readings = $argc > 1 ? (int) $argv[1] : 1000000;
+if ( $readings <= 0 )
+{
+	echo "Usage: php ", $argv[0], " [readings]\n";
+	exit( 1 );
+}
+
+printf( "%-8s  %-40s  %s\n", 'setting', 'clock source', 'ns/call' );
+foreach ( CLOCK_SOURCES as $clockSource )
+{
+	$command = sprintf(
+		'%s -d xdebug.mode=develop -d xdebug.clock_source=%s %s --run %d',
+		escapeshellarg( PHP_BINARY ),
+		escapeshellarg( $clockSource ),
+		escapeshellarg( __FILE__ ),
+		$readings
+	);
+
+	$output = trim( (string) shell_exec( $command ) );
+	if ( strpos( $output, "\t" ) === false )
+	{
+		printf( "%-8s  %s\n", $clockSource, 'failed' );
+		continue;
+	}
+
+	list( $selected, $cost ) = explode( "\t", $output, 2 );
+	printf( "%-8s  %-40s  %s\n", $clockSource, $selected, $cost );
+}
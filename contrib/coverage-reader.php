@@ -0,0 +1,175 @@
+<?php
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+/*
+ * Reads a file written by xdebug_dump_code_coverage(), and returns the same
+ * array as xdebug_get_code_coverage() would have returned.
+ *
+ * The file is line based. It starts with a header, which ends with an empty
+ * line:
+ *
+ *   version: 1
+ *   creator: xdebug 3.2.0 (PHP 8.1.2)
+ *   branch_check: 1
+ *   hit_count: 0
+ *
+ * Each following line is a record, which starts with its type:
+ *
+ *   file <path>
+ *       Starts the records of a file. <path> is the rest of the line.
+ *
+ *   line <lineno> <status>
+ *       A line of the last file. <status> is 1 when the line was executed,
+ *       -1 when it was not executed, and -2 when it can not be executed.
+ *       With hit_count: 1, an executed line has how often it ran instead of 1,
+ *       and so do the <hit> fields of branches and paths.
+ *
+ *   function <name>
+ *       Starts the records of a function of the last file. Only present when
+ *       branch_check is 1.
+ *
+ *   branch <op_start> <op_end> <line_start> <line_end> <hit> [<out>...]
+ *       A branch of the last function. Each <out> is written as
+ *       <index>:<op>:<hit>, for the branch starting at opcode <op>.
+ *
+ *   path <hit> <branch>...
+ *       A path of the last function, as the list of the opcodes at which its
+ *       branches start.
+ *
+ * Files that were written with xdebug.use_compression=1 can be read too.
+ *
+ * Run it as a script to print the coverage information with var_export().
+ */
+function xdebug_read_code_coverage( $fileName )
+{
+	if ( substr( $fileName, -3 ) == '.gz' )
+	{
+		$fileName = 'compress.zlib://' . $fileName;
+	}
+
+	$handle = fopen( $fileName, 'r' );
+	if ( !$handle )
+	{
+		throw new Exception( "Can't open '$fileName'" );
+	}
+
+	$header = [];
+	while ( ( $line = fgets( $handle ) ) !== false && rtrim( $line ) !== '' )
+	{
+		list( $key, $value ) = explode( ': ', rtrim( $line ), 2 );
+		$header[$key] = $value;
+	}
+
+	if ( !isset( $header['version'] ) || $header['version'] != 1 )
+	{
+		throw new Exception( "'$fileName' is not a code coverage file in a supported version" );
+	}
+	$branchCheck = !empty( $header['branch_check'] );
+
+	$coverage = [];
+	$file     = null;
+	$function = null;
+
+	while ( ( $line = fgets( $handle ) ) !== false )
+	{
+		$line = rtrim( $line, "\n" );
+		if ( $line === '' )
+		{
+			continue;
+		}
+
+		list( $type, $rest ) = explode( ' ', $line, 2 );
+
+		switch ( $type )
+		{
+			case 'file':
+				$file = $rest;
+				$coverage[$file] = $branchCheck ? [ 'lines' => [], 'functions' => [] ] : [];
+				break;
+
+			case 'line':
+				list( $lineNo, $status ) = explode( ' ', $rest );
+				if ( $branchCheck )
+				{
+					$coverage[$file]['lines'][(int) $lineNo] = (int) $status;
+				}
+				else
+				{
+					$coverage[$file][(int) $lineNo] = (int) $status;
+				}
+				break;
+
+			case 'function':
+				$function = $rest;
+				$coverage[$file]['functions'][$function] = [];
+				break;
+
+			case 'branch':
+				$parts = explode( ' ', $rest );
+				$branch = [
+					'op_start'   => (int) $parts[0],
+					'op_end'     => (int) $parts[1],
+					'line_start' => (int) $parts[2],
+					'line_end'   => (int) $parts[3],
+					'hit'        => (int) $parts[4],
+					'out'        => [],
+					'out_hit'    => [],
+				];
+				foreach ( array_slice( $parts, 5 ) as $out )
+				{
+					list( $index, $op, $hit ) = explode( ':', $out );
+					$branch['out'][(int) $index]     = (int) $op;
+					$branch['out_hit'][(int) $index] = (int) $hit;
+				}
+
+				$functionInfo =& $coverage[$file]['functions'][$function];
+				if ( !isset( $functionInfo['branches'] ) )
+				{
+					$functionInfo = [ 'branches' => [], 'paths' => [] ];
+				}
+				$functionInfo['branches'][$branch['op_start']] = $branch;
+				unset( $functionInfo );
+				break;
+
+			case 'path':
+				$parts = array_map( 'intval', explode( ' ', $rest ) );
+				$hit   = array_shift( $parts );
+
+				$coverage[$file]['functions'][$function]['paths'][] = [ 'path' => $parts, 'hit' => $hit ];
+				break;
+
+			default:
+				throw new Exception( "Unknown record type '$type' in '$fileName'" );
+		}
+	}
+
+	fclose( $handle );
+
+	return $coverage;
+}
+
+if ( PHP_SAPI == 'cli' && isset( $argv[0] ) && realpath( $argv[0] ) == __FILE__ )
+{
+	if ( $argc != 2 )
+	{
+		echo "Usage:\n\tphp coverage-reader.php <coverage file>\n";
+		exit( 1 );
+	}
+
+	var_export( xdebug_read_code_coverage( $argv[1] ) );
+	echo "\n";
+}
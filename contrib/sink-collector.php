@@ -0,0 +1,179 @@
+<?php
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+/*
+ * Collects the trace and profile files that PHP processes write to the Unix
+ * domain socket or FIFO that is configured with xdebug.output_sink, and
+ * stores each of them as a file in an output directory.
+ *
+ * Everything that is written to the sink is a frame. A frame starts with a
+ * header of 13 bytes, followed by the payload:
+ *
+ *   length  4 bytes, big endian: the length of the payload
+ *   pid     4 bytes, big endian: the process ID of the writer
+ *   stream  4 bytes, big endian: the number of the file within the process
+ *   type    1 byte:
+ *           'O'  opens a file, with the file's name as payload
+ *           'D'  data for the file
+ *           'C'  closes the file, with the number of bytes that were dropped
+ *                because the collector did not read fast enough as payload
+ *                (8 bytes, big endian)
+ *
+ * Frames for different files can be interleaved, and are told apart by their
+ * pid and stream fields. Frames written to a FIFO are never larger than
+ * PIPE_BUF, so that frames of different processes do not get mixed up.
+ */
+function xdebug_sink_parse_frames( &$buffer )
+{
+	$frames = [];
+
+	while ( strlen( $buffer ) >= 13 )
+	{
+		$header = unpack( 'Nlength/Npid/Nstream/Ctype', $buffer );
+		if ( strlen( $buffer ) < 13 + $header['length'] )
+		{
+			break;
+		}
+
+		$frames[] = [
+			'pid'     => $header['pid'],
+			'stream'  => $header['stream'],
+			'type'    => chr( $header['type'] ),
+			'payload' => (string) substr( $buffer, 13, $header['length'] ),
+		];
+		$buffer = (string) substr( $buffer, 13 + $header['length'] );
+	}
+
+	return $frames;
+}
+
+class XdebugSinkCollector
+{
+	private $outputDir;
+	private $files = [];
+
+	function __construct( $outputDir )
+	{
+		$this->outputDir = rtrim( $outputDir, '/' );
+	}
+
+	function handleFrame( array $frame )
+	{
+		$key = "{$frame['pid']}:{$frame['stream']}";
+
+		switch ( $frame['type'] )
+		{
+			case 'O':
+				$fileName = $this->outputDir . '/' . basename( $frame['payload'] );
+				$this->files[$key] = fopen( $fileName, 'w' );
+				echo "{$frame['pid']}: writing {$fileName}\n";
+				break;
+
+			case 'D':
+				if ( isset( $this->files[$key] ) )
+				{
+					fwrite( $this->files[$key], $frame['payload'] );
+				}
+				break;
+
+			case 'C':
+				if ( isset( $this->files[$key] ) )
+				{
+					fclose( $this->files[$key] );
+					unset( $this->files[$key] );
+				}
+
+				$dropped = unpack( 'J', $frame['payload'] )[1];
+				if ( $dropped )
+				{
+					echo "{$frame['pid']}: {$dropped} bytes were dropped\n";
+				}
+				break;
+		}
+	}
+
+	function run( $path )
+	{
+		$buffers = [];
+
+		if ( file_exists( $path ) && filetype( $path ) == 'fifo' )
+		{
+			/* Opened for writing too, so that the FIFO stays open when
+			 * writers go away */
+			$server = null;
+			$streams = [ fopen( $path, 'r+' ) ];
+		}
+		else
+		{
+			$server = stream_socket_server( "unix://{$path}", $errno, $errstr );
+			if ( !$server )
+			{
+				throw new Exception( "Can't listen on '$path': $errstr" );
+			}
+			$streams = [ $server ];
+		}
+
+		while ( true )
+		{
+			$read = $streams;
+			$write = $except = null;
+
+			if ( stream_select( $read, $write, $except, null ) === false )
+			{
+				break;
+			}
+
+			foreach ( $read as $stream )
+			{
+				if ( $stream === $server )
+				{
+					$streams[] = stream_socket_accept( $server );
+					continue;
+				}
+
+				$id = (int) $stream;
+				$data = fread( $stream, 1048576 );
+				if ( $data === false || $data === '' )
+				{
+					fclose( $stream );
+					unset( $streams[array_search( $stream, $streams, true )], $buffers[$id] );
+					continue;
+				}
+
+				$buffers[$id] = ( isset( $buffers[$id] ) ? $buffers[$id] : '' ) . $data;
+				foreach ( xdebug_sink_parse_frames( $buffers[$id] ) as $frame )
+				{
+					$this->handleFrame( $frame );
+				}
+			}
+		}
+	}
+}
+
+if ( PHP_SAPI == 'cli' && isset( $argv[0] ) && realpath( $argv[0] ) == __FILE__ )
+{
+	if ( $argc != 3 )
+	{
+		echo "Usage:\n\tphp sink-collector.php <socket or FIFO path> <output directory>\n\n";
+		echo "Listens on a new Unix domain socket, or reads from an existing FIFO, and writes\n";
+		echo "the received trace and profile files into the output directory.\n";
+		exit( 1 );
+	}
+
+	$collector = new XdebugSinkCollector( $argv[2] );
+	$collector->run( $argv[1] );
+}
@@ -0,0 +1,418 @@
+<?php
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+/*
+ * Converts a trace file that was written with xdebug.trace_format=3 (binary)
+ * to the textual (0) or computerized (1) trace format, as if the trace had
+ * been written in that format. The layout of the binary format is described
+ * in src/tracing/trace_binary.c.
+ *
+ * The textual format does not show the CPU time, and the computerized format
+ * does not show the right hand side variable names of assignments, just like
+ * when Xdebug writes them itself.
+ *
+ * Files that were written with xdebug.use_compression=1 can be read too.
+ */
+class XdebugBinaryTraceReader
+{
+	const FORMAT_TEXTUAL      = 0;
+	const FORMAT_COMPUTERIZED = 1;
+
+	const FLAG_CPU_TIME = 1;
+
+	const INCLUDE_NONE = 0;
+	const INCLUDE_FILE = 1;
+	const INCLUDE_EVAL = 2;
+
+	const ARG_VARIADIC  = 1;
+	const ARG_UNDEFINED = 2;
+
+	private $handle;
+	private $buffer = '';
+	private $position = 0;
+
+	private $strings = [];
+	private $nanotime = 0;
+
+	function __construct( $fileName )
+	{
+		if ( substr( $fileName, -3 ) == '.gz' )
+		{
+			$fileName = 'compress.zlib://' . $fileName;
+		}
+
+		$this->handle = fopen( $fileName, 'r' );
+		if ( !$this->handle )
+		{
+			throw new Exception( "Can't open '$fileName'" );
+		}
+	}
+
+	function __destruct()
+	{
+		if ( $this->handle )
+		{
+			fclose( $this->handle );
+		}
+	}
+
+	/* Makes sure that $length bytes are available, and returns false at the
+	 * end of the file */
+	private function fill( $length )
+	{
+		while ( strlen( $this->buffer ) - $this->position < $length )
+		{
+			$data = fread( $this->handle, 1048576 );
+			if ( $data === false || $data === '' )
+			{
+				return false;
+			}
+			$this->buffer = substr( $this->buffer, $this->position ) . $data;
+			$this->position = 0;
+		}
+
+		return true;
+	}
+
+	private function readBytes( $length )
+	{
+		if ( $length == 0 )
+		{
+			return '';
+		}
+		if ( !$this->fill( $length ) )
+		{
+			throw new Exception( "Unexpected end of the trace file" );
+		}
+
+		$bytes = substr( $this->buffer, $this->position, $length );
+		$this->position += $length;
+
+		return $bytes;
+	}
+
+	private function readVarint()
+	{
+		$value = 0;
+		$shift = 0;
+
+		do
+		{
+			$byte = ord( $this->readBytes( 1 ) );
+			$value |= ( $byte & 0x7f ) << $shift;
+			$shift += 7;
+		} while ( $byte & 0x80 );
+
+		return $value;
+	}
+
+	private function readString()
+	{
+		return $this->readBytes( $this->readVarint() );
+	}
+
+	private function readStringRef()
+	{
+		$id = $this->readVarint();
+		if ( !isset( $this->strings[$id] ) )
+		{
+			throw new Exception( "Undefined string id '$id' in the trace file" );
+		}
+
+		return $this->strings[$id];
+	}
+
+	/* Returns the time in seconds since the start of the request */
+	private function readTime()
+	{
+		$zigzag = $this->readVarint();
+		$this->nanotime += ( $zigzag >> 1 ) ^ -( $zigzag & 1 );
+
+		return $this->nanotime / 1000000000;
+	}
+
+	private function readArguments()
+	{
+		$arguments = [];
+		$count = $this->readVarint();
+
+		for ( $i = 0; $i < $count; $i++ )
+		{
+			$flags = $this->readVarint();
+			$nameId = $this->readVarint();
+
+			$arguments[] = [
+				'variadic' => (bool) ( $flags & self::ARG_VARIADIC ),
+				'name'     => $nameId ? $this->strings[$nameId] : null,
+				'value'    => ( $flags & self::ARG_UNDEFINED ) ? null : $this->readString(),
+			];
+		}
+
+		return $arguments;
+	}
+
+	private static function formatInclude( $type, $include )
+	{
+		if ( $type == self::INCLUDE_EVAL )
+		{
+			return "'" . addcslashes( $include, "'\\\0..\37" ) . "'";
+		}
+
+		return $include;
+	}
+
+	private static function formatTextualArguments( array $arguments )
+	{
+		$line = '';
+		$comma = false;
+		$variadicOpened = false;
+		$variadicCount = 0;
+
+		foreach ( $arguments as $argument )
+		{
+			if ( $comma )
+			{
+				$line .= ', ';
+			}
+			else
+			{
+				$comma = true;
+			}
+
+			if ( $argument['variadic'] )
+			{
+				$line .= '...';
+				$variadicOpened = true;
+				$comma = false;
+			}
+
+			if ( $argument['name'] !== null )
+			{
+				$line .= '$' . $argument['name'];
+				$line .= ( $variadicOpened && !$argument['variadic'] ) ? ' => ' : ' = ';
+			}
+
+			if ( $argument['variadic'] )
+			{
+				$line .= 'variadic(';
+				if ( $argument['value'] === null )
+				{
+					continue;
+				}
+				$comma = true;
+			}
+
+			if ( $variadicOpened && ( $argument['name'] === null || $argument['variadic'] ) )
+			{
+				$line .= $variadicCount++ . ' => ';
+			}
+
+			$line .= $argument['value'] === null ? '???' : $argument['value'];
+		}
+
+		if ( $variadicOpened )
+		{
+			$line .= ')';
+		}
+
+		return $line;
+	}
+
+	/* Writes the converted trace to the stream $output */
+	function convert( $format, $output )
+	{
+		if ( $this->readBytes( 4 ) !== 'XDTB' )
+		{
+			throw new Exception( "Not a binary Xdebug trace file" );
+		}
+		if ( ( $version = $this->readVarint() ) != 1 )
+		{
+			throw new Exception( "Unsupported binary trace file version '$version'" );
+		}
+		$xdebugVersion = $this->readString();
+		$startTime = $this->readString();
+		$flags = $this->readVarint();
+
+		if ( $format == self::FORMAT_COMPUTERIZED )
+		{
+			fwrite( $output, "Version: {$xdebugVersion}\nFile format: 4\n" );
+		}
+		fwrite( $output, "TRACE START [{$startTime}]\n" );
+
+		while ( $this->fill( 1 ) )
+		{
+			$type = $this->readBytes( 1 );
+
+			switch ( $type )
+			{
+				case 'S':
+					$id = $this->readVarint();
+					$this->strings[$id] = $this->readString();
+					break;
+
+				case 'E':
+					$level = $this->readVarint();
+					$nr = $this->readVarint();
+					$time = $this->readTime();
+					$memory = $this->readVarint();
+					$function = $this->readStringRef();
+					$userDefined = $this->readVarint();
+					$includeType = $this->readVarint();
+					$include = '';
+					if ( $includeType == self::INCLUDE_FILE )
+					{
+						$include = $this->readStringRef();
+					}
+					else if ( $includeType == self::INCLUDE_EVAL )
+					{
+						$include = $this->readString();
+					}
+					$file = $this->readStringRef();
+					$line = $this->readVarint();
+					$arguments = $this->readArguments();
+
+					if ( $format == self::FORMAT_COMPUTERIZED )
+					{
+						fwrite( $output, sprintf(
+							"%d\t%d\t0\t%F\t%d\t%s\t%d\t%s\t%s\t%d\t%d",
+							$level, $nr, $time, $memory, $function, $userDefined,
+							self::formatInclude( $includeType, $include ), $file, $line, count( $arguments )
+						) );
+						foreach ( $arguments as $argument )
+						{
+							fwrite( $output, "\t" . ( $argument['value'] === null ? '???' : $argument['value'] ) );
+						}
+						fwrite( $output, "\n" );
+					}
+					else
+					{
+						fwrite( $output, sprintf(
+							"%10.4F %10d %s-> %s(%s%s) %s:%d\n",
+							$time, $memory, str_repeat( '  ', $level ), $function,
+							self::formatTextualArguments( $arguments ),
+							self::formatInclude( $includeType, $include ), $file, $line
+						) );
+					}
+					break;
+
+				case 'X':
+					$level = $this->readVarint();
+					$nr = $this->readVarint();
+					$time = $this->readTime();
+					$memory = $this->readVarint();
+					$cpuTime = ( $flags & self::FLAG_CPU_TIME ) ? $this->readVarint() : null;
+
+					if ( $format == self::FORMAT_COMPUTERIZED )
+					{
+						fwrite( $output, sprintf( "%d\t%d\t1\t%F\t%d", $level, $nr, $time, $memory ) );
+						if ( $cpuTime !== null )
+						{
+							fwrite( $output, sprintf( "\t%F", $cpuTime / 1000000000 ) );
+						}
+						fwrite( $output, "\n" );
+					}
+					break;
+
+				case 'R':
+					$level = $this->readVarint();
+					$nr = $this->readVarint();
+					$time = $this->readTime();
+					$memory = $this->readVarint();
+					$value = $this->readString();
+
+					if ( $format == self::FORMAT_COMPUTERIZED )
+					{
+						fwrite( $output, "{$level}\t{$nr}\tR\t\t\t{$value}\n" );
+					}
+					else
+					{
+						fwrite( $output, sprintf(
+							"%10.4F %10d %s >=> %s\n",
+							$time, $memory, str_repeat( '  ', $level ), $value
+						) );
+					}
+					break;
+
+				case 'A':
+					$level = $this->readVarint();
+					$file = $this->readStringRef();
+					$line = $this->readVarint();
+					$varName = $this->readString();
+					$op = $this->readString();
+					$value = $rightVarName = '';
+					if ( $op !== '' )
+					{
+						$value = $this->readString();
+						$rightVarName = $this->readString();
+					}
+
+					if ( $format == self::FORMAT_COMPUTERIZED )
+					{
+						fwrite( $output, "{$level}\t\tA\t\t\t\t\t\t{$file}\t{$line}\t{$varName}" );
+						if ( $op !== '' )
+						{
+							fwrite( $output, " {$op} {$value}" );
+						}
+						fwrite( $output, "\n" );
+					}
+					else
+					{
+						fwrite( $output, str_repeat( ' ', 20 ) . str_repeat( '  ', $level + 1 ) . "   => {$varName}" );
+						if ( $op !== '' )
+						{
+							fwrite( $output, " {$op} " . ( $rightVarName !== '' ? $rightVarName : $value ) );
+						}
+						fwrite( $output, " {$file}:{$line}\n" );
+					}
+					break;
+
+				case 'F':
+					$time = $this->readTime();
+					$memory = $this->readVarint();
+					$endTime = $this->readString();
+
+					if ( $format == self::FORMAT_COMPUTERIZED )
+					{
+						fwrite( $output, sprintf( "\t\t\t%F\t%d\n", $time, $memory ) );
+					}
+					else
+					{
+						fwrite( $output, sprintf( "%10.4F %10d\n", $time, $memory ) );
+					}
+					fwrite( $output, "TRACE END   [{$endTime}]\n\n" );
+					break;
+
+				default:
+					throw new Exception( sprintf( "Unknown record type '0x%02x' in the trace file", ord( $type ) ) );
+			}
+		}
+	}
+}
+
+if ( PHP_SAPI == 'cli' && isset( $argv[0] ) && realpath( $argv[0] ) == __FILE__ )
+{
+	if ( $argc < 2 || $argc > 3 || ( $argc == 3 && !in_array( $argv[2], [ '0', '1' ], true ) ) )
+	{
+		echo "Usage:\n\tphp trace-binary-reader.php <trace file> [0|1]\n\n";
+		echo "Converts a binary trace file (xdebug.trace_format=3) to the textual (0, default)\n";
+		echo "or computerized (1) trace format, and writes it to standard output.\n";
+		exit( 1 );
+	}
+
+	$reader = new XdebugBinaryTraceReader( $argv[1] );
+	$reader->convert( $argc == 3 ? (int) $argv[2] : XdebugBinaryTraceReader::FORMAT_TEXTUAL, STDOUT );
+}
@@ -55,17 +55,32 @@ function xdebug_debug_zval_stdout(string ...$varname) {}
 
 /* -----------------------------------------------------------------------*/
 
+/* Writes code coverage information to a file */
+function xdebug_dump_code_coverage(string $filename): ?string {}
+
+/* -----------------------------------------------------------------------*/
+
 /* Displays information about super globals */
 /** @return void */
 function xdebug_dump_superglobals() {}
 
 /* -----------------------------------------------------------------------*/
 
+/* Writes out the buffered records of the current function trace */
+function xdebug_flush_trace(): bool {}
+
+/* -----------------------------------------------------------------------*/
+
 /* Returns code coverage information */
 function xdebug_get_code_coverage(): array {}
 
 /* -----------------------------------------------------------------------*/
 
+/* Returns the code coverage information that changed since the last call */
+function xdebug_get_code_coverage_delta(): array {}
+
+/* -----------------------------------------------------------------------*/
+
 /* Returns all collected error messages */
 /** @return void */
 function xdebug_get_collected_errors(bool $emptyList = false) {}
@@ -141,6 +156,11 @@ function xdebug_memory_usage(): int {}
 
 /* -----------------------------------------------------------------------*/
 
+/* Merges code coverage information from a file into the current coverage */
+function xdebug_merge_code_coverage(string $filename): bool {}
+
+/* -----------------------------------------------------------------------*/
+
 /* Sends data to a debugging client */
 function xdebug_notify(mixed $data): bool {}
 
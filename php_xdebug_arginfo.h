@@ -1,5 +1,5 @@
 /* This is a generated file, edit the .stub.php file instead.
- * Stub hash: 4ba05f82238ea12cb9ed1763a244d6c68b7ffdf7 */
+ * Stub hash: dbf38541b2338f73781202826dc8862287abc7c4 */
 
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_xdebug_break, 0, 0, _IS_BOOL, 0)
 ZEND_END_ARG_INFO()
@@ -24,12 +24,20 @@ ZEND_END_ARG_INFO()
 
 #define arginfo_xdebug_debug_zval_stdout arginfo_xdebug_debug_zval
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_xdebug_dump_code_coverage, 0, 1, IS_STRING, 1)
+	ZEND_ARG_TYPE_INFO(0, filename, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_xdebug_dump_superglobals, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
+#define arginfo_xdebug_flush_trace arginfo_xdebug_break
+
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_xdebug_get_code_coverage, 0, 0, IS_ARRAY, 0)
 ZEND_END_ARG_INFO()
 
+#define arginfo_xdebug_get_code_coverage_delta arginfo_xdebug_get_code_coverage
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_xdebug_get_collected_errors, 0, 0, 0)
 	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, emptyList, _IS_BOOL, 0, "false")
 ZEND_END_ARG_INFO()
@@ -63,6 +71,10 @@ ZEND_END_ARG_INFO()
 
 #define arginfo_xdebug_memory_usage arginfo_xdebug_get_function_count
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_xdebug_merge_code_coverage, 0, 1, _IS_BOOL, 0)
+	ZEND_ARG_TYPE_INFO(0, filename, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_xdebug_notify, 0, 1, _IS_BOOL, 0)
 	ZEND_ARG_TYPE_INFO(0, data, IS_MIXED, 0)
 ZEND_END_ARG_INFO()
@@ -128,8 +140,11 @@ ZEND_FUNCTION(xdebug_code_coverage_started);
 ZEND_FUNCTION(xdebug_connect_to_client);
 ZEND_FUNCTION(xdebug_debug_zval);
 ZEND_FUNCTION(xdebug_debug_zval_stdout);
+ZEND_FUNCTION(xdebug_dump_code_coverage);
 ZEND_FUNCTION(xdebug_dump_superglobals);
+ZEND_FUNCTION(xdebug_flush_trace);
 ZEND_FUNCTION(xdebug_get_code_coverage);
+ZEND_FUNCTION(xdebug_get_code_coverage_delta);
 ZEND_FUNCTION(xdebug_get_collected_errors);
 ZEND_FUNCTION(xdebug_get_function_count);
 ZEND_FUNCTION(xdebug_get_function_stack);
@@ -144,6 +159,7 @@ ZEND_FUNCTION(xdebug_get_tracefile_name);
 ZEND_FUNCTION(xdebug_info);
 ZEND_FUNCTION(xdebug_is_debugger_active);
 ZEND_FUNCTION(xdebug_memory_usage);
+ZEND_FUNCTION(xdebug_merge_code_coverage);
 ZEND_FUNCTION(xdebug_notify);
 ZEND_FUNCTION(xdebug_peak_memory_usage);
 ZEND_FUNCTION(xdebug_print_function_stack);
@@ -172,8 +188,11 @@ static const zend_function_entry ext_functions[] = {
 	ZEND_FE(xdebug_connect_to_client, arginfo_xdebug_connect_to_client)
 	ZEND_FE(xdebug_debug_zval, arginfo_xdebug_debug_zval)
 	ZEND_FE(xdebug_debug_zval_stdout, arginfo_xdebug_debug_zval_stdout)
+	ZEND_FE(xdebug_dump_code_coverage, arginfo_xdebug_dump_code_coverage)
 	ZEND_FE(xdebug_dump_superglobals, arginfo_xdebug_dump_superglobals)
+	ZEND_FE(xdebug_flush_trace, arginfo_xdebug_flush_trace)
 	ZEND_FE(xdebug_get_code_coverage, arginfo_xdebug_get_code_coverage)
+	ZEND_FE(xdebug_get_code_coverage_delta, arginfo_xdebug_get_code_coverage_delta)
 	ZEND_FE(xdebug_get_collected_errors, arginfo_xdebug_get_collected_errors)
 	ZEND_FE(xdebug_get_function_count, arginfo_xdebug_get_function_count)
 	ZEND_FE(xdebug_get_function_stack, arginfo_xdebug_get_function_stack)
@@ -188,6 +207,7 @@ static const zend_function_entry ext_functions[] = {
 	ZEND_FE(xdebug_info, arginfo_xdebug_info)
 	ZEND_FE(xdebug_is_debugger_active, arginfo_xdebug_is_debugger_active)
 	ZEND_FE(xdebug_memory_usage, arginfo_xdebug_memory_usage)
+	ZEND_FE(xdebug_merge_code_coverage, arginfo_xdebug_merge_code_coverage)
 	ZEND_FE(xdebug_notify, arginfo_xdebug_notify)
 	ZEND_FE(xdebug_peak_memory_usage, arginfo_xdebug_peak_memory_usage)
 	ZEND_FE(xdebug_print_function_stack, arginfo_xdebug_print_function_stack)
@@ -36,6 +36,7 @@
 
 #include "base.h"
 #include "filter.h"
+#include "function_identity.h"
 #include "develop/develop.h"
 #include "develop/stack.h"
 #include "gcstats/gc_stats.h"
@@ -114,6 +115,83 @@ void xdebug_func_dtor(xdebug_func *elem)
 	xdfree(elem);
 }
 
+/* Frames at the same depth often have a similar number of arguments, so instead
+ * of freeing the argument array of a returning frame, it is kept for the next
+ * frame at that depth. Arrays larger than XDEBUG_ARGUMENT_POOL_MAX_SIZE are not
+ * kept. As frames in different fibers can be at the same depth, a frame owns
+ * the array it takes until it returns it. */
+#define XDEBUG_ARGUMENT_POOL_MAX_SIZE 64
+
+static void argument_pool_get(function_stack_entry *fse, unsigned int count)
+{
+	xdebug_argument_pool_entry *entry;
+
+	if (fse->level < XG_BASE(argument_pool_size)) {
+		entry = &XG_BASE(argument_pool)[fse->level];
+
+		if (entry->var && entry->size >= count) {
+			fse->var = entry->var;
+			fse->var_size = entry->size;
+
+			entry->var = NULL;
+			entry->size = 0;
+			return;
+		}
+	}
+
+	fse->var = xdmalloc(count * sizeof(xdebug_var_name));
+	fse->var_size = count;
+}
+
+static void argument_pool_release(function_stack_entry *fse)
+{
+	xdebug_argument_pool_entry *entry;
+
+	if (fse->var_size == 0 || fse->var_size > XDEBUG_ARGUMENT_POOL_MAX_SIZE) {
+		xdfree(fse->var);
+		return;
+	}
+
+	if (fse->level >= XG_BASE(argument_pool_size)) {
+		unsigned int old_size = XG_BASE(argument_pool_size);
+
+		XG_BASE(argument_pool_size) = fse->level + 32;
+		XG_BASE(argument_pool) = xdrealloc(XG_BASE(argument_pool), XG_BASE(argument_pool_size) * sizeof(xdebug_argument_pool_entry));
+		memset(XG_BASE(argument_pool) + old_size, 0, (XG_BASE(argument_pool_size) - old_size) * sizeof(xdebug_argument_pool_entry));
+	}
+
+	entry = &XG_BASE(argument_pool)[fse->level];
+
+	/* Keep the largest array */
+	if (entry->var && entry->size >= fse->var_size) {
+		xdfree(fse->var);
+		return;
+	}
+	if (entry->var) {
+		xdfree(entry->var);
+	}
+
+	entry->var = fse->var;
+	entry->size = fse->var_size;
+}
+
+static void argument_pool_destroy(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < XG_BASE(argument_pool_size); i++) {
+		if (XG_BASE(argument_pool)[i].var) {
+			xdfree(XG_BASE(argument_pool)[i].var);
+		}
+	}
+	if (XG_BASE(argument_pool)) {
+		xdfree(XG_BASE(argument_pool));
+	}
+
+	XG_BASE(argument_pool) = NULL;
+	XG_BASE(argument_pool_size) = 0;
+}
+
 static void function_stack_entry_dtor(void *elem)
 {
 	unsigned int          i;
@@ -132,7 +210,7 @@ static void function_stack_entry_dtor(void *elem)
 			}
 			zval_ptr_dtor(&(e->var[i].data));
 		}
-		xdfree(e->var);
+		argument_pool_release(e);
 	}
 
 	if (e->include_filename) {
@@ -143,11 +221,6 @@ static void function_stack_entry_dtor(void *elem)
 		xdebug_llist_destroy(e->declared_vars, NULL);
 		e->declared_vars = NULL;
 	}
-
-	if (e->profile.call_list) {
-		xdebug_llist_destroy(e->profile.call_list, NULL);
-		e->profile.call_list = NULL;
-	}
 }
 
 int xdebug_include_or_eval_handler(XDEBUG_OPCODE_HANDLER_ARGS)
@@ -370,7 +443,7 @@ static void collect_params_internal(function_stack_entry *fse, zend_execute_data
 	}
 
 	fse->varc = arguments_storage;
-	fse->var = xdmalloc(fse->varc * sizeof(xdebug_var_name));
+	argument_pool_get(fse, fse->varc);
 
 #if DEBUG
 	fprintf(stderr, " - names_expected: %d, arguments_sent: %d, arguments_storage: %d, fse->varc: %d\n", names_expected, arguments_sent, arguments_storage, fse->varc);
@@ -444,7 +517,10 @@ static void collect_params_internal(function_stack_entry *fse, zend_execute_data
 		int          i = fse->varc;
 
 		fse->varc += zend_hash_num_elements(zdata->extra_named_params);
-		fse->var = xdrealloc(fse->var, fse->varc * sizeof(xdebug_var_name));
+		if (fse->varc > fse->var_size) {
+			fse->var = xdrealloc(fse->var, fse->varc * sizeof(xdebug_var_name));
+			fse->var_size = fse->varc;
+		}
 
 		ZEND_HASH_FOREACH_STR_KEY_VAL(zdata->extra_named_params, name, param) {
 			fse->var[i].name = zend_string_copy(name);
@@ -497,7 +573,7 @@ static void collect_params(function_stack_entry *fse, zend_execute_data *zdata,
 	}
 
 	fse->varc = arguments_storage;
-	fse->var = xdmalloc(fse->varc * sizeof(xdebug_var_name));
+	argument_pool_get(fse, fse->varc);
 
 #if DEBUG
 	fprintf(stderr, " - names_expected: %d, arguments_sent: %d, arguments_storage: %d, fse->varc: %d\n", names_expected, arguments_sent, arguments_storage, fse->varc);
@@ -581,7 +657,10 @@ static void collect_params(function_stack_entry *fse, zend_execute_data *zdata,
 		int          i = fse->varc;
 
 		fse->varc += zend_hash_num_elements(zdata->extra_named_params);
-		fse->var = xdrealloc(fse->var, fse->varc * sizeof(xdebug_var_name));
+		if (fse->varc > fse->var_size) {
+			fse->var = xdrealloc(fse->var, fse->varc * sizeof(xdebug_var_name));
+			fse->var_size = fse->varc;
+		}
 
 		ZEND_HASH_FOREACH_STR_KEY_VAL(zdata->extra_named_params, name, param) {
 			fse->var[i].name = zend_string_copy(name);
@@ -604,6 +683,7 @@ function_stack_entry *xdebug_add_stack_frame(zend_execute_data *zdata, zend_op_a
 	zend_op             **opline_ptr = NULL;
 	function_stack_entry *tmp;
 	zend_op              *cur_opcode;
+	zend_op_array        *filename_op_array = NULL;
 
 	if (type == XDEBUG_USER_DEFINED) {
 		edata = EG(current_execute_data)->prev_execute_data;
@@ -629,13 +709,17 @@ function_stack_entry *xdebug_add_stack_frame(zend_execute_data *zdata, zend_op_a
 			ptr = ptr->prev_execute_data;
 		}
 		if (ptr) {
-			tmp->filename = zend_string_copy(ptr->func->op_array.filename);
+			filename_op_array = &ptr->func->op_array;
+			tmp->filename = zend_string_copy(filename_op_array->filename);
 		}
 	}
 
 	if (!tmp->filename) {
 		/* Includes/main script etc */
-		tmp->filename  = (type == XDEBUG_USER_DEFINED && op_array && op_array->filename) ? zend_string_copy(op_array->filename) : NULL;
+		if (type == XDEBUG_USER_DEFINED && op_array && op_array->filename) {
+			filename_op_array = op_array;
+			tmp->filename = zend_string_copy(op_array->filename);
+		}
 	}
 	/* Call user function locations */
 	if (!tmp->filename && XG_BASE(stack)) {
@@ -698,7 +782,7 @@ function_stack_entry *xdebug_add_stack_frame(zend_execute_data *zdata, zend_op_a
 	}
 
 	/* Now we have location and name, we can run the filter (for stack and tracing)*/
-	xdebug_filter_run(tmp);
+	xdebug_filter_run(tmp, filename_op_array);
 
 	/* Count code coverage line for call */
 	xdebug_coverage_count_line_if_branch_check_active(op_array, tmp->filename, tmp->lineno);
@@ -1259,6 +1343,9 @@ void xdebug_base_minit(INIT_FUNC_ARGS)
 	zend_observer_fiber_switch_register(xdebug_fiber_switch_observer);
 #endif
 
+	/* Reserve an op_array slot for caching the path filter results */
+	xdebug_filter_minit();
+
 	XG_BASE(private_tmp) = NULL;
 #ifdef __linux__
 	read_systemd_private_tmp_directory(&XG_BASE(private_tmp));
@@ -1297,6 +1384,12 @@ void xdebug_base_rinit()
 	) {
 		xdebug_base_use_xdebug_error_cb();
 		xdebug_base_use_xdebug_throw_exception_hook();
+	} else if (
+		XDEBUG_MODE_IS(XDEBUG_MODE_TRACING) && !XDEBUG_MODE_IS(XDEBUG_MODE_DEVELOP) && !XDEBUG_MODE_IS(XDEBUG_MODE_STEP_DEBUG) &&
+		xdebug_tracing_buffers_records()
+	) {
+		/* Only to write out buffered trace records on fatal errors */
+		xdebug_base_use_xdebug_error_cb();
 	}
 
 #if PHP_VERSION_ID >= 80100
@@ -1310,6 +1403,8 @@ void xdebug_base_rinit()
 	XG_BASE(function_count) = -1;
 	XG_BASE(last_eval_statement) = NULL;
 	XG_BASE(last_exception_trace) = NULL;
+	XG_BASE(argument_pool) = NULL;
+	XG_BASE(argument_pool_size) = 0;
 
 	/* Initialize start time */
 	if (XDEBUG_MODE_IS(XDEBUG_MODE_TRACING) || XDEBUG_MODE_IS(XDEBUG_MODE_DEVELOP)) {
@@ -1328,9 +1423,12 @@ void xdebug_base_rinit()
 	XG_BASE(filter_type_code_coverage) = XDEBUG_FILTER_NONE;
 	XG_BASE(filter_type_stack)         = XDEBUG_FILTER_NONE;
 	XG_BASE(filter_type_tracing)       = XDEBUG_FILTER_NONE;
-	XG_BASE(filters_code_coverage)     = xdebug_llist_alloc(xdebug_llist_string_dtor);
-	XG_BASE(filters_stack)             = xdebug_llist_alloc(xdebug_llist_string_dtor);
-	XG_BASE(filters_tracing)           = xdebug_llist_alloc(xdebug_llist_string_dtor);
+	XG_BASE(filters_code_coverage)     = xdebug_filter_alloc();
+	XG_BASE(filters_stack)             = xdebug_filter_alloc();
+	XG_BASE(filters_tracing)           = xdebug_filter_alloc();
+	xdebug_filter_new_cache_tag();
+
+	xdebug_function_identity_rinit();
 
 	xdebug_base_overloaded_functions_setup();
 
@@ -1349,6 +1447,10 @@ void xdebug_base_post_deactivate()
 #endif
 	XG_BASE(stack) = NULL;
 
+	/* Needs to happen after the stack has been destroyed, as that returns the
+	 * argument arrays to the pool */
+	argument_pool_destroy();
+
 	XG_BASE(in_debug_info)    = 0;
 
 	if (XG_BASE(last_eval_statement)) {
@@ -1361,11 +1463,15 @@ void xdebug_base_post_deactivate()
 	}
 
 	/* filters */
-	xdebug_llist_destroy(XG_BASE(filters_code_coverage), NULL);
-	xdebug_llist_destroy(XG_BASE(filters_stack), NULL);
-	xdebug_llist_destroy(XG_BASE(filters_tracing), NULL);
-	XG_BASE(filters_tracing) = NULL;
+	xdebug_filter_free(XG_BASE(filters_code_coverage));
+	xdebug_filter_free(XG_BASE(filters_stack));
+	xdebug_filter_free(XG_BASE(filters_tracing));
 	XG_BASE(filters_code_coverage) = NULL;
+	XG_BASE(filters_stack) = NULL;
+	XG_BASE(filters_tracing) = NULL;
+
+	/* Needs to happen after the stack has been destroyed */
+	xdebug_function_identity_post_deactivate();
 
 	xdebug_base_overloaded_functions_restore();
 }
@@ -1380,6 +1486,9 @@ void xdebug_base_rshutdown()
 #if PHP_VERSION_ID >= 80100
 static void xdebug_error_cb(int orig_type, zend_string *error_filename, const unsigned int error_lineno, zend_string *message)
 {
+	if (XDEBUG_MODE_IS(XDEBUG_MODE_TRACING)) {
+		xdebug_tracing_error_cb(orig_type & E_ALL);
+	}
 	if (XDEBUG_MODE_IS(XDEBUG_MODE_STEP_DEBUG)) {
 		int type                        = orig_type & E_ALL;
 		char *error_type_str            = xdebug_error_type(type);
@@ -1397,6 +1506,9 @@ static void xdebug_error_cb(int orig_type, zend_string *error_filename, const un
 #else
 static void xdebug_error_cb(int orig_type, const char *error_filename, const unsigned int error_lineno, zend_string *message)
 {
+	if (XDEBUG_MODE_IS(XDEBUG_MODE_TRACING)) {
+		xdebug_tracing_error_cb(orig_type & E_ALL);
+	}
 	if (XDEBUG_MODE_IS(XDEBUG_MODE_STEP_DEBUG)) {
 		int type                        = orig_type & E_ALL;
 		char *error_type_str            = xdebug_error_type(type);
@@ -1528,8 +1640,14 @@ PHP_FUNCTION(xdebug_pcntl_exec)
    Dummy function to set a new connection when forking a process */
 PHP_FUNCTION(xdebug_pcntl_fork)
 {
+	zend_ulong parent_pid = xdebug_get_pid();
+
 	XG_BASE(orig_pcntl_fork_func)(INTERNAL_FUNCTION_PARAM_PASSTHRU);
 
 	xdebug_debugger_restart_if_pid_changed();
+
+	if (XDEBUG_MODE_IS(XDEBUG_MODE_COVERAGE) && Z_TYPE_P(return_value) == IS_LONG && Z_LVAL_P(return_value) == 0) {
+		xdebug_coverage_pcntl_fork_child_handler(parent_pid);
+	}
 }
 /* }}} */
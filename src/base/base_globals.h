@@ -26,6 +26,11 @@
 typedef void (WINAPI *WIN_PRECISE_TIME_FUNC)(LPFILETIME);
 #endif
 
+typedef struct _xdebug_argument_pool_entry {
+	struct xdebug_var_name *var;
+	unsigned short          size;
+} xdebug_argument_pool_entry;
+
 typedef struct _xdebug_nanotime_context {
 	uint64_t start_abs;
 	uint64_t last_abs;
@@ -33,6 +38,7 @@ typedef struct _xdebug_nanotime_context {
 	uint64_t start_rel;
 	uint64_t last_rel;
 	int      use_rel_time;
+	int      use_tsc;
 #endif
 #if PHP_WIN32
 	WIN_PRECISE_TIME_FUNC win_precise_time_func;
@@ -61,6 +67,10 @@ typedef struct _xdebug_base_globals_t {
 	zend_string  *last_eval_statement;
 	char         *last_exception_trace;
 
+	/* argument arrays of returned stack frames, one for each depth */
+	xdebug_argument_pool_entry *argument_pool;
+	unsigned int  argument_pool_size;
+
 	/* in-execution checking */
 	zend_bool  in_execution;
 	zend_bool  in_var_serialisation;
@@ -72,9 +82,17 @@ typedef struct _xdebug_base_globals_t {
 	zend_long     filter_type_code_coverage;
 	zend_long     filter_type_stack;
 	zend_long     filter_type_tracing;
-	xdebug_llist *filters_code_coverage;
-	xdebug_llist *filters_stack;
-	xdebug_llist *filters_tracing;
+	struct _xdebug_filter *filters_code_coverage;
+	struct _xdebug_filter *filters_stack;
+	struct _xdebug_filter *filters_tracing;
+	zend_ulong    filter_cache_generation;
+	uint32_t      filter_cache_owner;
+	size_t        filter_cache_tag;
+
+	/* function identities */
+	xdebug_hash  *function_identities;
+	xdebug_hash  *function_identity_keys;
+	int           function_identity_last_id;
 
 	/* PHP versions */
 	const char   *php_version_compile_time;
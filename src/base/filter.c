@@ -17,11 +17,18 @@
 
 #include "filter.h"
 
+#include "lib/compat.h"
 #include "lib/lib.h"
 #include "lib/log.h"
 
 ZEND_EXTERN_MODULE_GLOBALS(xdebug)
 
+/* True globals */
+int zend_xdebug_path_filter_offset = -1;
+#if SIZEOF_SIZE_T < 8
+int zend_xdebug_path_filter_owner_offset = -1;
+#endif
+
 int xdebug_is_stack_frame_filtered(int filter_type, function_stack_entry *fse)
 {
 	switch (filter_type) {
@@ -58,89 +65,182 @@ void xdebug_filter_register_constants(INIT_FUNC_ARGS)
 	REGISTER_LONG_CONSTANT("XDEBUG_NAMESPACE_EXCLUDE", XDEBUG_NAMESPACE_EXCLUDE, CONST_CS | CONST_PERSISTENT);
 }
 
-static int xdebug_filter_match_path_include(function_stack_entry *fse, unsigned char *filtered_flag, char *filter)
+/* Filters are compiled into a prefix trie, with all characters folded to lower
+ * case, so that matching a path or class name costs one step per character of
+ * that name instead of a comparison per configured prefix. */
+struct _xdebug_filter_node {
+	unsigned char                terminal;
+	int                          count;
+	unsigned char               *keys;
+	struct _xdebug_filter_node **children;
+};
+
+struct _xdebug_filter {
+	xdebug_filter_node root;
+	unsigned char      match_global; /* Set by the "" namespace filter */
+};
+
+static void xdebug_filter_node_empty(xdebug_filter_node *node)
 {
-	if (fse->filename && strncasecmp(filter, ZSTR_VAL(fse->filename), strlen(filter)) == 0) {
-		*filtered_flag = 0;
-		return 1;
+	int i;
+
+	for (i = 0; i < node->count; i++) {
+		xdebug_filter_node_empty(node->children[i]);
+		xdfree(node->children[i]);
 	}
-	return 0;
+	if (node->keys) {
+		xdfree(node->keys);
+		xdfree(node->children);
+	}
+
+	node->terminal = 0;
+	node->count    = 0;
+	node->keys     = NULL;
+	node->children = NULL;
 }
 
-static int xdebug_filter_match_path_exclude(function_stack_entry *fse, unsigned char *filtered_flag, char *filter)
+/* Keys are kept sorted, so a child can be found with a binary search. Returns
+ * the position where the key is, or should be inserted. */
+static int xdebug_filter_node_find(xdebug_filter_node *node, unsigned char key, int *found)
 {
-	if (fse->filename && strncasecmp(filter, ZSTR_VAL(fse->filename), strlen(filter)) == 0) {
-		*filtered_flag = 1;
-		return 1;
+	int low = 0, high = node->count - 1;
+
+	while (low <= high) {
+		int mid = low + (high - low) / 2;
+
+		if (node->keys[mid] == key) {
+			*found = 1;
+			return mid;
+		}
+		if (node->keys[mid] < key) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
 	}
-	return 0;
+
+	*found = 0;
+	return low;
 }
 
-static int xdebug_filter_match_namespace_include(function_stack_entry *fse, unsigned char *filtered_flag, char *filter)
+static xdebug_filter_node *xdebug_filter_node_child(xdebug_filter_node *node, unsigned char key)
 {
-	if (!fse->function.object_class && filter[0] == '\0') {
-		*filtered_flag = 0;
-		return 1;
+	int found;
+	int pos = xdebug_filter_node_find(node, key, &found);
+
+	return found ? node->children[pos] : NULL;
+}
+
+static xdebug_filter_node *xdebug_filter_node_add_child(xdebug_filter_node *node, unsigned char key)
+{
+	int                 found;
+	int                 pos = xdebug_filter_node_find(node, key, &found);
+	xdebug_filter_node *child;
+
+	if (found) {
+		return node->children[pos];
 	}
-	if (fse->function.object_class && filter[0] != '\0' && strncasecmp(filter, ZSTR_VAL(fse->function.object_class), strlen(filter)) == 0) {
-		*filtered_flag = 0;
-		return 1;
+
+	node->keys     = xdrealloc(node->keys, node->count + 1);
+	node->children = xdrealloc(node->children, (node->count + 1) * sizeof(xdebug_filter_node*));
+
+	memmove(&node->keys[pos + 1], &node->keys[pos], node->count - pos);
+	memmove(&node->children[pos + 1], &node->children[pos], (node->count - pos) * sizeof(xdebug_filter_node*));
+
+	child = xdcalloc(1, sizeof(xdebug_filter_node));
+	node->keys[pos]     = key;
+	node->children[pos] = child;
+	node->count++;
+
+	return child;
+}
+
+xdebug_filter *xdebug_filter_alloc(void)
+{
+	return xdcalloc(1, sizeof(xdebug_filter));
+}
+
+void xdebug_filter_empty(xdebug_filter *filter)
+{
+	xdebug_filter_node_empty(&filter->root);
+	filter->match_global = 0;
+}
+
+void xdebug_filter_free(xdebug_filter *filter)
+{
+	if (!filter) {
+		return;
 	}
-	return 0;
+
+	xdebug_filter_empty(filter);
+	xdfree(filter);
 }
 
-static int xdebug_filter_match_namespace_exclude(function_stack_entry *fse, unsigned char *filtered_flag, char *filter)
+static void xdebug_filter_add(xdebug_filter *filter, const char *prefix, int is_namespace)
 {
-	if (!fse->function.object_class && filter[0] == '\0') {
-		*filtered_flag = 1;
-		return 1;
+	xdebug_filter_node *node = &filter->root;
+
+	/* For namespace filters, an empty filter stands for functions that are
+	 * not in a class, instead of matching everything */
+	if (is_namespace && prefix[0] == '\0') {
+		filter->match_global = 1;
+		return;
 	}
-	if (fse->function.object_class && filter[0] != '\0' && strncasecmp(filter, ZSTR_VAL(fse->function.object_class), strlen(filter)) == 0) {
-		*filtered_flag = 1;
-		return 1;
+
+	for (; *prefix; prefix++) {
+		/* A shorter prefix already matches everything this one would */
+		if (node->terminal) {
+			return;
+		}
+		node = xdebug_filter_node_add_child(node, (unsigned char) tolower((unsigned char) *prefix));
 	}
-	return 0;
-}
 
+	/* And longer prefixes are made redundant by this one */
+	xdebug_filter_node_empty(node);
+	node->terminal = 1;
+}
 
-void xdebug_filter_run_internal(function_stack_entry *fse, int group, unsigned char *filtered_flag, int type, xdebug_llist *filters)
+static int xdebug_filter_match_prefix(xdebug_filter *filter, const char *str)
 {
-	xdebug_llist_element *le;
-	unsigned int          k;
-	function_stack_entry  tmp_fse;
-	int (*filter_to_run)(function_stack_entry *fse, unsigned char *filtered_flag, char *filter);
+	xdebug_filter_node *node = &filter->root;
 
-	le = XDEBUG_LLIST_HEAD(filters);
+	while (!node->terminal) {
+		if (*str == '\0') {
+			return 0;
+		}
 
-	switch (type) {
-		case XDEBUG_PATH_INCLUDE:
-			*filtered_flag = 1;
-			if (group == XDEBUG_FILTER_CODE_COVERAGE && fse->function.type & XFUNC_INCLUDES) {
-				tmp_fse.filename = fse->include_filename;
-				fse = &tmp_fse;
-			}
+		node = xdebug_filter_node_child(node, (unsigned char) tolower((unsigned char) *str));
+		if (!node) {
+			return 0;
+		}
+		str++;
+	}
 
-			filter_to_run = xdebug_filter_match_path_include;
-			break;
+	return 1;
+}
 
+void xdebug_filter_run_internal(function_stack_entry *fse, int group, unsigned char *filtered_flag, int type, xdebug_filter *filters)
+{
+	zend_string *filename = fse->filename;
+	int          matched;
+
+	switch (type) {
+		case XDEBUG_PATH_INCLUDE:
 		case XDEBUG_PATH_EXCLUDE:
-			*filtered_flag = 0;
 			if (group == XDEBUG_FILTER_CODE_COVERAGE && fse->function.type & XFUNC_INCLUDES) {
-				tmp_fse.filename = fse->include_filename;
-				fse = &tmp_fse;
+				filename = fse->include_filename;
 			}
 
-			filter_to_run = xdebug_filter_match_path_exclude;
+			matched = filename && xdebug_filter_match_prefix(filters, ZSTR_VAL(filename));
 			break;
 
 		case XDEBUG_NAMESPACE_INCLUDE:
-			*filtered_flag = 1;
-			filter_to_run = xdebug_filter_match_namespace_include;
-			break;
-
 		case XDEBUG_NAMESPACE_EXCLUDE:
-			*filtered_flag = 0;
-			filter_to_run = xdebug_filter_match_namespace_exclude;
+			if (fse->function.object_class) {
+				matched = xdebug_filter_match_prefix(filters, ZSTR_VAL(fse->function.object_class));
+			} else {
+				matched = filters->match_global;
+			}
 			break;
 
 		default:
@@ -148,27 +248,124 @@ void xdebug_filter_run_internal(function_stack_entry *fse, int group, unsigned c
 			return;
 	}
 
-	for (k = 0; k < filters->size; k++, le = XDEBUG_LLIST_NEXT(le)) {
-		char *filter = XDEBUG_LLIST_VALP(le);
+	if (type == XDEBUG_PATH_INCLUDE || type == XDEBUG_NAMESPACE_INCLUDE) {
+		*filtered_flag = !matched;
+	} else {
+		*filtered_flag = matched;
+	}
+}
 
-		/* If the filter matched once, we're done */
-		if (filter_to_run(fse, filtered_flag, filter)) {
-			break;
-		}
+/* The result of the path filters only depends on the file name, so it is
+ * cached in the op_array that provided that file name. The cached value is
+ * only valid for the owner that wrote it, the process (and thread) ID as
+ * op_arrays can be shared through opcache, and the generation of the current
+ * filters. With a 64-bit size_t the owner is kept in the upper 32 bits of the
+ * slot's value, and the generation and flags in the lower 32 bits. Otherwise
+ * the owner needs a slot of its own, as they would overlap. */
+#define XDEBUG_FILTER_CACHE_STACK   0x01
+#define XDEBUG_FILTER_CACHE_TRACING 0x02
+#define XDEBUG_FILTER_CACHE_VALID   0x04
+#define XDEBUG_FILTER_CACHE_FLAGS   (XDEBUG_FILTER_CACHE_STACK | XDEBUG_FILTER_CACHE_TRACING)
+
+#define XDEBUG_FILTER_IS_CACHEABLE(t) ((t) == XDEBUG_FILTER_NONE || (t) == XDEBUG_PATH_INCLUDE || (t) == XDEBUG_PATH_EXCLUDE)
+
+void xdebug_filter_minit(void)
+{
+	zend_xdebug_path_filter_offset = zend_get_resource_handle(XDEBUG_NAME);
+#if SIZEOF_SIZE_T < 8
+	zend_xdebug_path_filter_owner_offset = zend_get_resource_handle(XDEBUG_NAME);
+	if (zend_xdebug_path_filter_owner_offset == -1) {
+		zend_xdebug_path_filter_offset = -1;
 	}
+#endif
 }
 
-void xdebug_filter_run(function_stack_entry *fse)
+void xdebug_filter_new_cache_tag(void)
 {
+	uint32_t owner = (uint32_t) xdebug_get_pid();
+	uint32_t generation;
+
+#ifdef ZTS
+	owner ^= (uint32_t) tsrm_thread_id();
+#endif
+
+	XG_BASE(filter_cache_generation)++;
+	generation = (uint32_t) (XG_BASE(filter_cache_generation) << 3);
+
+	XG_BASE(filter_cache_owner) = owner;
+#if SIZEOF_SIZE_T < 8
+	XG_BASE(filter_cache_tag) = generation | XDEBUG_FILTER_CACHE_VALID;
+#else
+	XG_BASE(filter_cache_tag) = ((size_t) owner << 32) | generation | XDEBUG_FILTER_CACHE_VALID;
+#endif
+}
+
+static int filter_cache_find(zend_op_array *op_array, size_t *cached)
+{
+	*cached = (size_t) op_array->reserved[zend_xdebug_path_filter_offset];
+
+#if SIZEOF_SIZE_T < 8
+	if ((uint32_t) (size_t) op_array->reserved[zend_xdebug_path_filter_owner_offset] != XG_BASE(filter_cache_owner)) {
+		return 0;
+	}
+#endif
+
+	return (*cached & ~XDEBUG_FILTER_CACHE_FLAGS) == XG_BASE(filter_cache_tag);
+}
+
+static void filter_cache_store(zend_op_array *op_array, size_t value)
+{
+#if SIZEOF_SIZE_T < 8
+	/* Invalidated first, so that no other owner's value is taken for ours */
+	op_array->reserved[zend_xdebug_path_filter_offset] = NULL;
+	op_array->reserved[zend_xdebug_path_filter_owner_offset] = (void*) (size_t) XG_BASE(filter_cache_owner);
+#endif
+	op_array->reserved[zend_xdebug_path_filter_offset] = (void*) value;
+}
+
+void xdebug_filter_run(function_stack_entry *fse, zend_op_array *filename_op_array)
+{
+	int cacheable;
+
 	fse->filtered_stack   = 0;
 	fse->filtered_tracing = 0;
 
+	if (XG_BASE(filter_type_stack) == XDEBUG_FILTER_NONE && XG_BASE(filter_type_tracing) == XDEBUG_FILTER_NONE) {
+		return;
+	}
+
+	cacheable = (
+		filename_op_array &&
+		zend_xdebug_path_filter_offset != -1 &&
+		XDEBUG_FILTER_IS_CACHEABLE(XG_BASE(filter_type_stack)) &&
+		XDEBUG_FILTER_IS_CACHEABLE(XG_BASE(filter_type_tracing))
+	);
+
+	if (cacheable) {
+		size_t cached;
+
+		if (filter_cache_find(filename_op_array, &cached)) {
+			fse->filtered_stack   = !!(cached & XDEBUG_FILTER_CACHE_STACK);
+			fse->filtered_tracing = !!(cached & XDEBUG_FILTER_CACHE_TRACING);
+			return;
+		}
+	}
+
 	if (XG_BASE(filter_type_stack) != XDEBUG_FILTER_NONE) {
 		xdebug_filter_run_internal(fse, XDEBUG_FILTER_STACK, &fse->filtered_stack, XG_BASE(filter_type_stack), XG_BASE(filters_stack));
 	}
 	if (XG_BASE(filter_type_tracing) != XDEBUG_FILTER_NONE) {
 		xdebug_filter_run_internal(fse, XDEBUG_FILTER_TRACING, &fse->filtered_tracing, XG_BASE(filter_type_tracing), XG_BASE(filters_tracing));
 	}
+
+	if (cacheable) {
+		filter_cache_store(
+			filename_op_array,
+			XG_BASE(filter_cache_tag) |
+			(fse->filtered_stack ? XDEBUG_FILTER_CACHE_STACK : 0) |
+			(fse->filtered_tracing ? XDEBUG_FILTER_CACHE_TRACING : 0)
+		);
+	}
 }
 
 /* {{{ proto void xdebug_set_filter(int group, int type, array filters)
@@ -177,7 +374,7 @@ PHP_FUNCTION(xdebug_set_filter)
 {
 	zend_long      filter_group;
 	zend_long      filter_type;
-	xdebug_llist **filter_list;
+	xdebug_filter **filter_list;
 	zval          *filters, *item;
 
 	if (zend_parse_parameters(ZEND_NUM_ARGS(), "lla", &filter_group, &filter_type, &filters) == FAILURE) {
@@ -224,6 +421,9 @@ PHP_FUNCTION(xdebug_set_filter)
 			return;
 	}
 
+	/* Results cached in op_arrays are for the previous filters */
+	xdebug_filter_new_cache_tag();
+
 	if (
 		filter_type == XDEBUG_PATH_INCLUDE ||
 		filter_type == XDEBUG_PATH_EXCLUDE ||
@@ -249,7 +449,7 @@ PHP_FUNCTION(xdebug_set_filter)
 		return;
 	}
 
-	xdebug_llist_empty(*filter_list, NULL);
+	xdebug_filter_empty(*filter_list);
 
 	if (filter_type == XDEBUG_FILTER_NONE) {
 		return;
@@ -261,7 +461,11 @@ PHP_FUNCTION(xdebug_set_filter)
 
 		/* If we are a namespace filter, and the filter name starts with \, we
 		 * need to strip the \ from the matcher */
-		xdebug_llist_insert_next(*filter_list, XDEBUG_LLIST_TAIL(*filter_list), xdstrdup(filter[0] == '\\' ? &filter[1] : filter));
+		xdebug_filter_add(
+			*filter_list,
+			filter[0] == '\\' ? &filter[1] : filter,
+			filter_type == XDEBUG_NAMESPACE_INCLUDE || filter_type == XDEBUG_NAMESPACE_EXCLUDE
+		);
 
 		zend_string_release(str);
 	} ZEND_HASH_FOREACH_END();
@@ -19,12 +19,22 @@
 #include "lib/php-header.h"
 #include "php_xdebug.h"
 
+typedef struct _xdebug_filter_node xdebug_filter_node;
+typedef struct _xdebug_filter      xdebug_filter;
+
+xdebug_filter *xdebug_filter_alloc(void);
+void xdebug_filter_empty(xdebug_filter *filter);
+void xdebug_filter_free(xdebug_filter *filter);
+
+void xdebug_filter_minit(void);
+void xdebug_filter_new_cache_tag(void);
+
 int xdebug_is_stack_frame_filtered(int filter_type, function_stack_entry *fse);
 int xdebug_is_top_stack_frame_filtered(int filter_type);
 void xdebug_filter_register_constants(INIT_FUNC_ARGS);
-void xdebug_filter_run(function_stack_entry *fse);
+void xdebug_filter_run(function_stack_entry *fse, zend_op_array *filename_op_array);
 void xdebug_filter_run_code_coverage(zend_op_array *op_array);
-void xdebug_filter_run_internal(function_stack_entry *fse, int group, unsigned char *filtered_flag, int type, xdebug_llist *filters);
+void xdebug_filter_run_internal(function_stack_entry *fse, int group, unsigned char *filtered_flag, int type, xdebug_filter *filters);
 
 #define XDEBUG_FILTER_NONE           0x000
 #define XDEBUG_FILTER_CODE_COVERAGE  0x100
@@ -0,0 +1,197 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#include "php_xdebug.h"
+
+#include "function_identity.h"
+
+#include "lib/lib.h"
+#include "lib/mm.h"
+#include "lib/var.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(xdebug)
+
+/* Used as 'type' for names that xdebug_function_identity_for_op_array()
+ * creates, so that they never clash with names for frames */
+#define XDEBUG_FUNCTION_IDENTITY_TYPE_OP_ARRAY -1
+
+/* Everything that the name of a function depends on. User code is keyed on
+ * its opcodes, as these are shared between all copies of the same op_array
+ * (closures, and methods imported from traits). As the opcodes of a file
+ * can be freed, and their memory reused, during a request, the location is
+ * part of the key too. Internal functions are keyed on their handler, as
+ * fake closures copy the zend_function. */
+typedef struct _xdebug_function_identity_key {
+	const void  *code;
+	zend_string *filename;
+	uint32_t     line_start;
+	zend_string *function_name;
+	const void  *scope;
+	zend_string *object_class;
+	int          type;
+	int          is_closure;
+} xdebug_function_identity_key;
+
+static void function_identity_dtor(void *elem)
+{
+	xdebug_function_identity *fi = (xdebug_function_identity*) elem;
+
+	xdfree(fi->name);
+	xdfree(fi);
+}
+
+void xdebug_function_identity_rinit(void)
+{
+	XG_BASE(function_identities) = xdebug_hash_alloc(1024, function_identity_dtor);
+	XG_BASE(function_identity_keys) = xdebug_hash_alloc(1024, NULL);
+	XG_BASE(function_identity_last_id) = 0;
+}
+
+void xdebug_function_identity_post_deactivate(void)
+{
+	xdebug_hash_destroy(XG_BASE(function_identity_keys));
+	xdebug_hash_destroy(XG_BASE(function_identities));
+	XG_BASE(function_identity_keys) = NULL;
+	XG_BASE(function_identities) = NULL;
+}
+
+xdebug_function_identity *xdebug_function_identity_intern(const char *name, size_t name_len)
+{
+	xdebug_function_identity *fi;
+
+	if (xdebug_hash_find(XG_BASE(function_identities), name, name_len, (void*) &fi)) {
+		return fi;
+	}
+
+	fi = xdmalloc(sizeof(xdebug_function_identity));
+	fi->id = ++XG_BASE(function_identity_last_id);
+	fi->name = xdmalloc(name_len + 1);
+	memcpy(fi->name, name, name_len);
+	fi->name[name_len] = '\0';
+	fi->name_len = name_len;
+
+	xdebug_hash_add(XG_BASE(function_identities), fi->name, fi->name_len, (void*) fi);
+
+	return fi;
+}
+
+static void init_key_for_function(xdebug_function_identity_key *key, zend_function *func, int type)
+{
+	memset(key, 0, sizeof(xdebug_function_identity_key));
+
+	if (ZEND_USER_CODE(func->type)) {
+		key->code       = func->op_array.opcodes;
+		key->filename   = func->op_array.filename;
+		key->line_start = func->op_array.line_start;
+	} else {
+		key->code = (const void*) func->internal_function.handler;
+	}
+	key->function_name = func->common.function_name;
+	key->scope         = func->common.scope;
+	key->type          = type;
+	key->is_closure    = !!(func->common.fn_flags & ZEND_ACC_CLOSURE);
+}
+
+/* Returns 0 if the name of the frame is not fully determined by the key, in
+ * which case it needs to be created and looked up by name */
+static int init_key_for_frame(xdebug_function_identity_key *key, function_stack_entry *fse)
+{
+	zend_function *func = (zend_function*) fse->op_array;
+
+	switch (fse->function.type) {
+		case XFUNC_EVAL:
+		case XFUNC_INCLUDE:
+		case XFUNC_INCLUDE_ONCE:
+		case XFUNC_REQUIRE:
+		case XFUNC_REQUIRE_ONCE:
+		case XFUNC_MAIN:
+			memset(key, 0, sizeof(xdebug_function_identity_key));
+			key->type = fse->function.type;
+			return 1;
+
+		case XFUNC_NORMAL:
+		case XFUNC_STATIC_MEMBER:
+		case XFUNC_MEMBER:
+			break;
+
+		default:
+			return 0;
+	}
+
+	if (!func || !func->common.function_name || (func->common.fn_flags & ZEND_ACC_CALL_VIA_TRAMPOLINE)) {
+		return 0;
+	}
+
+	/* call_user_func() and friends have their call site in the name */
+	if (fse->function.function && strncmp(fse->function.function, "call_user_func", 14) == 0) {
+		return 0;
+	}
+
+	init_key_for_function(key, func, fse->function.type);
+
+	/* Without a scope, a method's name uses the class of $this */
+	if (fse->function.type == XFUNC_MEMBER && !func->common.scope) {
+		key->object_class = fse->function.object_class;
+	}
+
+	return 1;
+}
+
+xdebug_function_identity *xdebug_function_identity_for_frame(function_stack_entry *fse)
+{
+	xdebug_function_identity_key  key;
+	xdebug_function_identity     *fi;
+	char                         *name;
+	int                           has_key;
+
+	if (fse->identity) {
+		return fse->identity;
+	}
+
+	has_key = init_key_for_frame(&key, fse);
+
+	if (!has_key || !xdebug_hash_find(XG_BASE(function_identity_keys), (char*) &key, sizeof(key), (void*) &fi)) {
+		name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
+		fi = xdebug_function_identity_intern(name, strlen(name));
+		xdfree(name);
+
+		if (has_key) {
+			xdebug_hash_add(XG_BASE(function_identity_keys), (char*) &key, sizeof(key), (void*) fi);
+		}
+	}
+
+	fse->identity = fi;
+
+	return fi;
+}
+
+xdebug_function_identity *xdebug_function_identity_for_op_array(zend_op_array *op_array, xdebug_function_identity_name_builder_t build_name)
+{
+	xdebug_function_identity_key  key;
+	xdebug_function_identity     *fi;
+	char                         *name;
+
+	init_key_for_function(&key, (zend_function*) op_array, XDEBUG_FUNCTION_IDENTITY_TYPE_OP_ARRAY);
+
+	if (!xdebug_hash_find(XG_BASE(function_identity_keys), (char*) &key, sizeof(key), (void*) &fi)) {
+		name = build_name(op_array);
+		fi = xdebug_function_identity_intern(name, strlen(name));
+		xdfree(name);
+
+		xdebug_hash_add(XG_BASE(function_identity_keys), (char*) &key, sizeof(key), (void*) fi);
+	}
+
+	return fi;
+}
@@ -0,0 +1,42 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __XDEBUG_FUNCTION_IDENTITY_H__
+#define __XDEBUG_FUNCTION_IDENTITY_H__
+
+#include "lib/php-header.h"
+#include "php_xdebug.h"
+
+/* A function identity is the interned, pre-formatted name of a function,
+ * together with a per-request stable integer ID. Identities are looked up
+ * through what the name depends on (the function itself, its scope, etc.)
+ * so that the name only has to be created once per request. */
+typedef struct _xdebug_function_identity {
+	int     id;
+	char   *name;
+	size_t  name_len;
+} xdebug_function_identity;
+
+typedef char* (*xdebug_function_identity_name_builder_t)(zend_op_array *op_array);
+
+void xdebug_function_identity_rinit(void);
+void xdebug_function_identity_post_deactivate(void);
+
+xdebug_function_identity *xdebug_function_identity_intern(const char *name, size_t name_len);
+xdebug_function_identity *xdebug_function_identity_for_frame(function_stack_entry *fse);
+xdebug_function_identity *xdebug_function_identity_for_op_array(zend_op_array *op_array, xdebug_function_identity_name_builder_t build_name);
+
+#endif // __XDEBUG_FUNCTION_IDENTITY_H__
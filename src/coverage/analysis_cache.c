@@ -0,0 +1,733 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#include "php_xdebug.h"
+#include "zend_extensions.h"
+
+#include <stdio.h>
+#ifndef PHP_WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "analysis_cache.h"
+#include "code_coverage_private.h"
+
+#include "lib/crc32.h"
+#include "lib/hash.h"
+#include "lib/log.h"
+#include "lib/str.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(xdebug)
+
+/* The results of the dead code analysis, and of the branch and path analysis,
+ * are kept in one cache file per source file, in xdebug.coverage_cache_dir.
+ * The file starts with a header that identifies the source file, and the
+ * build of PHP and Xdebug. It is followed by one record per analysed
+ * op_array, keyed on a hash of its opcodes, so that op_arrays that opcache
+ * optimised differently do not share a record.
+ *
+ * Cache files are mapped into memory when the first op_array of their source
+ * file gets analysed. New records are collected, and indexed, during the
+ * request, so that op_arrays that are analysed again after code coverage
+ * was restarted find them too. At the end of the request the file is written
+ * to a temporary file next to it, which is then renamed, so that processes
+ * running in parallel never see a partial file.
+ *
+ * Integers are written in the byte order of the machine, and the build
+ * string in the header makes sure that they are only read on the same. */
+
+#define ANALYSIS_CACHE_MAGIC   "XDCC"
+#define ANALYSIS_CACHE_VERSION 3
+#define ANALYSIS_CACHE_BUILD   XDEBUG_VERSION " " PHP_VERSION " " ZEND_EXTENSION_BUILD_ID
+
+#define RECORD_DEAD_CODE          1
+#define RECORD_BRANCHES           2
+#define RECORD_PATH_LIMIT_REACHED 4
+
+typedef struct _xdebug_analysis_cache_record {
+	uint32_t    flags;
+	uint32_t    last;
+	const char *payload;
+	uint32_t    payload_len;
+	char       *owned_payload; /* for records that are not in the file yet */
+} xdebug_analysis_cache_record;
+
+typedef struct _xdebug_analysis_cache_file {
+	char        *cache_path;
+	zend_string *source;
+	int64_t      mtime;
+	int64_t      size;
+
+	char        *data;
+	size_t       data_size;
+	int          mapped;
+	size_t       records_start; /* 0 when the existing file is not usable */
+	size_t       records_end;
+
+	xdebug_hash *records;
+	xdebug_str   pending;
+} xdebug_analysis_cache_file;
+
+typedef struct _analysis_cache_reader {
+	const char *p;
+	const char *end;
+} analysis_cache_reader;
+
+static int read_bytes(analysis_cache_reader *r, void *dest, size_t len)
+{
+	if ((size_t) (r->end - r->p) < len) {
+		return 0;
+	}
+
+	if (dest) {
+		memcpy(dest, r->p, len);
+	}
+	r->p += len;
+
+	return 1;
+}
+
+static int read_u32(analysis_cache_reader *r, uint32_t *value)
+{
+	return read_bytes(r, value, sizeof(uint32_t));
+}
+
+static void write_u32(xdebug_str *str, uint32_t value)
+{
+	xdebug_str_addl(str, (char*) &value, sizeof(uint32_t), 0);
+}
+
+static void write_u64(xdebug_str *str, uint64_t value)
+{
+	xdebug_str_addl(str, (char*) &value, sizeof(uint64_t), 0);
+}
+
+/* As allocated by xdebug_set_create() */
+static size_t set_bytes(unsigned int size)
+{
+	return (size / 8) + 1 + ((size % 8) != 0);
+}
+
+/* FNV-1a over everything that the analysis looks at */
+static inline uint64_t hash_add(uint64_t hash, uint32_t value)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		hash ^= (value >> (i * 8)) & 0xff;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static uint64_t hash_add_bytes(uint64_t hash, const char *bytes, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char) bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/* Constant arrays are followed, as the jump tables of switch and match
+ * statements are such arrays */
+static uint64_t hash_add_zval(uint64_t hash, zval *zv, int depth)
+{
+	hash = hash_add(hash, Z_TYPE_P(zv));
+
+	switch (Z_TYPE_P(zv)) {
+		case IS_LONG:
+			hash = hash_add_bytes(hash, (char*) &Z_LVAL_P(zv), sizeof(zend_long));
+			break;
+
+		case IS_DOUBLE:
+			hash = hash_add_bytes(hash, (char*) &Z_DVAL_P(zv), sizeof(double));
+			break;
+
+		case IS_STRING:
+			hash = hash_add(hash, Z_STRLEN_P(zv));
+			hash = hash_add_bytes(hash, Z_STRVAL_P(zv), Z_STRLEN_P(zv));
+			break;
+
+		case IS_ARRAY: {
+			zend_ulong   num;
+			zend_string *key;
+			zval        *val;
+
+			hash = hash_add(hash, zend_hash_num_elements(Z_ARRVAL_P(zv)));
+			if (depth > 8) {
+				break;
+			}
+
+			ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(zv), num, key, val) {
+				if (key) {
+					hash = hash_add(hash, ZSTR_LEN(key));
+					hash = hash_add_bytes(hash, ZSTR_VAL(key), ZSTR_LEN(key));
+				} else {
+					hash = hash_add_bytes(hash, (char*) &num, sizeof(zend_ulong));
+				}
+				hash = hash_add_zval(hash, val, depth + 1);
+			} ZEND_HASH_FOREACH_END();
+			break;
+		}
+	}
+
+	return hash;
+}
+
+static uint64_t op_array_key(zend_op_array *op_array, int with_branches)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint32_t i;
+
+	hash = hash_add(hash, with_branches);
+	if (with_branches) {
+		/* The paths that were found depend on the limit */
+		hash = hash_add(hash, (uint32_t) XINI_COV(coverage_path_limit));
+	}
+	hash = hash_add(hash, op_array->last);
+	hash = hash_add(hash, op_array->line_start);
+	hash = hash_add(hash, op_array->line_end);
+	hash = hash_add(hash, op_array->fn_flags & ZEND_ACC_GENERATOR);
+
+	for (i = 0; i < op_array->last; i++) {
+		const zend_op *opline = &op_array->opcodes[i];
+
+		hash = hash_add(hash, opline->opcode | (opline->op1_type << 8) | (opline->op2_type << 16) | (opline->result_type << 24));
+		hash = hash_add(hash, opline->lineno);
+		hash = hash_add(hash, opline->op1.num);
+		hash = hash_add(hash, opline->op2.num);
+		hash = hash_add(hash, opline->extended_value);
+
+		if (opline->opcode == ZEND_SWITCH_LONG || opline->opcode == ZEND_SWITCH_STRING || opline->opcode == ZEND_MATCH) {
+			hash = hash_add_zval(hash, RT_CONSTANT(opline, opline->op2), 0);
+		}
+	}
+
+	hash = hash_add(hash, op_array->last_literal);
+	for (i = 0; i < (uint32_t) op_array->last_literal; i++) {
+		hash = hash_add_zval(hash, &op_array->literals[i], 0);
+	}
+
+	return hash;
+}
+
+static void analysis_cache_record_dtor(void *data)
+{
+	xdebug_analysis_cache_record *record = (xdebug_analysis_cache_record*) data;
+
+	if (record->owned_payload) {
+		xdfree(record->owned_payload);
+	}
+	xdfree(record);
+}
+
+static void analysis_cache_file_dtor(void *data)
+{
+	xdebug_analysis_cache_file *file = (xdebug_analysis_cache_file*) data;
+
+	if (!file) {
+		return;
+	}
+
+	if (file->data) {
+#ifndef PHP_WIN32
+		if (file->mapped) {
+			munmap(file->data, file->data_size);
+		} else
+#endif
+		{
+			xdfree(file->data);
+		}
+	}
+
+	xdebug_hash_destroy(file->records);
+	xdebug_str_destroy(&file->pending);
+	zend_string_release(file->source);
+	xdfree(file->cache_path);
+	xdfree(file);
+}
+
+static int analysis_cache_load_data(xdebug_analysis_cache_file *file)
+{
+#ifndef PHP_WIN32
+	int         fd = open(file->cache_path, O_RDONLY);
+	zend_stat_t sb;
+
+	if (fd == -1) {
+		return 0;
+	}
+
+	if (zend_fstat(fd, &sb) != 0 || sb.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	file->data = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (file->data == MAP_FAILED) {
+		file->data = NULL;
+		return 0;
+	}
+
+	file->data_size = sb.st_size;
+	file->mapped = 1;
+#else
+	FILE *fp = fopen(file->cache_path, "rb");
+	long  size;
+
+	if (!fp) {
+		return 0;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if (size <= 0) {
+		fclose(fp);
+		return 0;
+	}
+
+	file->data = xdmalloc(size);
+	file->data_size = size;
+	if (fread(file->data, 1, size, fp) != (size_t) size) {
+		xdfree(file->data);
+		file->data = NULL;
+		fclose(fp);
+		return 0;
+	}
+	fclose(fp);
+#endif
+
+	return 1;
+}
+
+/* Checks the header, and builds the index of the records. Returns 0 if the
+ * cache file belongs to a different build, or to an older version of the
+ * source file. */
+static int analysis_cache_read_index(xdebug_analysis_cache_file *file)
+{
+	analysis_cache_reader r;
+	char                  magic[4];
+	uint32_t              version, len;
+	int64_t               mtime, size;
+
+	r.p = file->data;
+	r.end = file->data + file->data_size;
+
+	if (!read_bytes(&r, magic, 4) || memcmp(magic, ANALYSIS_CACHE_MAGIC, 4) != 0) {
+		return 0;
+	}
+	if (!read_u32(&r, &version) || version != ANALYSIS_CACHE_VERSION) {
+		return 0;
+	}
+
+	if (!read_u32(&r, &len) || len != strlen(ANALYSIS_CACHE_BUILD) || (size_t) (r.end - r.p) < len || memcmp(r.p, ANALYSIS_CACHE_BUILD, len) != 0) {
+		return 0;
+	}
+	r.p += len;
+
+	if (!read_u32(&r, &len) || len != ZSTR_LEN(file->source) || (size_t) (r.end - r.p) < len || memcmp(r.p, ZSTR_VAL(file->source), len) != 0) {
+		return 0;
+	}
+	r.p += len;
+
+	if (!read_bytes(&r, &mtime, sizeof(int64_t)) || !read_bytes(&r, &size, sizeof(int64_t))) {
+		return 0;
+	}
+	if (mtime != file->mtime || size != file->size) {
+		return 0;
+	}
+
+	file->records_start = r.p - file->data;
+
+	while (r.p < r.end) {
+		const char                   *record_start = r.p;
+		uint64_t                      key;
+		xdebug_analysis_cache_record *record;
+		uint32_t                      flags, last, payload_len;
+
+		if (
+			!read_bytes(&r, &key, sizeof(uint64_t)) ||
+			!read_u32(&r, &flags) || !read_u32(&r, &last) || !read_u32(&r, &payload_len) ||
+			(size_t) (r.end - r.p) < payload_len
+		) {
+			/* A truncated file, keep what was complete */
+			r.p = record_start;
+			break;
+		}
+
+		record = xdmalloc(sizeof(xdebug_analysis_cache_record));
+		record->flags = flags;
+		record->last = last;
+		record->payload = r.p;
+		record->payload_len = payload_len;
+		record->owned_payload = NULL;
+		xdebug_hash_add(file->records, (char*) &key, sizeof(uint64_t), record);
+
+		r.p += payload_len;
+	}
+
+	file->records_end = r.p - file->data;
+
+	return 1;
+}
+
+static xdebug_analysis_cache_file *find_or_open_file(zend_string *source)
+{
+	xdebug_analysis_cache_file *file;
+	zend_stat_t                 sb;
+	char                       *cache_dir = XINI_COV(coverage_cache_dir);
+
+	if (xdebug_hash_find(XG_COV(analysis_cache_files), ZSTR_VAL(source), ZSTR_LEN(source), (void*) &file)) {
+		return file;
+	}
+
+	/* Code that was not loaded from a file, such as eval()'d code, can not be
+	 * tied to a cache file */
+	if (VCWD_STAT(ZSTR_VAL(source), &sb) != 0) {
+		xdebug_hash_add(XG_COV(analysis_cache_files), ZSTR_VAL(source), ZSTR_LEN(source), NULL);
+		return NULL;
+	}
+
+	file = xdcalloc(1, sizeof(xdebug_analysis_cache_file));
+	file->source = zend_string_copy(source);
+	file->mtime = sb.st_mtime;
+	file->size = sb.st_size;
+	file->records = xdebug_hash_alloc(64, analysis_cache_record_dtor);
+	file->cache_path = xdebug_sprintf(
+		"%s%sxdebug-cc.%08lx.%zu",
+		cache_dir, IS_SLASH(cache_dir[strlen(cache_dir) - 1]) ? "" : "/",
+		(unsigned long) xdebug_crc32(ZSTR_VAL(source), ZSTR_LEN(source)) & 0xffffffffUL, ZSTR_LEN(source)
+	);
+
+	if (analysis_cache_load_data(file) && !analysis_cache_read_index(file)) {
+		xdebug_hash_destroy(file->records);
+		file->records = xdebug_hash_alloc(64, analysis_cache_record_dtor);
+		file->records_start = 0;
+	}
+
+	xdebug_hash_add(XG_COV(analysis_cache_files), ZSTR_VAL(source), ZSTR_LEN(source), file);
+
+	return file;
+}
+
+static int analysis_cache_enabled(void)
+{
+#if ZEND_USE_ABS_JMP_ADDR
+	/* Jumps are stored as addresses, which differ between processes */
+	return 0;
+#else
+	char *cache_dir = XINI_COV(coverage_cache_dir);
+
+	return cache_dir && cache_dir[0] != '\0' && XG_COV(analysis_cache_files);
+#endif
+}
+
+static xdebug_set *read_set(analysis_cache_reader *r, unsigned int size)
+{
+	xdebug_set *set = xdebug_set_create(size);
+
+	if (!read_bytes(r, set->setinfo, set_bytes(size))) {
+		xdebug_set_free(set);
+		return NULL;
+	}
+
+	return set;
+}
+
+static int read_branches(analysis_cache_reader *r, xdebug_branch_info *branch_info)
+{
+	uint32_t count, i, j;
+
+	if (!read_bytes(r, branch_info->entry_points->setinfo, set_bytes(branch_info->size))) {
+		return 0;
+	}
+	if (!read_bytes(r, branch_info->starts->setinfo, set_bytes(branch_info->size))) {
+		return 0;
+	}
+	if (!read_bytes(r, branch_info->ends->setinfo, set_bytes(branch_info->size))) {
+		return 0;
+	}
+
+	/* Only the branches at the start positions are used after the analysis */
+	if (!read_u32(r, &count)) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		uint32_t       pos;
+		xdebug_branch *branch;
+
+		if (!read_u32(r, &pos) || pos >= branch_info->size) {
+			return 0;
+		}
+		branch = &branch_info->branches[pos];
+
+		if (
+			!read_u32(r, &branch->start_lineno) || !read_u32(r, &branch->end_lineno) ||
+			!read_u32(r, &branch->end_op) || !read_u32(r, &branch->outs_count) ||
+			branch->outs_count > XDEBUG_BRANCH_MAX_OUTS ||
+			!read_bytes(r, branch->outs, branch->outs_count * sizeof(int))
+		) {
+			return 0;
+		}
+	}
+
+	if (!read_u32(r, &count)) {
+		return 0;
+	}
+	branch_info->path_info.paths = calloc(count ? count : 1, sizeof(xdebug_path*));
+	branch_info->path_info.paths_size = count ? count : 1;
+
+	for (i = 0; i < count; i++) {
+		xdebug_path *path;
+		uint32_t     elements_count;
+
+		if (!read_u32(r, &elements_count) || (size_t) (r->end - r->p) / sizeof(unsigned int) < elements_count) {
+			return 0;
+		}
+
+		path = calloc(1, sizeof(xdebug_path));
+		path->elements_count = elements_count;
+		path->elements_size = elements_count;
+		path->elements = malloc(sizeof(unsigned int) * (elements_count ? elements_count : 1));
+		for (j = 0; j < elements_count; j++) {
+			read_u32(r, &path->elements[j]);
+		}
+
+		branch_info->path_info.paths[branch_info->path_info.paths_count] = path;
+		branch_info->path_info.paths_count++;
+	}
+
+	xdebug_branch_info_index_paths(branch_info);
+
+	return 1;
+}
+
+int xdebug_analysis_cache_find(zend_op_array *op_array, int with_branches, xdebug_set **set, xdebug_branch_info **branch_info)
+{
+	xdebug_analysis_cache_file   *file;
+	xdebug_analysis_cache_record *record;
+	analysis_cache_reader         r;
+	uint64_t                      key;
+
+	if (!analysis_cache_enabled()) {
+		return 0;
+	}
+
+	file = find_or_open_file(op_array->filename);
+	if (!file) {
+		return 0;
+	}
+
+	key = op_array_key(op_array, with_branches);
+	if (!xdebug_hash_find(file->records, (char*) &key, sizeof(uint64_t), (void*) &record)) {
+		return 0;
+	}
+	if (record->last != op_array->last || !(record->flags & RECORD_DEAD_CODE)) {
+		return 0;
+	}
+	if (with_branches && !(record->flags & RECORD_BRANCHES)) {
+		return 0;
+	}
+
+	r.p = record->payload;
+	r.end = record->payload + record->payload_len;
+
+	*set = read_set(&r, op_array->last);
+	if (!*set) {
+		return 0;
+	}
+
+	if (with_branches) {
+		*branch_info = xdebug_branch_info_create(op_array->last);
+
+		if (!read_branches(&r, *branch_info)) {
+			xdebug_branch_info_free(*branch_info);
+			*branch_info = NULL;
+			xdebug_set_free(*set);
+			*set = NULL;
+			return 0;
+		}
+		(*branch_info)->path_limit_reached = !!(record->flags & RECORD_PATH_LIMIT_REACHED);
+	}
+
+	return 1;
+}
+
+static void write_branches(xdebug_str *str, xdebug_branch_info *branch_info)
+{
+	uint32_t count = 0, i;
+
+	xdebug_str_addl(str, (char*) branch_info->entry_points->setinfo, set_bytes(branch_info->size), 0);
+	xdebug_str_addl(str, (char*) branch_info->starts->setinfo, set_bytes(branch_info->size), 0);
+	xdebug_str_addl(str, (char*) branch_info->ends->setinfo, set_bytes(branch_info->size), 0);
+
+	for (i = 0; i < branch_info->size; i++) {
+		if (xdebug_set_in(branch_info->starts, i)) {
+			count++;
+		}
+	}
+	write_u32(str, count);
+
+	for (i = 0; i < branch_info->size; i++) {
+		xdebug_branch *branch = &branch_info->branches[i];
+
+		if (!xdebug_set_in(branch_info->starts, i)) {
+			continue;
+		}
+
+		write_u32(str, i);
+		write_u32(str, branch->start_lineno);
+		write_u32(str, branch->end_lineno);
+		write_u32(str, branch->end_op);
+		write_u32(str, branch->outs_count);
+		xdebug_str_addl(str, (char*) branch->outs, branch->outs_count * sizeof(int), 0);
+	}
+
+	write_u32(str, branch_info->path_info.paths_count);
+	for (i = 0; i < branch_info->path_info.paths_count; i++) {
+		xdebug_path *path = branch_info->path_info.paths[i];
+
+		write_u32(str, path->elements_count);
+		xdebug_str_addl(str, (char*) path->elements, path->elements_count * sizeof(unsigned int), 0);
+	}
+}
+
+/* Needs to be called right after the analysis, before any branch is hit */
+void xdebug_analysis_cache_add(zend_op_array *op_array, xdebug_set *set, xdebug_branch_info *branch_info)
+{
+	xdebug_analysis_cache_file   *file;
+	xdebug_analysis_cache_record *record;
+	xdebug_str                    payload = XDEBUG_STR_INITIALIZER;
+	uint32_t                      flags = RECORD_DEAD_CODE;
+	uint64_t                      key;
+
+	if (!analysis_cache_enabled() || !set) {
+		return;
+	}
+
+	file = find_or_open_file(op_array->filename);
+	if (!file) {
+		return;
+	}
+
+	key = op_array_key(op_array, !!branch_info);
+	if (xdebug_hash_find(file->records, (char*) &key, sizeof(uint64_t), (void*) &record)) {
+		return;
+	}
+
+	xdebug_str_addl(&payload, (char*) set->setinfo, set_bytes(op_array->last), 0);
+	if (branch_info) {
+		flags |= RECORD_BRANCHES;
+		if (branch_info->path_limit_reached) {
+			flags |= RECORD_PATH_LIMIT_REACHED;
+		}
+		write_branches(&payload, branch_info);
+	}
+
+	write_u64(&file->pending, key);
+	write_u32(&file->pending, flags);
+	write_u32(&file->pending, op_array->last);
+	write_u32(&file->pending, payload.l);
+	xdebug_str_addl(&file->pending, payload.d, payload.l, 0);
+
+	/* The record keeps the payload */
+	record = xdmalloc(sizeof(xdebug_analysis_cache_record));
+	record->flags = flags;
+	record->last = op_array->last;
+	record->payload = payload.d;
+	record->payload_len = payload.l;
+	record->owned_payload = payload.d;
+	xdebug_hash_add(file->records, (char*) &key, sizeof(uint64_t), record);
+}
+
+static void analysis_cache_write_file(void *dummy, xdebug_hash_element *e)
+{
+	xdebug_analysis_cache_file *file = (xdebug_analysis_cache_file*) e->ptr;
+	xdebug_str                  header = XDEBUG_STR_INITIALIZER;
+	char                       *tmp_path;
+	FILE                       *fp;
+	int                         ok;
+
+	if (!file || !file->pending.l) {
+		return;
+	}
+
+	xdebug_str_addl(&header, ANALYSIS_CACHE_MAGIC, 4, 0);
+	write_u32(&header, ANALYSIS_CACHE_VERSION);
+	write_u32(&header, strlen(ANALYSIS_CACHE_BUILD));
+	xdebug_str_addl(&header, ANALYSIS_CACHE_BUILD, strlen(ANALYSIS_CACHE_BUILD), 0);
+	write_u32(&header, ZSTR_LEN(file->source));
+	xdebug_str_addl(&header, ZSTR_VAL(file->source), ZSTR_LEN(file->source), 0);
+	xdebug_str_addl(&header, (char*) &file->mtime, sizeof(int64_t), 0);
+	xdebug_str_addl(&header, (char*) &file->size, sizeof(int64_t), 0);
+
+	tmp_path = xdebug_sprintf("%s.%ld.tmp", file->cache_path, (long) xdebug_get_pid());
+	fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		xdebug_log_ex(XLOG_CHAN_COVERAGE, XLOG_WARN, "CACHE", "Can not write the coverage analysis cache file '%s'", tmp_path);
+		xdebug_str_destroy(&header);
+		xdfree(tmp_path);
+		return;
+	}
+
+	ok = fwrite(header.d, 1, header.l, fp) == header.l;
+	if (ok && file->records_start) {
+		ok = fwrite(file->data + file->records_start, 1, file->records_end - file->records_start, fp) == file->records_end - file->records_start;
+	}
+	if (ok) {
+		ok = fwrite(file->pending.d, 1, file->pending.l, fp) == file->pending.l;
+	}
+	ok = (fclose(fp) == 0) && ok;
+
+#ifdef PHP_WIN32
+	if (ok) {
+		unlink(file->cache_path);
+	}
+#endif
+	if (!ok || rename(tmp_path, file->cache_path) != 0) {
+		unlink(tmp_path);
+	}
+
+	xdebug_str_destroy(&header);
+	xdfree(tmp_path);
+}
+
+void xdebug_analysis_cache_rinit(void)
+{
+	XG_COV(analysis_cache_files) = xdebug_hash_alloc(64, analysis_cache_file_dtor);
+}
+
+void xdebug_analysis_cache_post_deactivate(void)
+{
+	if (!XG_COV(analysis_cache_files)) {
+		return;
+	}
+
+	xdebug_hash_apply(XG_COV(analysis_cache_files), NULL, analysis_cache_write_file);
+
+	xdebug_hash_destroy(XG_COV(analysis_cache_files));
+	XG_COV(analysis_cache_files) = NULL;
+}
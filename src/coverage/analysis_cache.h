@@ -0,0 +1,31 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __XDEBUG_COVERAGE_ANALYSIS_CACHE_H__
+#define __XDEBUG_COVERAGE_ANALYSIS_CACHE_H__
+
+#include "lib/php-header.h"
+#include "lib/set.h"
+
+#include "branch_info.h"
+
+void xdebug_analysis_cache_rinit(void);
+void xdebug_analysis_cache_post_deactivate(void);
+
+int  xdebug_analysis_cache_find(zend_op_array *op_array, int with_branches, xdebug_set **set, xdebug_branch_info **branch_info);
+void xdebug_analysis_cache_add(zend_op_array *op_array, xdebug_set *set, xdebug_branch_info *branch_info);
+
+#endif
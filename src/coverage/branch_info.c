@@ -147,7 +147,7 @@ void xdebug_branch_post_process(zend_op_array *opa, xdebug_branch_info *branch_i
 	}
 }
 
-static void xdebug_path_add(xdebug_path *path, unsigned int nr)
+void xdebug_path_add(xdebug_path *path, unsigned int nr)
 {
 	if (!path) {
 		return;
@@ -160,7 +160,7 @@ static void xdebug_path_add(xdebug_path *path, unsigned int nr)
 	path->elements_count++;
 }
 
-static void xdebug_path_info_add_path(xdebug_path_info *path_info, xdebug_path *path)
+void xdebug_path_info_add_path(xdebug_path_info *path_info, xdebug_path *path)
 {
 	if (path_info->paths_count == path_info->paths_size) {
 		path_info->paths_size += 32;
@@ -225,53 +225,93 @@ void xdebug_path_free(xdebug_path *path)
 	free(path);
 }
 
-static unsigned int xdebug_branch_find_last_element(xdebug_path *path)
-{
-	return path->elements[path->elements_count-1];
-}
+/* A step of the path that is being followed, and the out of its branch that
+ * is to be followed next. The stack of steps is the prefix that all paths
+ * that are found from there share. */
+typedef struct _xdebug_path_step {
+	unsigned int nr;
+	unsigned int next_out;
+	int          found;
+} xdebug_path_step;
 
-static int xdebug_path_exists(xdebug_path *path, unsigned int elem1, unsigned int elem2)
+static int xdebug_path_steps_have_edge(xdebug_path_step *steps, unsigned int depth, unsigned int elem1, unsigned int elem2)
 {
 	unsigned int i;
 
-	for (i = 0; i < path->elements_count - 1; i++) {
-		if (path->elements[i] == elem1 && path->elements[i + 1] == elem2) {
+	for (i = 0; i + 1 < depth; i++) {
+		if (steps[i].nr == elem1 && steps[i + 1].nr == elem2) {
 			return 1;
 		}
 	}
 	return 0;
 }
 
-static void xdebug_branch_find_path(unsigned int nr, xdebug_branch_info *branch_info, xdebug_path *prev_path)
+static xdebug_path *xdebug_path_from_steps(xdebug_path_step *steps, unsigned int depth)
 {
-	unsigned int last;
-	xdebug_path *new_path;
-	int found = 0;
-	size_t i = 0;
+	xdebug_path  *path = calloc(1, sizeof(xdebug_path));
+	unsigned int  i;
 
-	if (branch_info->path_info.paths_count > 4095) {
-		return;
+	path->elements_count = depth;
+	path->elements_size = depth;
+	path->elements = malloc(sizeof(unsigned int) * depth);
+	for (i = 0; i < depth; i++) {
+		path->elements[i] = steps[i].nr;
 	}
 
-	new_path = xdebug_path_new(prev_path);
-	xdebug_path_add(new_path, nr);
+	return path;
+}
+
+/* Follows all paths from the branch at 'entry', without following any edge
+ * twice in one path. Returns 0 when 'limit' paths have been found, and there
+ * are more. */
+static int xdebug_branch_find_paths_from(xdebug_branch_info *branch_info, unsigned int entry, unsigned int limit, xdebug_path_step **steps, unsigned int *steps_size)
+{
+	unsigned int depth = 0;
+
+	(*steps)[depth].nr = entry;
+	(*steps)[depth].next_out = 0;
+	(*steps)[depth].found = 0;
+	depth++;
+
+	while (depth > 0) {
+		xdebug_path_step *step = &(*steps)[depth - 1];
+		xdebug_branch    *branch = &branch_info->branches[step->nr];
+		int               out = 0;
 
-	last = xdebug_branch_find_last_element(new_path);
+		while (step->next_out < branch->outs_count) {
+			out = branch->outs[step->next_out++];
 
-	for (i = 0; i < branch_info->branches[nr].outs_count; i++) {
-		int out = branch_info->branches[nr].outs[i];
-		if (out != 0 && out != XDEBUG_JMP_EXIT && !xdebug_path_exists(new_path, last, out)) {
-			xdebug_branch_find_path(out, branch_info, new_path);
-			found = 1;
+			if (out != 0 && out != XDEBUG_JMP_EXIT && !xdebug_path_steps_have_edge(*steps, depth, step->nr, out)) {
+				break;
+			}
+			out = 0;
 		}
-	}
 
-	if (found) {
-		xdebug_path_free(new_path);
-		return;
+		if (out) {
+			step->found = 1;
+
+			if (depth == *steps_size) {
+				*steps_size *= 2;
+				*steps = realloc(*steps, sizeof(xdebug_path_step) * *steps_size);
+			}
+			(*steps)[depth].nr = out;
+			(*steps)[depth].next_out = 0;
+			(*steps)[depth].found = 0;
+			depth++;
+			continue;
+		}
+
+		/* Only paths that can not be followed any further are complete */
+		if (!step->found) {
+			if (limit && branch_info->path_info.paths_count >= limit) {
+				return 0;
+			}
+			xdebug_path_info_add_path(&(branch_info->path_info), xdebug_path_from_steps(*steps, depth));
+		}
+		depth--;
 	}
 
-	xdebug_path_info_add_path(&(branch_info->path_info), new_path);
+	return 1;
 }
 
 xdebug_path_info *xdebug_path_info_ctor(void)
@@ -304,27 +344,37 @@ void xdebug_path_info_dtor(xdebug_path_info *path_info)
 	xdfree(path_info);
 }
 
+/* The key is the binary representation of the path's elements */
 void xdebug_create_key_for_path(xdebug_path *path, xdebug_str *str)
 {
-	unsigned int i;
-	char temp_nr[16];
-
-	for (i = 0; i < path->elements_count; i++) {
-		snprintf(temp_nr, 15, "%u:", path->elements[i]);
-		xdebug_str_add(str, temp_nr, 0);
-	}
+	xdebug_str_addl(str, (char*) path->elements, path->elements_count * sizeof(unsigned int), 0);
 }
 
-void xdebug_branch_find_paths(xdebug_branch_info *branch_info)
+/* Finds at most 'limit' paths, or all of them when 'limit' is 0 */
+void xdebug_branch_find_paths(xdebug_branch_info *branch_info, unsigned int limit)
 {
-	unsigned int i;
+	unsigned int      i;
+	unsigned int      steps_size = 64;
+	xdebug_path_step *steps = malloc(sizeof(xdebug_path_step) * steps_size);
 
 	for (i = 0; i < branch_info->entry_points->size; i++) {
 		if (xdebug_set_in(branch_info->entry_points, i)) {
-			xdebug_branch_find_path(i, branch_info, NULL);
+			if (!xdebug_branch_find_paths_from(branch_info, i, limit, &steps, &steps_size)) {
+				branch_info->path_limit_reached = 1;
+				break;
+			}
 		}
 	}
 
+	free(steps);
+
+	xdebug_branch_info_index_paths(branch_info);
+}
+
+void xdebug_branch_info_index_paths(xdebug_branch_info *branch_info)
+{
+	unsigned int i;
+
 	branch_info->path_info.path_hash = xdebug_hash_alloc(128, NULL);
 
 	for (i = 0; i < branch_info->path_info.paths_count; i++) {
@@ -335,106 +385,176 @@ void xdebug_branch_find_paths(xdebug_branch_info *branch_info)
 	}
 }
 
-void xdebug_branch_info_mark_reached(zend_string *filename, char *function_name, zend_op_array *op_array, long opcode_nr)
+#define VISITED_BRANCHES_INITIAL_SIZE 16
+
+/* 0 marks an empty slot, so both numbers are stored off by one */
+static inline uint64_t visited_branches_key(unsigned int opcode_nr, int last_branch_nr)
 {
-	xdebug_coverage_file *file;
-	xdebug_coverage_function *function;
-	xdebug_branch_info *branch_info;
+	return ((uint64_t) (opcode_nr + 1) << 32) | (uint32_t) (last_branch_nr + 1);
+}
 
-	if (XG_COV(previous_mark_filename) && zend_string_equals(XG_COV(previous_mark_filename), filename)) {
-		file = XG_COV(previous_mark_file);
-	} else {
-		if (!xdebug_hash_find(XG_COV(code_coverage_info), ZSTR_VAL(filename), ZSTR_LEN(filename), (void *) &file)) {
-			return;
+static inline unsigned int visited_branches_slot(xdebug_visited_branches *visited, uint64_t key)
+{
+	return (unsigned int) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (visited->size - 1);
+}
+
+static void visited_branches_insert(xdebug_visited_branches *visited, uint64_t key)
+{
+	unsigned int slot = visited_branches_slot(visited, key);
+
+	while (visited->keys[slot]) {
+		slot = (slot + 1) & (visited->size - 1);
+	}
+
+	visited->keys[slot] = key;
+	visited->count++;
+}
+
+static void visited_branches_grow(xdebug_visited_branches *visited)
+{
+	uint64_t     *old_keys = visited->keys;
+	unsigned int  old_size = visited->size;
+	unsigned int  i;
+
+	visited->size = old_size ? old_size * 2 : VISITED_BRANCHES_INITIAL_SIZE;
+	visited->keys = calloc(visited->size, sizeof(uint64_t));
+	visited->count = 0;
+
+	for (i = 0; i < old_size; i++) {
+		if (old_keys[i]) {
+			visited_branches_insert(visited, old_keys[i]);
 		}
-		if (XG_COV(previous_mark_filename)) {
-			zend_string_release(XG_COV(previous_mark_filename));
+	}
+
+	free(old_keys);
+}
+
+/* Returns 1 if the pair had not been visited yet during this function call */
+int xdebug_visited_branches_add(xdebug_visited_branches *visited, unsigned int function_nr, unsigned int opcode_nr, int last_branch_nr)
+{
+	uint64_t     key = visited_branches_key(opcode_nr, last_branch_nr);
+	unsigned int slot;
+
+	if (visited->function_nr != function_nr) {
+		if (visited->count) {
+			memset(visited->keys, 0, visited->size * sizeof(uint64_t));
+			visited->count = 0;
 		}
-		XG_COV(previous_mark_filename) = zend_string_copy(file->name);
-		XG_COV(previous_mark_file) = file;
+		visited->function_nr = function_nr;
 	}
 
-	/* If there is no branch info, we don't have to do more */
-	if (!file->has_branch_info) {
-		return;
+	if (visited->size) {
+		for (slot = visited_branches_slot(visited, key); visited->keys[slot]; slot = (slot + 1) & (visited->size - 1)) {
+			if (visited->keys[slot] == key) {
+				return 0;
+			}
+		}
 	}
 
-	/* Check if the function already exists in the hash */
-	if (!xdebug_hash_find(file->functions, function_name, strlen(function_name), (void *) &function)) {
-		return;
+	/* Keep the table at most half full */
+	if ((visited->count + 1) * 2 > visited->size) {
+		visited_branches_grow(visited);
 	}
+	visited_branches_insert(visited, key);
 
-	branch_info = function->branch_info;
+	return 1;
+}
+
+void xdebug_visited_branches_free(xdebug_visited_branches *visited)
+{
+	free(visited->keys);
+	visited->keys = NULL;
+	visited->size = 0;
+	visited->count = 0;
+}
+
+void xdebug_branch_info_mark_reached(zend_op_array *op_array, xdebug_branch_info *branch_info, long opcode_nr)
+{
+	unsigned int level = XDEBUG_VECTOR_COUNT(XG_BASE(stack));
 
 	if (opcode_nr != 0 && xdebug_set_in(branch_info->entry_points, opcode_nr)) {
-		xdebug_code_coverage_end_of_function(op_array, filename, function_name);
-		xdebug_code_coverage_start_of_function(op_array, function_name);
+		xdebug_code_coverage_end_of_function(op_array);
+		xdebug_code_coverage_start_of_function(op_array, NULL);
 	}
 
 	if (xdebug_set_in(branch_info->starts, opcode_nr)) {
-		char *key;
-		void *dummy;
+		int                   last_branch_nr = XG_COV(branches).last_branch_nr[level];
 		function_stack_entry *tail_fse = XDEBUG_VECTOR_TAIL(XG_BASE(stack));
 
 		/* Mark out for previous branch, if one is set */
-		if (XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))] != -1) {
+		if (last_branch_nr != -1) {
 			size_t i = 0;
 
-			for (i = 0; i < branch_info->branches[XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))]].outs_count; i++) {
-				if (branch_info->branches[XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))]].outs[i] == opcode_nr) {
-					branch_info->branches[XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))]].outs_hit[i] = 1;
+			for (i = 0; i < branch_info->branches[last_branch_nr].outs_count; i++) {
+				if (branch_info->branches[last_branch_nr].outs[i] == opcode_nr) {
+					branch_info->branches[last_branch_nr].outs_hit[i] = 1;
 				}
 			}
 		}
 
-		key = xdebug_sprintf("%d:%d:%d", opcode_nr, XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))], tail_fse->function_nr);
-
-		if (!xdebug_hash_find(XG_COV(visited_branches), key, strlen(key), (void*) &dummy)) {
-			xdebug_path_add(XG_COV(paths_stack)->paths[XDEBUG_VECTOR_COUNT(XG_BASE(stack))], opcode_nr);
-			xdebug_hash_add(XG_COV(visited_branches), key, strlen(key), NULL);
+		if (xdebug_visited_branches_add(&XG_COV(branches).visited[level], tail_fse->function_nr, opcode_nr, last_branch_nr)) {
+			xdebug_path_add(XG_COV(paths_stack)->paths[level], opcode_nr);
 		}
-		xdfree(key);
 
-		branch_info->branches[opcode_nr].hit = 1;
+		branch_info->branches[opcode_nr].hit = XG_COV(delta).generation;
+		branch_info->branches[opcode_nr].hit_count++;
+		branch_info->generation = XG_COV(delta).generation;
 
-		XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))] = opcode_nr;
+		XG_COV(branches).last_branch_nr[level] = opcode_nr;
 	}
 }
 
-void xdebug_branch_info_mark_end_of_function_reached(zend_string *filename, char *function_name, char *key, int key_len)
+void xdebug_branch_info_mark_end_of_function_reached(xdebug_branch_info *branch_info, char *key, int key_len)
 {
-	xdebug_coverage_file *file;
-	xdebug_coverage_function *function;
-	xdebug_branch_info *branch_info;
 	xdebug_path *path;
 
-	if (XG_COV(previous_mark_filename) && zend_string_equals(XG_COV(previous_mark_filename), filename) == 0) {
-		file = XG_COV(previous_mark_file);
-	} else {
-		if (!xdebug_hash_find(XG_COV(code_coverage_info), ZSTR_VAL(filename), ZSTR_LEN(filename), (void *) &file)) {
-			return;
-		}
-		zend_string_release(XG_COV(previous_mark_filename));
-		XG_COV(previous_mark_filename) = zend_string_copy(file->name);
-		XG_COV(previous_mark_file) = file;
-	}
-
-	/* If there is no branch info, we don't have to do more */
-	if (!file->has_branch_info) {
+	if (!xdebug_hash_find(branch_info->path_info.path_hash, key, key_len, (void *) &path)) {
 		return;
 	}
+	path->hit = XG_COV(delta).generation;
+	path->hit_count++;
+}
 
-	/* Check if the function already exists in the hash */
-	if (!xdebug_hash_find(file->functions, function_name, strlen(function_name), (void *) &function)) {
-		return;
+/* Adds the hits from 'from' to 'branch_info', which both describe the same
+ * function, for example when 'from' was read from another process */
+void xdebug_branch_info_merge_hits(xdebug_branch_info *branch_info, xdebug_branch_info *from)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < from->size && i < branch_info->size; i++) {
+		xdebug_branch *from_branch = &from->branches[i];
+		xdebug_branch *branch = &branch_info->branches[i];
+
+		if (!from_branch->hit || !xdebug_set_in(from->starts, i) || !xdebug_set_in(branch_info->starts, i)) {
+			continue;
+		}
+
+		branch->hit = XG_COV(delta).generation;
+		branch->hit_count += from_branch->hit_count;
+		branch_info->generation = XG_COV(delta).generation;
+
+		for (j = 0; j < from_branch->outs_count && j < branch->outs_count; j++) {
+			if (from_branch->outs_hit[j]) {
+				branch->outs_hit[j] = 1;
+			}
+		}
 	}
 
-	branch_info = function->branch_info;
+	for (i = 0; i < from->path_info.paths_count; i++) {
+		xdebug_path *path;
+		xdebug_str   key = XDEBUG_STR_INITIALIZER;
 
-	if (!xdebug_hash_find(branch_info->path_info.path_hash, key, key_len, (void *) &path)) {
-		return;
+		if (!from->path_info.paths[i]->hit) {
+			continue;
+		}
+
+		xdebug_create_key_for_path(from->path_info.paths[i], &key);
+		if (xdebug_hash_find(branch_info->path_info.path_hash, key.d, key.l, (void *) &path)) {
+			path->hit = XG_COV(delta).generation;
+			path->hit_count += from->path_info.paths[i]->hit_count;
+		}
+		xdfree(key.d);
 	}
-	path->hit = 1;
 }
 
 void xdebug_branch_info_add_branches_and_paths(zend_string *filename, char *function_name, xdebug_branch_info *branch_info)
@@ -468,5 +588,14 @@ void xdebug_branch_info_add_branches_and_paths(zend_string *filename, char *func
 	if (branch_info) {
 		file->has_branch_info = 1;
 	}
+
+	/* Hits that were merged in before this function was analysed here */
+	if (function->from_merge) {
+		if (branch_info) {
+			xdebug_branch_info_merge_hits(branch_info, function->branch_info);
+		}
+		xdebug_branch_info_free(function->branch_info);
+		function->from_merge = 0;
+	}
 	function->branch_info = branch_info;
 }
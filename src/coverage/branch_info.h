@@ -38,7 +38,8 @@ typedef struct _xdebug_branch {
 	unsigned int  start_lineno;
 	unsigned int  end_lineno;
 	unsigned int  end_op;
-	unsigned char hit;
+	unsigned int  hit; /* The coverage generation in which it was last hit, or 0 */
+	uint32_t      hit_count;
 	unsigned int  outs_count;
 	int           outs[XDEBUG_BRANCH_MAX_OUTS];
 	unsigned char outs_hit[XDEBUG_BRANCH_MAX_OUTS];
@@ -48,7 +49,8 @@ typedef struct _xdebug_path {
 	unsigned int elements_count;
 	unsigned int elements_size;
 	unsigned int *elements;
-	unsigned char hit;
+	unsigned int  hit; /* The coverage generation in which it was last hit, or 0 */
+	uint32_t      hit_count;
 } xdebug_path;
 
 /* Contains information for paths that belong to a set of branches (as stored in xdebug_branch_info) */
@@ -66,24 +68,43 @@ typedef struct _xdebug_branch_info {
 	xdebug_set      *starts;   /* A set of opcodes nrs where each branch starts */
 	xdebug_set      *ends;     /* A set of opcodes nrs where each ends starts */
 	xdebug_branch   *branches; /* Information about each branch */
+	unsigned int     generation; /* The coverage generation in which a branch was last hit */
+	unsigned char    path_limit_reached; /* Not all paths were found, because of xdebug.coverage_path_limit */
 
 	xdebug_path_info path_info; /* The paths that can be created out of these branches */
 } xdebug_branch_info;
 
+/* The (branch, previous branch) pairs that have been added to the path of the
+ * function call running at one stack level, in an open addressed table. A
+ * different function_nr means that a new call runs at that level. */
+typedef struct _xdebug_visited_branches {
+	unsigned int  function_nr;
+	unsigned int  size;
+	unsigned int  count;
+	uint64_t     *keys;
+} xdebug_visited_branches;
+
+int  xdebug_visited_branches_add(xdebug_visited_branches *visited, unsigned int function_nr, unsigned int opcode_nr, int last_branch_nr);
+void xdebug_visited_branches_free(xdebug_visited_branches *visited);
+
 xdebug_branch_info *xdebug_branch_info_create(unsigned int size);
 
 void xdebug_branch_info_update(xdebug_branch_info *branch_info, unsigned int pos, unsigned int lineno, unsigned int outidx, unsigned int jump_pos);
 void xdebug_branch_post_process(zend_op_array *opa, xdebug_branch_info *branch_info);
-void xdebug_branch_find_paths(xdebug_branch_info *branch_info);
+void xdebug_branch_find_paths(xdebug_branch_info *branch_info, unsigned int limit);
+void xdebug_branch_info_index_paths(xdebug_branch_info *branch_info);
 
 void xdebug_branch_info_dump(zend_op_array *opa, xdebug_branch_info *branch_info);
 void xdebug_branch_info_add_branches_and_paths(zend_string *filename, char *function_name, xdebug_branch_info *branch_info);
+void xdebug_branch_info_merge_hits(xdebug_branch_info *branch_info, xdebug_branch_info *from);
 void xdebug_branch_info_free(xdebug_branch_info *branch_info);
 
 xdebug_path *xdebug_path_new(xdebug_path *old_path);
+void xdebug_path_add(xdebug_path *path, unsigned int nr);
 void xdebug_path_free(xdebug_path *path);
 
 xdebug_path_info *xdebug_path_info_ctor(void);
+void xdebug_path_info_add_path(xdebug_path_info *path_info, xdebug_path *path);
 void xdebug_path_info_dtor(xdebug_path_info *path_info);
 
 void xdebug_path_info_add_path_for_level(xdebug_path_info *path_info, xdebug_path *path, unsigned int level);
@@ -91,6 +112,6 @@ xdebug_path *xdebug_path_info_get_path_for_level(xdebug_path_info *path_info, un
 
 void xdebug_create_key_for_path(xdebug_path *path, xdebug_str *str);
 
-void xdebug_branch_info_mark_reached(zend_string *filename, char *function_name, zend_op_array *op_array, long opcode_nr);
-void xdebug_branch_info_mark_end_of_function_reached(zend_string *filename, char *function_name, char *key, int key_len);
+void xdebug_branch_info_mark_reached(zend_op_array *op_array, xdebug_branch_info *branch_info, long opcode_nr);
+void xdebug_branch_info_mark_end_of_function_reached(xdebug_branch_info *branch_info, char *key, int key_len);
 #endif
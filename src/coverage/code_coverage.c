@@ -17,12 +17,16 @@
 #include "php_xdebug.h"
 #include "zend_extensions.h"
 
+#include "analysis_cache.h"
 #include "branch_info.h"
 #include "code_coverage_private.h"
 
 #include "base/base.h"
 #include "base/filter.h"
+#include "base/function_identity.h"
 #include "lib/compat.h"
+#include "lib/file.h"
+#include "lib/log.h"
 #include "lib/set.h"
 #include "lib/var.h"
 #include "tracing/tracing.h"
@@ -49,6 +53,10 @@ xdebug_coverage_file *xdebug_coverage_file_ctor(zend_string *filename)
 	file->lines = xdebug_hash_alloc(128, xdebug_coverage_line_dtor);
 	file->functions = xdebug_hash_alloc(128, xdebug_coverage_function_dtor);
 	file->has_branch_info = 0;
+	file->generation = 0;
+	file->dirty_lines_count = 0;
+	file->dirty_lines_size = 0;
+	file->dirty_lines = NULL;
 
 	return file;
 }
@@ -59,6 +67,7 @@ static void xdebug_coverage_file_dtor(void *data)
 
 	xdebug_hash_destroy(file->lines);
 	xdebug_hash_destroy(file->functions);
+	xdfree(file->dirty_lines);
 	zend_string_release(file->name);
 	xdfree(file);
 }
@@ -70,6 +79,7 @@ xdebug_coverage_function *xdebug_coverage_function_ctor(char *function_name)
 	function = xdmalloc(sizeof(xdebug_coverage_function));
 	function->name = xdstrdup(function_name);
 	function->branch_info = NULL;
+	function->from_merge = 0;
 
 	return function;
 }
@@ -149,12 +159,10 @@ static void xdebug_build_fname_from_oparray(xdebug_func *tmp, zend_op_array *opa
 	}
 }
 
-static void xdebug_print_opcode_info(zend_execute_data *execute_data, const zend_op *cur_opcode)
+static char *xdebug_build_function_name_from_oparray(zend_op_array *op_array)
 {
-	zend_op_array *op_array = &execute_data->func->op_array;
 	xdebug_func func_info;
-	char function_name[1024];
-	long opnr = execute_data->opline - execute_data->func->op_array.opcodes;
+	char        function_name[1024];
 
 	xdebug_build_fname_from_oparray(&func_info, op_array);
 	xdebug_func_format(function_name, sizeof(function_name), &func_info);
@@ -168,7 +176,29 @@ static void xdebug_print_opcode_info(zend_execute_data *execute_data, const zend
 		xdfree(func_info.function);
 	}
 
-	xdebug_branch_info_mark_reached(op_array->filename, function_name, op_array, opnr);
+	return xdstrdup(function_name);
+}
+
+static xdebug_branch_info *xdebug_coverage_branch_info_for_op_array(zend_op_array *op_array);
+
+/* Only branch coverage needs to know about each opcode as it gets executed, as
+ * the paths through a function depend on the order */
+static void xdebug_print_opcode_info(zend_execute_data *execute_data, const zend_op *cur_opcode)
+{
+	zend_op_array      *op_array = &execute_data->func->op_array;
+	xdebug_branch_info *branch_info;
+	long                opnr = execute_data->opline - execute_data->func->op_array.opcodes;
+
+	if (!XG_COV(code_coverage_branch_check)) {
+		return;
+	}
+
+	branch_info = xdebug_coverage_branch_info_for_op_array(op_array);
+	if (!branch_info) {
+		return;
+	}
+
+	xdebug_branch_info_mark_reached(op_array, branch_info, opnr);
 }
 
 static int xdebug_check_branch_entry_handler(XDEBUG_OPCODE_HANDLER_ARGS)
@@ -183,10 +213,9 @@ static int xdebug_check_branch_entry_handler(XDEBUG_OPCODE_HANDLER_ARGS)
 	return xdebug_call_original_opcode_handler_if_set(cur_opcode->opcode, XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
 }
 
-static void xdebug_count_line(zend_string *filename, int lineno, int executable, int deadcode)
+static xdebug_coverage_file *find_or_add_file(zend_string *filename)
 {
 	xdebug_coverage_file *file;
-	xdebug_coverage_line *line;
 
 	if (XG_COV(previous_filename) && zend_string_equals(XG_COV(previous_filename), filename)) {
 		file = XG_COV(previous_file);
@@ -205,16 +234,62 @@ static void xdebug_count_line(zend_string *filename, int lineno, int executable,
 		XG_COV(previous_file) = file;
 	}
 
+	return file;
+}
+
+static xdebug_coverage_line *find_or_add_line(xdebug_coverage_file *file, int lineno)
+{
+	xdebug_coverage_line *line;
+
 	/* Check if the line already exists in the hash */
 	if (!xdebug_hash_index_find(file->lines, lineno, (void *) &line)) {
 		line = xdmalloc(sizeof(xdebug_coverage_line));
 		line->lineno = lineno;
 		line->count = 0;
 		line->executable = 0;
+		line->generation = 0;
+		line->hits = 0;
 
 		xdebug_hash_index_add(file->lines, lineno, line);
 	}
 
+	return line;
+}
+
+/* Remembers which lines, and which files, were hit since the last delta, so
+ * that a delta does not need to look at anything else */
+static void mark_line_hit(xdebug_coverage_file *file, xdebug_coverage_line *line)
+{
+	unsigned int generation = XG_COV(delta).generation;
+
+	if (line->generation == generation) {
+		return;
+	}
+	line->generation = generation;
+
+	if (file->generation != generation) {
+		file->generation = generation;
+		file->dirty_lines_count = 0;
+
+		if (XG_COV(delta).files_count == XG_COV(delta).files_size) {
+			XG_COV(delta).files_size = XG_COV(delta).files_size ? XG_COV(delta).files_size * 2 : 64;
+			XG_COV(delta).files = xdrealloc(XG_COV(delta).files, XG_COV(delta).files_size * sizeof(xdebug_coverage_file*));
+		}
+		XG_COV(delta).files[XG_COV(delta).files_count++] = file;
+	}
+
+	if (file->dirty_lines_count == file->dirty_lines_size) {
+		file->dirty_lines_size = file->dirty_lines_size ? file->dirty_lines_size * 2 : 64;
+		file->dirty_lines = xdrealloc(file->dirty_lines, file->dirty_lines_size * sizeof(xdebug_coverage_line*));
+	}
+	file->dirty_lines[file->dirty_lines_count++] = line;
+}
+
+static void xdebug_count_line(zend_string *filename, int lineno, int executable, int deadcode)
+{
+	xdebug_coverage_file *file = find_or_add_file(filename);
+	xdebug_coverage_line *line = find_or_add_line(file, lineno);
+
 	if (executable) {
 		if (line->executable != 1 && deadcode) {
 			line->executable = 2;
@@ -223,7 +298,157 @@ static void xdebug_count_line(zend_string *filename, int lineno, int executable,
 		}
 	} else {
 		line->count++;
+		mark_line_hit(file, line);
+	}
+}
+
+static void xdebug_coverage_counters_dtor(void *data)
+{
+	xdebug_coverage_counters *counters = (xdebug_coverage_counters *) data;
+
+	xdfree(counters->lines);
+	xdfree(counters->hits);
+	xdfree(counters);
+}
+
+/* Consecutive opcodes nearly always belong to the same op_array, so the last
+ * one used is checked before the hash */
+static xdebug_coverage_counters *find_or_add_counters(zend_op_array *op_array)
+{
+	xdebug_coverage_counters *counters = XG_COV(last_counters);
+	uint32_t                  i;
+
+	if (counters && counters->opcodes == op_array->opcodes) {
+		return counters;
+	}
+
+	if (!xdebug_hash_find(XG_COV(op_array_counters), (char*) &op_array->opcodes, sizeof(zend_op*), (void *) &counters)) {
+		counters = xdmalloc(sizeof(xdebug_coverage_counters));
+		counters->opcodes = op_array->opcodes;
+		counters->last = op_array->last;
+		counters->file = find_or_add_file(op_array->filename);
+		counters->lines = xdmalloc(op_array->last * sizeof(uint32_t));
+		counters->hits = xdcalloc(op_array->last, sizeof(uint32_t));
+		counters->branch_info = NULL;
+		counters->generation = 0;
+
+		for (i = 0; i < op_array->last; i++) {
+			counters->lines[i] = op_array->opcodes[i].lineno;
+		}
+
+		xdebug_hash_add(XG_COV(op_array_counters), (char*) &op_array->opcodes, sizeof(zend_op*), counters);
+	}
+
+	/* A new delta also forgets the last used counters, so that this is
+	 * always reached when an op_array runs for the first time in it */
+	if (counters->generation != XG_COV(delta).generation) {
+		counters->generation = XG_COV(delta).generation;
+
+		if (XG_COV(delta).counters_count == XG_COV(delta).counters_size) {
+			XG_COV(delta).counters_size = XG_COV(delta).counters_size ? XG_COV(delta).counters_size * 2 : 64;
+			XG_COV(delta).counters = xdrealloc(XG_COV(delta).counters, XG_COV(delta).counters_size * sizeof(xdebug_coverage_counters*));
+		}
+		counters->delta_index = XG_COV(delta).counters_count;
+		XG_COV(delta).counters[XG_COV(delta).counters_count++] = counters;
+	}
+
+	XG_COV(last_counters) = counters;
+
+	return counters;
+}
+
+/* The branch information is created when the op_array is analysed, which
+ * happens before it runs. Until then, NULL is returned, and not remembered. */
+static xdebug_branch_info *xdebug_coverage_branch_info_for_op_array(zend_op_array *op_array)
+{
+	xdebug_coverage_counters *counters = find_or_add_counters(op_array);
+	xdebug_coverage_function *function;
+	xdebug_function_identity *fi;
+
+	if (counters->branch_info) {
+		return counters->branch_info;
 	}
+
+	if (!counters->file->has_branch_info) {
+		return NULL;
+	}
+
+	fi = xdebug_function_identity_for_op_array(op_array, xdebug_build_function_name_from_oparray);
+	if (!xdebug_hash_find(counters->file->functions, fi->name, fi->name_len, (void *) &function) || function->from_merge) {
+		return NULL;
+	}
+
+	counters->branch_info = function->branch_info;
+
+	return counters->branch_info;
+}
+
+static inline void xdebug_count_opcode(zend_op_array *op_array, const zend_op *opline)
+{
+	xdebug_coverage_counters *counters = find_or_add_counters(op_array);
+	uint32_t                  opnr = opline - op_array->opcodes;
+
+	if (opnr < counters->last) {
+		counters->hits[opnr]++;
+	} else {
+		xdebug_count_line(op_array->filename, opline->lineno, 0, 0);
+	}
+}
+
+/* Each opcode that starts a run of opcodes on the same line counts as the
+ * line being entered, for XDEBUG_CC_HIT_COUNT */
+static void flush_counters(xdebug_coverage_counters *counters)
+{
+	uint32_t i;
+
+	for (i = 0; i < counters->last; i++) {
+		if (counters->hits[i]) {
+			xdebug_coverage_line *line = find_or_add_line(counters->file, counters->lines[i]);
+
+			line->count += counters->hits[i];
+			if (i == 0 || counters->lines[i] != counters->lines[i - 1]) {
+				line->hits += counters->hits[i];
+			}
+			counters->hits[i] = 0;
+			mark_line_hit(counters->file, line);
+		}
+	}
+}
+
+static void flush_counters_from_hash(void *dummy, xdebug_hash_element *e)
+{
+	flush_counters((xdebug_coverage_counters *) e->ptr);
+}
+
+/* Folds all the hits that have been counted so far into the lines of each
+ * file */
+static void xdebug_coverage_flush_counters(void)
+{
+	if (!XG_COV(op_array_counters)) {
+		return;
+	}
+
+	xdebug_hash_apply(XG_COV(op_array_counters), NULL, flush_counters_from_hash);
+}
+
+/* Starts a new delta, after which only what runs from now on is dirty */
+static void xdebug_coverage_start_delta(void)
+{
+	XG_COV(delta).generation++;
+	XG_COV(delta).files_count = 0;
+	XG_COV(delta).counters_count = 0;
+	XG_COV(last_counters) = NULL;
+}
+
+static void xdebug_coverage_reset_counters(void)
+{
+	xdebug_coverage_start_delta();
+
+	if (XG_COV(op_array_counters)) {
+		xdebug_hash_destroy(XG_COV(op_array_counters));
+	}
+	XG_COV(op_array_counters) = xdebug_hash_alloc(1024, xdebug_coverage_counters_dtor);
+	XG_COV(last_counters) = NULL;
 }
 
 static int xdebug_common_override_handler(XDEBUG_OPCODE_HANDLER_ARGS)
@@ -232,22 +457,42 @@ static int xdebug_common_override_handler(XDEBUG_OPCODE_HANDLER_ARGS)
 	const zend_op *cur_opcode = execute_data->opline;
 
 	if (!op_array->reserved[XG_COV(code_coverage_filter_offset)] && XG_COV(code_coverage_active)) {
-		int      lineno;
-
-		lineno = cur_opcode->lineno;
-
 		xdebug_print_opcode_info(execute_data, cur_opcode);
-		xdebug_count_line(op_array->filename, lineno, 0, 0);
+		xdebug_count_opcode(op_array, cur_opcode);
 	}
 
 	return xdebug_call_original_opcode_handler_if_set(cur_opcode->opcode, XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
 }
 
+/* Code that eval() compiles does not go through xdebug_coverage_compile_file(),
+ * and runtime declarations can add functions and classes too, which the next
+ * function call then analyses */
+static void xdebug_coverage_mark_tables_changed(void)
+{
+	if (XG_COV(code_coverage_active) && XG_COV(code_coverage_unused)) {
+		XG_COV(prefill_tables_changed) = 1;
+	}
+}
+
+static int xdebug_coverage_declare_handler(XDEBUG_OPCODE_HANDLER_ARGS)
+{
+	xdebug_coverage_mark_tables_changed();
+
+	if (execute_data->opline->opcode == ZEND_DECLARE_FUNCTION) {
+		return xdebug_check_branch_entry_handler(XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
+	}
+
+	return xdebug_common_override_handler(XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
+}
+
 static int xdebug_coverage_include_or_eval_handler(XDEBUG_OPCODE_HANDLER_ARGS)
 {
 	zend_op_array *op_array = &execute_data->func->op_array;
 	const zend_op *opline = execute_data->opline;
 
+	if (opline->extended_value == ZEND_EVAL) {
+		xdebug_coverage_mark_tables_changed();
+	}
 	xdebug_coverage_record_if_active(execute_data, op_array);
 
 	return xdebug_call_original_opcode_handler_if_set(opline->opcode, XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
@@ -519,13 +764,22 @@ static void prefill_from_oparray(zend_string *filename, zend_op_array *op_array)
 	}
 
 	/* Run dead code analysis if requested */
-	if (XG_COV(code_coverage_dead_code_analysis) && (op_array->fn_flags & ZEND_ACC_DONE_PASS_TWO)) {
+	if (
+		XG_COV(code_coverage_dead_code_analysis) && (op_array->fn_flags & ZEND_ACC_DONE_PASS_TWO) &&
+		!xdebug_analysis_cache_find(op_array, XG_COV(code_coverage_branch_check), &set, &branch_info)
+	) {
 		set = xdebug_set_create(op_array->last);
 		if (XG_COV(code_coverage_branch_check)) {
 			branch_info = xdebug_branch_info_create(op_array->last);
 		}
 
 		xdebug_analyse_oparray(op_array, set, branch_info);
+		if (branch_info) {
+			xdebug_branch_post_process(op_array, branch_info);
+			xdebug_branch_find_paths(branch_info, XINI_COV(coverage_path_limit) > 0 ? (unsigned int) XINI_COV(coverage_path_limit) : 0);
+		}
+
+		xdebug_analysis_cache_add(op_array, set, branch_info);
 	}
 
 	/* The normal loop then finally */
@@ -554,8 +808,14 @@ static void prefill_from_oparray(zend_string *filename, zend_op_array *op_array)
 			xdfree(func_info.function);
 		}
 
-		xdebug_branch_post_process(op_array, branch_info);
-		xdebug_branch_find_paths(branch_info);
+		if (branch_info->path_limit_reached) {
+			xdebug_log_ex(
+				XLOG_CHAN_COVERAGE, XLOG_WARN, "PATHLIMIT",
+				"Function '%s' in '%s' has more than %u paths (xdebug.coverage_path_limit), only these are collected",
+				function_name, ZSTR_VAL(filename), branch_info->path_info.paths_count
+			);
+		}
+
 		xdebug_branch_info_add_branches_and_paths(filename, (char*) function_name, branch_info);
 	}
 
@@ -603,14 +863,16 @@ static int prefill_from_class_table(zend_class_entry *ce)
 	return ZEND_HASH_APPLY_KEEP;
 }
 
-static void xdebug_prefill_code_coverage(zend_op_array *op_array)
+/* Analyses the functions and classes that were added to the global tables
+ * since the last time. This only runs when code coverage starts, after a file
+ * got compiled, and after code declared functions or classes, so that most
+ * function calls never need to walk these tables. */
+static void xdebug_prefill_code_coverage_from_tables(void)
 {
 	zend_op_array    *function_op_array;
 	zend_class_entry *class_entry;
 
-	if ((long) op_array->reserved[XG_COV(dead_code_analysis_tracker_offset)] < XG_COV(dead_code_last_start_id)) {
-		prefill_from_oparray(op_array->filename, op_array);
-	}
+	XG_COV(prefill_tables_changed) = 0;
 
 	ZEND_HASH_REVERSE_FOREACH_PTR(CG(function_table), function_op_array) {
 		if (_idx == XG_COV(prefill_function_count)) {
@@ -629,12 +891,23 @@ static void xdebug_prefill_code_coverage(zend_op_array *op_array)
 	XG_COV(prefill_class_count) = CG(class_table)->nNumUsed;
 }
 
+static void xdebug_prefill_code_coverage(zend_op_array *op_array)
+{
+	if ((long) op_array->reserved[XG_COV(dead_code_analysis_tracker_offset)] < XG_COV(dead_code_last_start_id)) {
+		prefill_from_oparray(op_array->filename, op_array);
+	}
+}
+
 void xdebug_code_coverage_start_of_function(zend_op_array *op_array, char *function_name)
 {
 	xdebug_path *path = xdebug_path_new(NULL);
 	int orig_size = XG_COV(branches).size;
 
 	xdebug_prefill_code_coverage(op_array);
+	if (XG_COV(prefill_tables_changed)) {
+		xdebug_prefill_code_coverage_from_tables();
+	}
+
 	xdebug_path_info_add_path_for_level(XG_COV(paths_stack), path, XDEBUG_VECTOR_COUNT(XG_BASE(stack)));
 
 	if (orig_size == 0 || XDEBUG_VECTOR_COUNT(XG_BASE(stack)) >= orig_size) {
@@ -642,28 +915,32 @@ void xdebug_code_coverage_start_of_function(zend_op_array *op_array, char *funct
 
 		XG_COV(branches).size = XDEBUG_VECTOR_COUNT(XG_BASE(stack)) + 32;
 		XG_COV(branches).last_branch_nr = realloc(XG_COV(branches).last_branch_nr, sizeof(int) * XG_COV(branches.size));
+		XG_COV(branches).visited = realloc(XG_COV(branches).visited, sizeof(xdebug_visited_branches) * XG_COV(branches.size));
 		for (i = orig_size; i < XG_COV(branches).size; i++) {
 			XG_COV(branches).last_branch_nr[i] = -1;
+			memset(&XG_COV(branches).visited[i], 0, sizeof(xdebug_visited_branches));
 		}
 	}
 
 	XG_COV(branches).last_branch_nr[XDEBUG_VECTOR_COUNT(XG_BASE(stack))] = -1;
 }
 
-void xdebug_code_coverage_end_of_function(zend_op_array *op_array, zend_string *filename, char *function_name)
+void xdebug_code_coverage_end_of_function(zend_op_array *op_array)
 {
-	xdebug_str str = XDEBUG_STR_INITIALIZER;
-	xdebug_path *path = xdebug_path_info_get_path_for_level(XG_COV(paths_stack), XDEBUG_VECTOR_COUNT(XG_BASE(stack)));
+	xdebug_str          str = XDEBUG_STR_INITIALIZER;
+	xdebug_path        *path = xdebug_path_info_get_path_for_level(XG_COV(paths_stack), XDEBUG_VECTOR_COUNT(XG_BASE(stack)));
+	xdebug_branch_info *branch_info;
 
 	if (!path || !path->elements) {
 		return;
 	}
 
-	xdebug_create_key_for_path(path, &str);
-
-	xdebug_branch_info_mark_end_of_function_reached(filename, function_name, str.d, str.l);
-
-	xdfree(str.d);
+	branch_info = xdebug_coverage_branch_info_for_op_array(op_array);
+	if (branch_info) {
+		xdebug_create_key_for_path(path, &str);
+		xdebug_branch_info_mark_end_of_function_reached(branch_info, str.d, str.l);
+		xdfree(str.d);
+	}
 
 	if (path) {
 		xdebug_path_free(path);
@@ -686,8 +963,16 @@ PHP_FUNCTION(xdebug_start_code_coverage)
 	XG_COV(code_coverage_unused) = (options & XDEBUG_CC_OPTION_UNUSED);
 	XG_COV(code_coverage_dead_code_analysis) = (options & XDEBUG_CC_OPTION_DEAD_CODE);
 	XG_COV(code_coverage_branch_check) = (options & XDEBUG_CC_OPTION_BRANCH_CHECK);
+	XG_COV(code_coverage_hit_count) = (options & XDEBUG_CC_OPTION_HIT_COUNT);
 
 	XG_COV(code_coverage_active) = 1;
+
+	/* What has been loaded so far is looked at now, and after that only what
+	 * gets compiled or declared */
+	if (XG_COV(code_coverage_unused)) {
+		xdebug_prefill_code_coverage_from_tables();
+	}
+
 	RETURN_TRUE;
 }
 
@@ -712,11 +997,7 @@ PHP_FUNCTION(xdebug_stop_code_coverage)
 		}
 		XG_COV(previous_filename) = NULL;
 		XG_COV(previous_file) = NULL;
-		if (XG_COV(previous_mark_filename)) {
-			zend_string_release(XG_COV(previous_mark_filename));
-		}
-		XG_COV(previous_mark_filename) = NULL;
-		XG_COV(previous_mark_file) = NULL;
+		xdebug_coverage_reset_counters();
 		xdebug_hash_destroy(XG_COV(code_coverage_info));
 		XG_COV(code_coverage_info) = xdebug_hash_alloc(32, xdebug_coverage_file_dtor);
 		XG_COV(dead_code_last_start_id)++;
@@ -741,19 +1022,38 @@ static int xdebug_lineno_cmp(Bucket *f, Bucket *s)
 }
 
 
+/* With XDEBUG_CC_HIT_COUNT, how often a line, branch, or path was hit is
+ * returned instead of 1. A line that was only jumped into halfway still counts
+ * once. */
+#define XDEBUG_COVERAGE_HITS(hit, hit_count) \
+	(XG_COV(code_coverage_hit_count) ? ((hit_count) ? (zend_long) (hit_count) : ((hit) ? 1 : 0)) : ((hit) ? 1 : 0))
+
+/* Only lines that were reset after a fork are neither hit, nor executable */
+#define LINE_IS_KNOWN(l) ((l)->executable || (l)->count)
+
+static zend_long line_status(xdebug_coverage_line *line)
+{
+	if (line->executable && (line->count == 0)) {
+		return -line->executable;
+	}
+
+	return XDEBUG_COVERAGE_HITS(1, line->hits);
+}
+
 static void add_line(void *ret, xdebug_hash_element *e)
 {
 	xdebug_coverage_line *line = (xdebug_coverage_line*) e->ptr;
 	zval                 *retval = (zval*) ret;
 
-	if (line->executable && (line->count == 0)) {
-		add_index_long(retval, line->lineno, -line->executable);
-	} else {
-		add_index_long(retval, line->lineno, 1);
+	if (!LINE_IS_KNOWN(line)) {
+		return;
 	}
+
+	add_index_long(retval, line->lineno, line_status(line));
 }
 
-static void add_branches(zval *retval, xdebug_branch_info *branch_info)
+/* With a generation, only the branches that were hit in it are added */
+static void add_branches(zval *retval, xdebug_branch_info *branch_info, unsigned int generation)
 {
 	zval *branches, *branch, *out, *out_hit;
 	unsigned int i;
@@ -762,6 +1062,9 @@ static void add_branches(zval *retval, xdebug_branch_info *branch_info)
 	array_init(branches);
 
 	for (i = 0; i < branch_info->starts->size; i++) {
+		if (generation && branch_info->branches[i].hit != generation) {
+			continue;
+		}
 		if (xdebug_set_in(branch_info->starts, i)) {
 			size_t j = 0;
 
@@ -772,7 +1075,7 @@ static void add_branches(zval *retval, xdebug_branch_info *branch_info)
 			add_assoc_long(branch, "line_start", branch_info->branches[i].start_lineno);
 			add_assoc_long(branch, "line_end", branch_info->branches[i].end_lineno);
 
-			add_assoc_long(branch, "hit", branch_info->branches[i].hit);
+			add_assoc_long(branch, "hit", XDEBUG_COVERAGE_HITS(branch_info->branches[i].hit, branch_info->branches[i].hit_count));
 
 			XDEBUG_MAKE_STD_ZVAL(out);
 			array_init(out);
@@ -804,7 +1107,7 @@ static void add_branches(zval *retval, xdebug_branch_info *branch_info)
 	efree(branches);
 }
 
-static void add_paths(zval *retval, xdebug_branch_info *branch_info)
+static void add_paths(zval *retval, xdebug_branch_info *branch_info, unsigned int generation)
 {
 	zval *paths, *path, *path_container;
 	unsigned int i, j;
@@ -813,6 +1116,10 @@ static void add_paths(zval *retval, xdebug_branch_info *branch_info)
 	array_init(paths);
 
 	for (i = 0; i < branch_info->path_info.paths_count; i++) {
+		if (generation && branch_info->path_info.paths[i]->hit != generation) {
+			continue;
+		}
+
 		XDEBUG_MAKE_STD_ZVAL(path);
 		array_init(path);
 
@@ -824,7 +1131,7 @@ static void add_paths(zval *retval, xdebug_branch_info *branch_info)
 		}
 
 		add_assoc_zval(path_container, "path", path);
-		add_assoc_long(path_container, "hit", branch_info->path_info.paths[i]->hit);
+		add_assoc_long(path_container, "hit", XDEBUG_COVERAGE_HITS(branch_info->path_info.paths[i]->hit, branch_info->path_info.paths[i]->hit_count));
 
 		add_next_index_zval(paths, path_container);
 
@@ -847,8 +1154,12 @@ static void add_cc_function(void *ret, xdebug_hash_element *e)
 	array_init(function_info);
 
 	if (function->branch_info) {
-		add_branches(function_info, function->branch_info);
-		add_paths(function_info, function->branch_info);
+		add_branches(function_info, function->branch_info, 0);
+		add_paths(function_info, function->branch_info, 0);
+
+		if (function->branch_info->path_limit_reached) {
+			add_assoc_bool_ex(function_info, "path_limit_reached", HASH_KEY_SIZEOF("path_limit_reached"), 1);
+		}
 	}
 
 	add_assoc_zval_ex(retval, function->name, HASH_KEY_STRLEN(function->name), function_info);
@@ -904,128 +1215,829 @@ PHP_FUNCTION(xdebug_get_code_coverage)
 		return;
 	}
 
+	merge_forked_code_coverage();
+	xdebug_coverage_flush_counters();
+
 	xdebug_hash_apply(XG_COV(code_coverage_info), (void *) return_value, add_file);
 }
 
-PHP_FUNCTION(xdebug_get_function_count)
+/* Writes the same information as xdebug_get_code_coverage() returns, one
+ * record per line, without creating any PHP arrays. The format is described
+ * in contrib/coverage-reader.php, which reads it back. */
+static int coverage_line_cmp(const void *a, const void *b)
 {
-	RETURN_LONG(XG_BASE(function_count));
-}
+	const xdebug_coverage_line *line_a = *(const xdebug_coverage_line**) a;
+	const xdebug_coverage_line *line_b = *(const xdebug_coverage_line**) b;
 
-PHP_FUNCTION(xdebug_code_coverage_started)
-{
-	RETURN_BOOL(XG_COV(code_coverage_active));
+	return (line_a->lineno > line_b->lineno) - (line_a->lineno < line_b->lineno);
 }
 
-void xdebug_init_coverage_globals(xdebug_coverage_globals_t *xg)
+static void collect_line(void *next, xdebug_hash_element *e)
 {
-	xg->previous_filename    = NULL;
-	xg->previous_file        = NULL;
-	xg->previous_mark_filename = NULL;
-	xg->previous_mark_file     = NULL;
-	xg->paths_stack = NULL;
-	xg->branches.size        = 0;
-	xg->branches.last_branch_nr = NULL;
-	xg->code_coverage_active = 0;
+	xdebug_coverage_line ***next_line = (xdebug_coverage_line***) next;
 
-	/* Get reserved offset */
-	xg->dead_code_analysis_tracker_offset = zend_xdebug_cc_run_offset;
-	xg->dead_code_last_start_id = 1;
-	xg->code_coverage_filter_offset = zend_xdebug_filter_offset;
+	**next_line = (xdebug_coverage_line*) e->ptr;
+	(*next_line)++;
 }
 
-void xdebug_coverage_count_line_if_active(zend_op_array *op_array, zend_string *file, int lineno)
+static void dump_branches(xdebug_file *out, xdebug_branch_info *branch_info)
 {
-	if (XG_COV(code_coverage_active) && !op_array->reserved[XG_COV(code_coverage_filter_offset)]) {
-		xdebug_count_line(file, lineno, 0, 0);
-	}
-}
+	unsigned int i;
+	size_t       j;
 
-void xdebug_coverage_count_line_if_branch_check_active(zend_op_array *op_array, zend_string *file, int lineno)
-{
-	if (XG_COV(code_coverage_active) && XG_COV(code_coverage_branch_check)) {
-		xdebug_coverage_count_line_if_active(op_array, file, lineno);
+	for (i = 0; i < branch_info->starts->size; i++) {
+		xdebug_branch *branch = &branch_info->branches[i];
+
+		if (!xdebug_set_in(branch_info->starts, i)) {
+			continue;
+		}
+
+		xdebug_file_printf(out, "branch %u %u %u %u " ZEND_LONG_FMT, i, branch->end_op, branch->start_lineno, branch->end_lineno, XDEBUG_COVERAGE_HITS(branch->hit, branch->hit_count));
+		for (j = 0; j < branch->outs_count; j++) {
+			if (branch->outs[j]) {
+				xdebug_file_printf(out, " %zu:%d:%d", j, branch->outs[j], branch->outs_hit[j]);
+			}
+		}
+		xdebug_file_printf(out, "\n");
 	}
 }
 
-void xdebug_coverage_record_if_active(zend_execute_data *execute_data, zend_op_array *op_array)
+static void dump_paths(xdebug_file *out, xdebug_branch_info *branch_info)
 {
-	if (!op_array->reserved[XG_COV(code_coverage_filter_offset)] && XG_COV(code_coverage_active)) {
-		xdebug_print_opcode_info(execute_data, execute_data->opline);
+	unsigned int i, j;
+
+	for (i = 0; i < branch_info->path_info.paths_count; i++) {
+		xdebug_path *path = branch_info->path_info.paths[i];
+
+		xdebug_file_printf(out, "path " ZEND_LONG_FMT, XDEBUG_COVERAGE_HITS(path->hit, path->hit_count));
+		for (j = 0; j < path->elements_count; j++) {
+			xdebug_file_printf(out, " %u", path->elements[j]);
+		}
+		xdebug_file_printf(out, "\n");
 	}
 }
 
-void xdebug_coverage_compile_file(zend_op_array *op_array)
+static void dump_cc_function(void *out, xdebug_hash_element *e)
 {
-	if (XG_COV(code_coverage_active) && XG_COV(code_coverage_unused) && (op_array->fn_flags & ZEND_ACC_DONE_PASS_TWO)) {
-		xdebug_prefill_code_coverage(op_array);
+	xdebug_coverage_function *function = (xdebug_coverage_function*) e->ptr;
+
+	xdebug_file_printf((xdebug_file*) out, "function %s\n", function->name);
+
+	if (function->branch_info) {
+		dump_branches((xdebug_file*) out, function->branch_info);
+		dump_paths((xdebug_file*) out, function->branch_info);
 	}
 }
 
-int xdebug_coverage_execute_ex(function_stack_entry *fse, zend_op_array *op_array, zend_string **tmp_filename, char **tmp_function_name)
+static void dump_file(void *out, xdebug_hash_element *e)
 {
-	xdebug_func func_info;
+	xdebug_coverage_file  *file = (xdebug_coverage_file*) e->ptr;
+	xdebug_coverage_line **lines, **next;
+	size_t                 i, count = file->lines->size;
 
-	if (!fse->filtered_code_coverage && XG_COV(code_coverage_active) && XG_COV(code_coverage_unused)) {
-		char buffer[1024];
-
-		*tmp_filename = zend_string_copy(op_array->filename);
-		xdebug_build_fname_from_oparray(&func_info, op_array);
-		xdebug_func_format(buffer, sizeof(buffer), &func_info);
-		*tmp_function_name = xdstrdup(buffer);
-		xdebug_code_coverage_start_of_function(op_array, *tmp_function_name);
+	xdebug_file_printf((xdebug_file*) out, "file %s\n", ZSTR_VAL(file->name));
 
-		if (func_info.object_class) {
-			zend_string_release(func_info.object_class);
-		}
-		if (func_info.scope_class) {
-			zend_string_release(func_info.scope_class);
-		}
-		if (func_info.function) {
-			xdfree(func_info.function);
+	/* Sort on linenumber */
+	lines = xdmalloc(sizeof(xdebug_coverage_line*) * (count ? count : 1));
+	next = lines;
+	xdebug_hash_apply(file->lines, (void *) &next, collect_line);
+	qsort(lines, count, sizeof(xdebug_coverage_line*), coverage_line_cmp);
+
+	for (i = 0; i < count; i++) {
+		if (LINE_IS_KNOWN(lines[i])) {
+			xdebug_file_printf((xdebug_file*) out, "line %d " ZEND_LONG_FMT "\n", lines[i]->lineno, line_status(lines[i]));
 		}
-		return 1;
 	}
+	xdfree(lines);
 
-	return 0;
-}
-
-void xdebug_coverage_execute_ex_end(function_stack_entry *fse, zend_op_array *op_array, zend_string *tmp_filename, char *tmp_function_name)
-{
-	/* Check which path has been used */
-	if (!fse->filtered_code_coverage && XG_COV(code_coverage_active) && XG_COV(code_coverage_unused)) {
-		xdebug_code_coverage_end_of_function(op_array, tmp_filename, tmp_function_name);
+	if (XG_COV(code_coverage_branch_check)) {
+		xdebug_hash_apply(file->functions, out, dump_cc_function);
 	}
-	xdfree(tmp_function_name);
-	zend_string_release(tmp_filename);
 }
 
-void xdebug_coverage_init_oparray(zend_op_array *op_array)
+/* Returns the name of the file that was written, which the caller needs to
+ * free, or NULL */
+static char *dump_code_coverage(const char *fname, const char *extension)
 {
-	function_stack_entry tmp_fse;
+	char        *tmp_fname;
+	char        *written_fname;
+	xdebug_file *out;
 
-	if (XG_BASE(filter_type_code_coverage) == XDEBUG_FILTER_NONE) {
-		op_array->reserved[XG_COV(dead_code_analysis_tracker_offset)] = 0;
-		return;
+	xdebug_coverage_flush_counters();
+
+	/* xdebug_fopen() might shorten the name in place */
+	tmp_fname = xdstrdup(fname);
+
+	out = xdebug_file_ctor();
+	if (!xdebug_file_open(out, tmp_fname, extension, "w")) {
+		xdebug_file_dtor(out);
+		xdfree(tmp_fname);
+		return NULL;
 	}
+	xdfree(tmp_fname);
 
-	tmp_fse.filename = op_array->filename;
-	xdebug_build_fname_from_oparray(&tmp_fse.function, op_array);
-	xdebug_filter_run_internal(&tmp_fse, XDEBUG_FILTER_CODE_COVERAGE, &tmp_fse.filtered_code_coverage, XG_BASE(filter_type_code_coverage), XG_BASE(filters_code_coverage));
-	xdebug_func_dtor_by_ref(&tmp_fse.function);
+	xdebug_file_printf(out, "version: 1\ncreator: xdebug %s (PHP %s)\n", XDEBUG_VERSION, PHP_VERSION);
+	xdebug_file_printf(out, "branch_check: %d\n", XG_COV(code_coverage_branch_check) ? 1 : 0);
+	xdebug_file_printf(out, "hit_count: %d\n\n", XG_COV(code_coverage_hit_count) ? 1 : 0);
 
-	op_array->reserved[XG_COV(code_coverage_filter_offset)] = (void*) (size_t) tmp_fse.filtered_code_coverage;
+	xdebug_hash_apply(XG_COV(code_coverage_info), (void *) out, dump_file);
+
+	written_fname = xdstrdup(out->name);
+
+	xdebug_file_close(out);
+	xdebug_file_dtor(out);
+
+	return written_fname;
 }
 
-static int xdebug_switch_handler(XDEBUG_OPCODE_HANDLER_ARGS)
+/* Merging of coverage that xdebug_dump_code_coverage() wrote, usually in
+ * another process. Lines and branches that were hit there count as hit in
+ * the current delta. */
+static char *next_record(char **p, char *end, size_t *len)
 {
-	const zend_op *cur_opcode = execute_data->opline;
+	char *line = *p;
+	char *eol;
 
-	if (!XG_COV(code_coverage_active)) {
-		return xdebug_call_original_opcode_handler_if_set(cur_opcode->opcode, XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
+	if (line >= end) {
+		return NULL;
 	}
 
-	execute_data->opline++;
+	eol = memchr(line, '\n', end - line);
+	if (!eol) {
+		eol = end;
+	}
+
+	*len = eol - line;
+	*p = eol < end ? eol + 1 : end;
+
+	return line;
+}
+
+#define RECORD_IS(l,len,t) ((len) >= sizeof(t) - 1 && strncmp((l), (t), sizeof(t) - 1) == 0)
+
+/* The status is either a hit count, or -1 and -2 for lines that were not
+ * hit */
+static void merge_line(xdebug_coverage_file *file, char *s)
+{
+	int                   lineno = strtol(s, &s, 10);
+	xdebug_coverage_line *line = find_or_add_line(file, lineno);
+	zend_ulong            hits;
+	long                  status;
+
+	while (*s == ' ') {
+		s++;
+	}
+
+	if (*s != '-') {
+		hits = ZEND_STRTOUL(s, &s, 10);
+		if (hits > 0) {
+			line->count++;
+			line->hits += hits;
+			mark_line_hit(file, line);
+		}
+		return;
+	}
+
+	status = strtol(s, &s, 10);
+	if (status == -1) {
+		line->executable = 1;
+	} else if (status == -2 && line->executable != 1) {
+		line->executable = 2;
+	}
+}
+
+/* A merge file from a forked child is not trusted to have a sensible size
+ * for the branch information of a function that this process does not know
+ * about. No function that PHP compiles in practice comes near this many
+ * opcodes. */
+#define MERGE_MAX_OPS (1024 * 1024)
+
+/* Creates the branch information for the branch and path records that
+ * follow a function record, and are only read afterwards. Returns NULL when
+ * a branch ends outside of the function, as far as it is known. */
+static xdebug_branch_info *branch_info_for_records(xdebug_coverage_file *file, const char *function_name, char *p, char *end)
+{
+	xdebug_coverage_function *function;
+	char                     *line;
+	size_t                    len;
+	unsigned long             size = 0;
+	unsigned long             max_size = MERGE_MAX_OPS;
+
+	if (
+		xdebug_hash_find(file->functions, function_name, strlen(function_name), (void *) &function) &&
+		function->branch_info && !function->from_merge
+	) {
+		max_size = function->branch_info->size;
+	}
+
+	while ((line = next_record(&p, end, &len)) != NULL && RECORD_IS(line, len, "branch ")) {
+		char          *s = line + 7;
+		unsigned long  op_end;
+
+		strtoul(s, &s, 10);
+		op_end = strtoul(s, &s, 10);
+
+		if (op_end >= max_size) {
+			return NULL;
+		}
+		if (op_end >= size) {
+			size = op_end + 1;
+		}
+	}
+
+	return size > 0 ? xdebug_branch_info_create(size) : NULL;
+}
+
+static void merge_branch(xdebug_branch_info *branch_info, char *s)
+{
+	unsigned long  op_start = strtoul(s, &s, 10);
+	xdebug_branch *branch;
+
+	if (op_start >= branch_info->size) {
+		return;
+	}
+
+	branch = &branch_info->branches[op_start];
+	xdebug_set_add(branch_info->starts, op_start);
+
+	branch->end_op = strtoul(s, &s, 10);
+	branch->start_lineno = strtoul(s, &s, 10);
+	branch->end_lineno = strtoul(s, &s, 10);
+	branch->hit_count = strtoul(s, &s, 10);
+	branch->hit = branch->hit_count ? XG_COV(delta).generation : 0;
+
+	while (*s == ' ') {
+		unsigned long index = strtoul(s + 1, &s, 10);
+		int           out, out_hit;
+
+		if (*s != ':') {
+			return;
+		}
+		out = strtol(s + 1, &s, 10);
+		if (*s != ':') {
+			return;
+		}
+		out_hit = strtol(s + 1, &s, 10);
+
+		if (index < XDEBUG_BRANCH_MAX_OUTS) {
+			branch->outs[index] = out;
+			branch->outs_hit[index] = out_hit ? 1 : 0;
+			if (index + 1 > branch->outs_count) {
+				branch->outs_count = index + 1;
+			}
+		}
+	}
+}
+
+static void merge_path(xdebug_branch_info *branch_info, char *s)
+{
+	xdebug_path *path = xdebug_path_new(NULL);
+
+	path->hit_count = strtoul(s, &s, 10);
+	path->hit = path->hit_count ? XG_COV(delta).generation : 0;
+	while (*s == ' ') {
+		xdebug_path_add(path, strtoul(s + 1, &s, 10));
+	}
+
+	xdebug_path_info_add_path(&branch_info->path_info, path);
+}
+
+static void merge_function(xdebug_coverage_file *file, char *function_name, xdebug_branch_info *branch_info)
+{
+	xdebug_coverage_function *function;
+
+	if (!branch_info) {
+		return;
+	}
+
+	xdebug_branch_info_index_paths(branch_info);
+
+	if (!xdebug_hash_find(file->functions, function_name, strlen(function_name), (void *) &function)) {
+		function = xdebug_coverage_function_ctor(function_name);
+		xdebug_hash_add(file->functions, function_name, strlen(function_name), function);
+	}
+	file->has_branch_info = 1;
+
+	if (function->branch_info) {
+		xdebug_branch_info_merge_hits(function->branch_info, branch_info);
+		xdebug_branch_info_free(branch_info);
+		return;
+	}
+
+	function->branch_info = branch_info;
+	function->from_merge = 1;
+	branch_info->generation = XG_COV(delta).generation;
+}
+
+static int merge_code_coverage(zend_string *contents)
+{
+	char                 *p = ZSTR_VAL(contents);
+	char                 *end = p + ZSTR_LEN(contents);
+	char                 *line;
+	size_t                len;
+	int                   version_found = 0;
+	xdebug_coverage_file *file = NULL;
+	char                 *function_name = NULL;
+	xdebug_branch_info   *branch_info = NULL;
+
+	/* The header ends with an empty line */
+	while ((line = next_record(&p, end, &len)) != NULL && len) {
+		if (len == 10 && strncmp(line, "version: 1", 10) == 0) {
+			version_found = 1;
+		}
+	}
+	if (!version_found) {
+		return 0;
+	}
+
+	while ((line = next_record(&p, end, &len)) != NULL) {
+		if (RECORD_IS(line, len, "function ") || RECORD_IS(line, len, "file ")) {
+			if (function_name) {
+				merge_function(file, function_name, branch_info);
+				xdfree(function_name);
+				function_name = NULL;
+				branch_info = NULL;
+			}
+		}
+
+		if (RECORD_IS(line, len, "file ")) {
+			zend_string *filename = zend_string_init(line + 5, len - 5, 0);
+
+			file = find_or_add_file(filename);
+			zend_string_release(filename);
+		} else if (file && RECORD_IS(line, len, "line ")) {
+			merge_line(file, line + 5);
+		} else if (file && RECORD_IS(line, len, "function ")) {
+			function_name = xdebug_strndup(line + 9, len - 9);
+			branch_info = branch_info_for_records(file, function_name, p, end);
+		} else if (branch_info && RECORD_IS(line, len, "branch ")) {
+			merge_branch(branch_info, line + 7);
+		} else if (branch_info && RECORD_IS(line, len, "path ")) {
+			merge_path(branch_info, line + 5);
+		}
+	}
+
+	if (function_name) {
+		merge_function(file, function_name, branch_info);
+		xdfree(function_name);
+	}
+
+	return 1;
+}
+
+static int merge_code_coverage_file(const char *fname)
+{
+	php_stream  *stream;
+	zend_string *contents;
+	char        *open_fname;
+	size_t       fname_len = strlen(fname);
+	int          merged = 0;
+
+	if (fname_len > 3 && strcmp(fname + fname_len - 3, ".gz") == 0) {
+		open_fname = xdebug_sprintf("compress.zlib://%s", fname);
+	} else {
+		open_fname = xdstrdup(fname);
+	}
+
+	stream = php_stream_open_wrapper(open_fname, "rb", 0, NULL);
+	xdfree(open_fname);
+
+	if (!stream) {
+		return 0;
+	}
+
+	contents = php_stream_copy_to_mem(stream, PHP_STREAM_COPY_ALL, 0);
+	php_stream_close(stream);
+
+	if (contents) {
+		merged = merge_code_coverage(contents);
+		zend_string_release(contents);
+	}
+
+	return merged;
+}
+
+/* Forked children that ran with xdebug.coverage_merge_forks write their
+ * coverage to the output directory when they end, into files named after the
+ * parent's and their own PID. The parent merges, and then removes, the files
+ * of the children that have ended whenever it reads its coverage. */
+#define FORKED_COVERAGE_PREFIX "xdebug-coverage."
+
+static char *forked_coverage_fname(const char *fname)
+{
+	char *output_dir = xdebug_lib_get_output_dir(); /* not duplicated */
+
+	if (IS_SLASH(output_dir[strlen(output_dir) - 1])) {
+		return xdebug_sprintf("%s%s", output_dir, fname);
+	}
+	return xdebug_sprintf("%s%c%s", output_dir, DEFAULT_SLASH, fname);
+}
+
+static void merge_forked_code_coverage(void)
+{
+	php_stream        *dir;
+	php_stream_dirent  entry;
+	char              *prefix;
+	size_t             prefix_len;
+
+	if (!XINI_COV(coverage_merge_forks)) {
+		return;
+	}
+
+	dir = php_stream_opendir(xdebug_lib_get_output_dir(), 0, NULL);
+	if (!dir) {
+		return;
+	}
+
+	prefix = xdebug_sprintf(FORKED_COVERAGE_PREFIX "%lu.", (unsigned long) xdebug_get_pid());
+	prefix_len = strlen(prefix);
+
+	while (php_stream_readdir(dir, &entry)) {
+		char *fname;
+
+		/* Files of children that are still writing end in .tmp, or .tmp.gz */
+		if (strncmp(entry.d_name, prefix, prefix_len) != 0 || strstr(entry.d_name, ".tmp")) {
+			continue;
+		}
+
+		fname = forked_coverage_fname(entry.d_name);
+		if (merge_code_coverage_file(fname)) {
+			VCWD_UNLINK(fname);
+		} else {
+			xdebug_log_ex(XLOG_CHAN_COVERAGE, XLOG_WARN, "MERGE", "Could not merge the code coverage in '%s'", fname);
+		}
+		xdfree(fname);
+	}
+
+	php_stream_closedir(dir);
+	xdfree(prefix);
+}
+
+static void write_forked_code_coverage(void)
+{
+	char   *base_fname, *tmp_fname, *written_fname, *final_fname;
+	size_t  written_len;
+
+	/* Include what our own children have collected */
+	merge_forked_code_coverage();
+
+	base_fname = xdebug_sprintf(
+		FORKED_COVERAGE_PREFIX "%lu.%lu",
+		(unsigned long) XG_COV(forked_from_pid), (unsigned long) xdebug_get_pid()
+	);
+	tmp_fname = forked_coverage_fname(base_fname);
+	xdfree(base_fname);
+
+	written_fname = dump_code_coverage(tmp_fname, "tmp");
+	if (!written_fname) {
+		xdebug_log_ex(XLOG_CHAN_COVERAGE, XLOG_WARN, "MERGE", "Could not write the code coverage to '%s.tmp'", tmp_fname);
+		xdfree(tmp_fname);
+		return;
+	}
+
+	/* Renamed, so that the parent never reads a partial file */
+	written_len = strlen(written_fname);
+	if (written_len > 7 && strcmp(written_fname + written_len - 7, ".tmp.gz") == 0) {
+		final_fname = xdebug_sprintf("%s.gz", tmp_fname);
+	} else {
+		final_fname = xdstrdup(tmp_fname);
+	}
+	VCWD_RENAME(written_fname, final_fname);
+
+	xdfree(final_fname);
+	xdfree(written_fname);
+	xdfree(tmp_fname);
+}
+
+static void reset_line_hits(void *dummy, xdebug_hash_element *e)
+{
+	xdebug_coverage_line *line = (xdebug_coverage_line*) e->ptr;
+
+	line->count = 0;
+	line->hits = 0;
+}
+
+static void reset_function_hits(void *dummy, xdebug_hash_element *e)
+{
+	xdebug_branch_info *branch_info = ((xdebug_coverage_function*) e->ptr)->branch_info;
+	unsigned int        i;
+
+	if (!branch_info) {
+		return;
+	}
+
+	for (i = 0; i < branch_info->size; i++) {
+		branch_info->branches[i].hit = 0;
+		branch_info->branches[i].hit_count = 0;
+	}
+	for (i = 0; i < branch_info->path_info.paths_count; i++) {
+		branch_info->path_info.paths[i]->hit = 0;
+		branch_info->path_info.paths[i]->hit_count = 0;
+	}
+}
+
+static void reset_file_hits(void *dummy, xdebug_hash_element *e)
+{
+	xdebug_coverage_file *file = (xdebug_coverage_file*) e->ptr;
+
+	xdebug_hash_apply(file->lines, NULL, reset_line_hits);
+	xdebug_hash_apply(file->functions, NULL, reset_function_hits);
+}
+
+void xdebug_coverage_pcntl_fork_child_handler(zend_ulong parent_pid)
+{
+	if (!XINI_COV(coverage_merge_forks) || !XG_COV(code_coverage_active)) {
+		return;
+	}
+
+	XG_COV(forked_from_pid) = parent_pid;
+
+	/* The parent already has the hits from before the fork, and merging them
+	 * back should not count them twice. What is known about executable lines
+	 * and branches is kept. */
+	if (XG_COV(code_coverage_hit_count)) {
+		xdebug_coverage_flush_counters();
+		xdebug_hash_apply(XG_COV(code_coverage_info), NULL, reset_file_hits);
+	}
+}
+
+PHP_FUNCTION(xdebug_dump_code_coverage)
+{
+	char   *fname;
+	size_t  fname_len;
+	char   *written_fname;
+
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "p", &fname, &fname_len) == FAILURE) {
+		return;
+	}
+
+	if (!XG_COV(code_coverage_info)) {
+		RETURN_NULL();
+	}
+
+	merge_forked_code_coverage();
+
+	written_fname = dump_code_coverage(fname, NULL);
+	if (!written_fname) {
+		php_error(E_WARNING, "Can not write code coverage to '%s'", fname);
+		RETURN_NULL();
+	}
+
+	RETVAL_STRING(written_fname);
+	xdfree(written_fname);
+}
+
+PHP_FUNCTION(xdebug_merge_code_coverage)
+{
+	char   *fname;
+	size_t  fname_len;
+
+	if (zend_parse_parameters(ZEND_NUM_ARGS(), "p", &fname, &fname_len) == FAILURE) {
+		return;
+	}
+
+	if (!XG_COV(code_coverage_info)) {
+		RETURN_FALSE;
+	}
+
+	if (!merge_code_coverage_file(fname)) {
+		php_error(E_WARNING, "Can not read code coverage from '%s'", fname);
+		RETURN_FALSE;
+	}
+
+	RETURN_TRUE;
+}
+
+static void add_cc_function_delta(void *ret, xdebug_hash_element *e)
+{
+	xdebug_coverage_function *function = (xdebug_coverage_function*) e->ptr;
+	zval                     *retval = (zval*) ret;
+	zval                     *function_info;
+
+	if (!function->branch_info || function->branch_info->generation != XG_COV(delta).generation) {
+		return;
+	}
+
+	XDEBUG_MAKE_STD_ZVAL(function_info);
+	array_init(function_info);
+
+	add_branches(function_info, function->branch_info, XG_COV(delta).generation);
+	add_paths(function_info, function->branch_info, XG_COV(delta).generation);
+
+	add_assoc_zval_ex(retval, function->name, HASH_KEY_STRLEN(function->name), function_info);
+
+	efree(function_info);
+}
+
+static void add_file_delta(zval *retval, xdebug_coverage_file *file)
+{
+	zval   *lines, *functions, *file_info;
+	size_t  i;
+
+	qsort(file->dirty_lines, file->dirty_lines_count, sizeof(xdebug_coverage_line*), coverage_line_cmp);
+
+	XDEBUG_MAKE_STD_ZVAL(lines);
+	array_init(lines);
+
+	for (i = 0; i < file->dirty_lines_count; i++) {
+		add_index_long(lines, file->dirty_lines[i]->lineno, line_status(file->dirty_lines[i]));
+	}
+
+	if (XG_COV(code_coverage_branch_check)) {
+		XDEBUG_MAKE_STD_ZVAL(file_info);
+		array_init(file_info);
+
+		XDEBUG_MAKE_STD_ZVAL(functions);
+		array_init(functions);
+
+		xdebug_hash_apply(file->functions, (void *) functions, add_cc_function_delta);
+
+		add_assoc_zval_ex(file_info, "lines", HASH_KEY_SIZEOF("lines"), lines);
+		add_assoc_zval_ex(file_info, "functions", HASH_KEY_SIZEOF("functions"), functions);
+
+		add_assoc_zval_ex(retval, ZSTR_VAL(file->name), ZSTR_LEN(file->name), file_info);
+		efree(functions);
+		efree(file_info);
+	} else {
+		add_assoc_zval_ex(retval, ZSTR_VAL(file->name), ZSTR_LEN(file->name), lines);
+	}
+
+	efree(lines);
+}
+
+/* Returns the lines, branches, and paths, that were hit since the last call,
+ * or since code coverage started. Only the op_arrays that ran since then are
+ * looked at. The "out_hit" elements of branches are not reset with each
+ * delta, and show whether that exit was ever taken. With XDEBUG_CC_HIT_COUNT,
+ * the counts are the totals so far, and not just those of the delta. */
+PHP_FUNCTION(xdebug_get_code_coverage_delta)
+{
+	size_t i;
+
+	array_init(return_value);
+
+	if (!XG_COV(code_coverage_info)) {
+		return;
+	}
+
+	merge_forked_code_coverage();
+
+	for (i = 0; i < XG_COV(delta).counters_count; i++) {
+		flush_counters(XG_COV(delta).counters[i]);
+	}
+
+	for (i = 0; i < XG_COV(delta).files_count; i++) {
+		add_file_delta(return_value, XG_COV(delta).files[i]);
+	}
+
+	xdebug_coverage_start_delta();
+}
+
+PHP_FUNCTION(xdebug_get_function_count)
+{
+	RETURN_LONG(XG_BASE(function_count));
+}
+
+PHP_FUNCTION(xdebug_code_coverage_started)
+{
+	RETURN_BOOL(XG_COV(code_coverage_active));
+}
+
+void xdebug_init_coverage_globals(xdebug_coverage_globals_t *xg)
+{
+	xg->previous_filename    = NULL;
+	xg->previous_file        = NULL;
+	xg->paths_stack = NULL;
+	xg->op_array_counters    = NULL;
+	xg->last_counters        = NULL;
+	xg->branches.size        = 0;
+	xg->branches.last_branch_nr = NULL;
+	xg->branches.visited     = NULL;
+	xg->code_coverage_active = 0;
+
+	/* Get reserved offset */
+	xg->dead_code_analysis_tracker_offset = zend_xdebug_cc_run_offset;
+	xg->dead_code_last_start_id = 1;
+	xg->code_coverage_filter_offset = zend_xdebug_filter_offset;
+}
+
+void xdebug_coverage_count_line_if_active(zend_op_array *op_array, zend_string *file, int lineno)
+{
+	if (XG_COV(code_coverage_active) && !op_array->reserved[XG_COV(code_coverage_filter_offset)]) {
+		xdebug_count_line(file, lineno, 0, 0);
+	}
+}
+
+/* Called for each statement, with the opline of the statement being current */
+void xdebug_coverage_count_opcode_if_active(zend_op_array *op_array, const zend_op *opline)
+{
+	if (XG_COV(code_coverage_active) && !op_array->reserved[XG_COV(code_coverage_filter_offset)]) {
+		xdebug_count_opcode(op_array, opline);
+	}
+}
+
+void xdebug_coverage_count_line_if_branch_check_active(zend_op_array *op_array, zend_string *file, int lineno)
+{
+	if (XG_COV(code_coverage_active) && XG_COV(code_coverage_branch_check)) {
+		xdebug_coverage_count_line_if_active(op_array, file, lineno);
+	}
+}
+
+void xdebug_coverage_record_if_active(zend_execute_data *execute_data, zend_op_array *op_array)
+{
+	if (!op_array->reserved[XG_COV(code_coverage_filter_offset)] && XG_COV(code_coverage_active)) {
+		xdebug_print_opcode_info(execute_data, execute_data->opline);
+	}
+}
+
+void xdebug_coverage_compile_file(zend_op_array *op_array)
+{
+	if (XG_COV(code_coverage_active) && XG_COV(code_coverage_unused) && (op_array->fn_flags & ZEND_ACC_DONE_PASS_TWO)) {
+		xdebug_prefill_code_coverage(op_array);
+		xdebug_prefill_code_coverage_from_tables();
+	}
+}
+
+int xdebug_coverage_execute_ex(function_stack_entry *fse, zend_op_array *op_array, zend_string **tmp_filename, char **tmp_function_name)
+{
+	if (!fse->filtered_code_coverage && XG_COV(code_coverage_active) && XG_COV(code_coverage_unused)) {
+		/* The name is owned by the function identity table, and lives until
+		 * the end of the request */
+		*tmp_filename = zend_string_copy(op_array->filename);
+		*tmp_function_name = xdebug_function_identity_for_op_array(op_array, xdebug_build_function_name_from_oparray)->name;
+		xdebug_code_coverage_start_of_function(op_array, *tmp_function_name);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+void xdebug_coverage_execute_ex_end(function_stack_entry *fse, zend_op_array *op_array, zend_string *tmp_filename, char *tmp_function_name)
+{
+	/* Check which path has been used */
+	if (!fse->filtered_code_coverage && XG_COV(code_coverage_active) && XG_COV(code_coverage_unused)) {
+		xdebug_code_coverage_end_of_function(op_array);
+	}
+	zend_string_release(tmp_filename);
+}
+
+void xdebug_coverage_init_oparray(zend_op_array *op_array)
+{
+	function_stack_entry tmp_fse;
+
+	if (XG_BASE(filter_type_code_coverage) == XDEBUG_FILTER_NONE) {
+		op_array->reserved[XG_COV(dead_code_analysis_tracker_offset)] = 0;
+		return;
+	}
+
+	tmp_fse.filename = op_array->filename;
+	xdebug_build_fname_from_oparray(&tmp_fse.function, op_array);
+	xdebug_filter_run_internal(&tmp_fse, XDEBUG_FILTER_CODE_COVERAGE, &tmp_fse.filtered_code_coverage, XG_BASE(filter_type_code_coverage), XG_BASE(filters_code_coverage));
+	xdebug_func_dtor_by_ref(&tmp_fse.function);
+
+	op_array->reserved[XG_COV(code_coverage_filter_offset)] = (void*) (size_t) tmp_fse.filtered_code_coverage;
+}
+
+/* The counters of an op_array that goes away, such as the main code of an
+ * included file without opcache, are folded into the lines before the address
+ * of its opcodes can be reused */
+void xdebug_coverage_destroy_oparray(zend_op_array *op_array)
+{
+	xdebug_coverage_counters *counters;
+
+	if (!XG_COV(op_array_counters)) {
+		return;
+	}
+
+	if (!xdebug_hash_find(XG_COV(op_array_counters), (char*) &op_array->opcodes, sizeof(zend_op*), (void *) &counters)) {
+		return;
+	}
+
+	flush_counters(counters);
+
+	if (counters->generation == XG_COV(delta).generation) {
+		xdebug_coverage_counters *moved = XG_COV(delta).counters[--XG_COV(delta).counters_count];
+
+		XG_COV(delta).counters[counters->delta_index] = moved;
+		moved->delta_index = counters->delta_index;
+	}
+
+	if (XG_COV(last_counters) == counters) {
+		XG_COV(last_counters) = NULL;
+	}
+	xdebug_hash_delete(XG_COV(op_array_counters), (char*) &op_array->opcodes, sizeof(zend_op*));
+}
+
+static int xdebug_switch_handler(XDEBUG_OPCODE_HANDLER_ARGS)
+{
+	const zend_op *cur_opcode = execute_data->opline;
+
+	if (!XG_COV(code_coverage_active)) {
+		return xdebug_call_original_opcode_handler_if_set(cur_opcode->opcode, XDEBUG_OPCODE_HANDLER_ARGS_PASSTHRU);
+	}
+
+	execute_data->opline++;
 	return ZEND_USER_OPCODE_CONTINUE;
 }
 
@@ -1110,8 +2122,9 @@ void xdebug_coverage_minit(INIT_FUNC_ARGS)
 	xdebug_set_opcode_handler(ZEND_GENERATOR_CREATE, xdebug_common_override_handler);
 	xdebug_set_opcode_handler(ZEND_BIND_STATIC, xdebug_common_override_handler);
 	xdebug_set_opcode_handler(ZEND_BIND_LEXICAL, xdebug_common_override_handler);
-	xdebug_set_opcode_handler(ZEND_DECLARE_CLASS, xdebug_common_override_handler);
-	xdebug_set_opcode_handler(ZEND_DECLARE_CLASS_DELAYED, xdebug_common_override_handler);
+	xdebug_set_opcode_handler(ZEND_DECLARE_CLASS, xdebug_coverage_declare_handler);
+	xdebug_set_opcode_handler(ZEND_DECLARE_CLASS_DELAYED, xdebug_coverage_declare_handler);
+	xdebug_set_opcode_handler(ZEND_DECLARE_FUNCTION, xdebug_coverage_declare_handler);
 	xdebug_set_opcode_handler(ZEND_SWITCH_STRING, xdebug_switch_handler);
 	xdebug_set_opcode_handler(ZEND_SWITCH_LONG, xdebug_switch_handler);
 
@@ -1132,6 +2145,7 @@ void xdebug_coverage_register_constants(INIT_FUNC_ARGS)
 	REGISTER_LONG_CONSTANT("XDEBUG_CC_UNUSED", XDEBUG_CC_OPTION_UNUSED, CONST_CS | CONST_PERSISTENT);
 	REGISTER_LONG_CONSTANT("XDEBUG_CC_DEAD_CODE", XDEBUG_CC_OPTION_DEAD_CODE, CONST_CS | CONST_PERSISTENT);
 	REGISTER_LONG_CONSTANT("XDEBUG_CC_BRANCH_CHECK", XDEBUG_CC_OPTION_BRANCH_CHECK, CONST_CS | CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("XDEBUG_CC_HIT_COUNT", XDEBUG_CC_OPTION_HIT_COUNT, CONST_CS | CONST_PERSISTENT);
 }
 
 void xdebug_coverage_rinit(void)
@@ -1143,26 +2157,58 @@ void xdebug_coverage_rinit(void)
 	XG_COV(code_coverage_filter_offset) = zend_xdebug_filter_offset;
 	XG_COV(previous_filename) = NULL;
 	XG_COV(previous_file) = NULL;
+	XG_COV(op_array_counters) = xdebug_hash_alloc(1024, xdebug_coverage_counters_dtor);
+	XG_COV(last_counters) = NULL;
 	XG_COV(prefill_function_count) = 0;
 	XG_COV(prefill_class_count) = 0;
-
-	/* Initialize visited classes and branches hash */
-	XG_COV(visited_branches) = xdebug_hash_alloc(2048, NULL);
+	XG_COV(prefill_tables_changed) = 0;
+	XG_COV(forked_from_pid) = 0;
+	xdebug_analysis_cache_rinit();
+
+	XG_COV(delta).generation = 1;
+	XG_COV(delta).files_count = 0;
+	XG_COV(delta).files_size = 0;
+	XG_COV(delta).files = NULL;
+	XG_COV(delta).counters_count = 0;
+	XG_COV(delta).counters_size = 0;
+	XG_COV(delta).counters = NULL;
 
 	XG_COV(paths_stack) = xdebug_path_info_ctor();
 	XG_COV(branches).size = 0;
 	XG_COV(branches).last_branch_nr = NULL;
+	XG_COV(branches).visited = NULL;
+}
+
+/* Forked children write their coverage here, and not in post_deactivate, as
+ * that runs after the resource list that PHP streams use has been destroyed.
+ * Shutdown functions and destructors have already run at this point. */
+void xdebug_coverage_rshutdown(void)
+{
+	if (XG_COV(forked_from_pid)) {
+		write_forked_code_coverage();
+		XG_COV(forked_from_pid) = 0;
+	}
 }
 
 void xdebug_coverage_post_deactivate(void)
 {
 	XG_COV(code_coverage_active) = 0;
 
+	xdebug_analysis_cache_post_deactivate();
+
+	xdebug_hash_destroy(XG_COV(op_array_counters));
+	XG_COV(op_array_counters) = NULL;
+	XG_COV(last_counters) = NULL;
+
 	xdebug_hash_destroy(XG_COV(code_coverage_info));
 	XG_COV(code_coverage_info) = NULL;
 
-	xdebug_hash_destroy(XG_COV(visited_branches));
-	XG_COV(visited_branches) = NULL;
+	xdfree(XG_COV(delta).files);
+	XG_COV(delta).files = NULL;
+	xdfree(XG_COV(delta).counters);
+	XG_COV(delta).counters = NULL;
+	XG_COV(delta).files_count = XG_COV(delta).files_size = 0;
+	XG_COV(delta).counters_count = XG_COV(delta).counters_size = 0;
 
 	/* Clean up path coverage array */
 	if (XG_COV(paths_stack)) {
@@ -1170,6 +2216,14 @@ void xdebug_coverage_post_deactivate(void)
 		XG_COV(paths_stack) = NULL;
 	}
 	if (XG_COV(branches).last_branch_nr) {
+		unsigned int i;
+
+		for (i = 0; i < XG_COV(branches).size; i++) {
+			xdebug_visited_branches_free(&XG_COV(branches).visited[i]);
+		}
+		free(XG_COV(branches).visited);
+		XG_COV(branches).visited = NULL;
+
 		free(XG_COV(branches).last_branch_nr);
 		XG_COV(branches).last_branch_nr = NULL;
 		XG_COV(branches).size = 0;
@@ -1179,8 +2233,4 @@ void xdebug_coverage_post_deactivate(void)
 		zend_string_release(XG_COV(previous_filename));
 		XG_COV(previous_filename) = NULL;
 	}
-	if (XG_COV(previous_mark_filename)) {
-		zend_string_release(XG_COV(previous_mark_filename));
-		XG_COV(previous_mark_filename) = NULL;
-	}
 }
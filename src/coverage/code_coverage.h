@@ -24,6 +24,12 @@ typedef struct xdebug_coverage_file {
 	xdebug_hash        *lines;
 	xdebug_hash        *functions; /* Used for branch coverage */
 	int                 has_branch_info;
+
+	/* The lines that were hit since the last delta, if 'generation' is the current one */
+	unsigned int                  generation;
+	size_t                        dirty_lines_count;
+	size_t                        dirty_lines_size;
+	struct xdebug_coverage_line **dirty_lines;
 } xdebug_coverage_file;
 
 typedef struct _xdebug_coverage_globals_t {
@@ -32,29 +38,45 @@ typedef struct _xdebug_coverage_globals_t {
 	zend_bool     code_coverage_unused;
 	zend_bool     code_coverage_dead_code_analysis;
 	zend_bool     code_coverage_branch_check;
+	zend_bool     code_coverage_hit_count;
 	int           dead_code_analysis_tracker_offset;
 	long          dead_code_last_start_id;
 	long          code_coverage_filter_offset;
 	size_t        prefill_function_count;
 	size_t        prefill_class_count;
+	zend_bool     prefill_tables_changed; /* Functions or classes might have been declared since the last prefill */
 	zend_string          *previous_filename;
 	xdebug_coverage_file *previous_file;
-	zend_string          *previous_mark_filename;
-	xdebug_coverage_file *previous_mark_file;
 	xdebug_path_info     *paths_stack;
-	xdebug_hash          *visited_branches;
+	xdebug_hash                     *op_array_counters;
+	struct xdebug_coverage_counters *last_counters;
+	xdebug_hash                     *analysis_cache_files;
+	zend_ulong                       forked_from_pid; /* With xdebug.coverage_merge_forks, in a forked child */
+	struct {
+		unsigned int                      generation; /* Increases with each xdebug_get_code_coverage_delta() */
+		size_t                            files_count;
+		size_t                            files_size;
+		xdebug_coverage_file            **files;
+		size_t                            counters_count;
+		size_t                            counters_size;
+		struct xdebug_coverage_counters **counters;
+	} delta;
 	struct {
 		unsigned int  size;
 		int *last_branch_nr;
+		xdebug_visited_branches *visited;
 	} branches;
 } xdebug_coverage_globals_t;
 
 typedef struct _xdebug_coverage_settings_t {
-	int dummy;
+	char      *coverage_cache_dir;
+	zend_bool  coverage_merge_forks;
+	zend_long  coverage_path_limit;
 } xdebug_coverage_settings_t;
 
 void xdebug_init_coverage_globals(xdebug_coverage_globals_t *xg);
 void xdebug_coverage_count_line_if_active(zend_op_array *op_array, zend_string *file, int lineno);
+void xdebug_coverage_count_opcode_if_active(zend_op_array *op_array, const zend_op *opline);
 void xdebug_coverage_count_line_if_branch_check_active(zend_op_array *op_array, zend_string *file, int lineno);
 void xdebug_coverage_record_if_active(zend_execute_data *execute_data, zend_op_array *op_array);
 void xdebug_coverage_compile_file(zend_op_array *op_array);
@@ -62,16 +84,23 @@ void xdebug_coverage_compile_file(zend_op_array *op_array);
 int  xdebug_coverage_execute_ex(function_stack_entry *fse, zend_op_array *op_array, zend_string **tmp_filename, char **tmp_function_name);
 void xdebug_coverage_execute_ex_end(function_stack_entry *fse, zend_op_array *op_array, zend_string *tmp_filename, char *tmp_function_name);
 void xdebug_coverage_init_oparray(zend_op_array *op_array);
+void xdebug_coverage_destroy_oparray(zend_op_array *op_array);
 
 void xdebug_coverage_minit(INIT_FUNC_ARGS);
 void xdebug_coverage_mshutdown(void);
 void xdebug_coverage_rinit(void);
+void xdebug_coverage_rshutdown(void);
 void xdebug_coverage_post_deactivate(void);
 void xdebug_coverage_register_constants(INIT_FUNC_ARGS);
 
+void xdebug_coverage_pcntl_fork_child_handler(zend_ulong parent_pid);
+
 PHP_FUNCTION(xdebug_start_code_coverage);
 PHP_FUNCTION(xdebug_stop_code_coverage);
 PHP_FUNCTION(xdebug_get_code_coverage);
+PHP_FUNCTION(xdebug_get_code_coverage_delta);
+PHP_FUNCTION(xdebug_dump_code_coverage);
+PHP_FUNCTION(xdebug_merge_code_coverage);
 PHP_FUNCTION(xdebug_code_coverage_started);
 
 PHP_FUNCTION(xdebug_get_function_count);
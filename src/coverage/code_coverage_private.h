@@ -30,11 +30,30 @@ typedef struct xdebug_coverage_line {
 	int lineno;
 	int count;
 	int executable;
+	unsigned int generation; /* In which it was last hit */
+	zend_ulong hits;         /* How often execution entered the line */
 } xdebug_coverage_line;
 
+/* Hit counters for each opcode of an op_array, which is all that the opcode
+ * handlers update. They are keyed on the op_array's opcodes, which closures
+ * share with the function they were created from. The line numbers are copied,
+ * as the counters can outlive the opcodes, and the hits are only folded into
+ * the file's lines when they are needed, or when the op_array is destroyed. */
+typedef struct xdebug_coverage_counters {
+	const zend_op        *opcodes;
+	uint32_t              last;
+	xdebug_coverage_file *file;
+	uint32_t             *lines;
+	uint32_t             *hits;
+	xdebug_branch_info   *branch_info; /* once found */
+	unsigned int          generation;  /* In which it last ran */
+	size_t                delta_index; /* Its position in XG_COV(delta).counters */
+} xdebug_coverage_counters;
+
 typedef struct xdebug_coverage_function {
 	char               *name;
 	xdebug_branch_info *branch_info;
+	int                 from_merge; /* branch_info was read by xdebug_merge_code_coverage() */
 } xdebug_coverage_function;
 
 #define XG_COV(v)      (XG(globals.coverage.v))
@@ -45,11 +64,14 @@ xdebug_coverage_file *xdebug_coverage_file_ctor(zend_string *filename);
 xdebug_coverage_function *xdebug_coverage_function_ctor(char *function_name);
 void xdebug_coverage_function_dtor(void *data);
 void xdebug_code_coverage_start_of_function(zend_op_array *op_array, char *function_name);
-void xdebug_code_coverage_end_of_function(zend_op_array *op_array, zend_string *file_name, char *function_name);
+void xdebug_code_coverage_end_of_function(zend_op_array *op_array);
 
 PHP_FUNCTION(xdebug_start_code_coverage);
 PHP_FUNCTION(xdebug_stop_code_coverage);
 PHP_FUNCTION(xdebug_get_code_coverage);
+PHP_FUNCTION(xdebug_get_code_coverage_delta);
+PHP_FUNCTION(xdebug_dump_code_coverage);
+PHP_FUNCTION(xdebug_merge_code_coverage);
 PHP_FUNCTION(xdebug_code_coverage_started);
 
 PHP_FUNCTION(xdebug_get_function_count);
@@ -20,6 +20,7 @@
 #include "develop_private.h"
 #include "monitor.h"
 
+#include "base/function_identity.h"
 #include "lib/compat.h"
 #include "lib/hash.h"
 #include "lib/var.h"
@@ -72,22 +73,18 @@ void xdebug_function_monitor_record(char *func_name, zend_string *filename, int
 
 void xdebug_monitor_handler(function_stack_entry *fse)
 {
-	char *func_name = NULL;
-	int   func_name_len = 0;
-	void *dummy = NULL;
+	xdebug_function_identity *fi;
+	void                     *dummy = NULL;
 
 	if (!XG_DEV(do_monitor_functions)) {
 		return;
 	}
 
-	func_name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
-	func_name_len = strlen(func_name);
+	fi = xdebug_function_identity_for_frame(fse);
 
-	if (xdebug_hash_find(XG_DEV(functions_to_monitor), func_name, func_name_len, (void *) &dummy)) {
-		xdebug_function_monitor_record(func_name, fse->filename, fse->lineno);
+	if (xdebug_hash_find(XG_DEV(functions_to_monitor), fi->name, fi->name_len, (void *) &dummy)) {
+		xdebug_function_monitor_record(fi->name, fse->filename, fse->lineno);
 	}
-
-	xdfree(func_name);
 }
 
 PHP_FUNCTION(xdebug_start_function_monitor)
@@ -0,0 +1,94 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#include <stdlib.h>
+#include "arena.h"
+#include "mm.h"
+
+static unsigned int size_class(size_t size)
+{
+	unsigned int bits = XDEBUG_ARENA_MIN_SIZE_BITS;
+
+	while (((size_t) 1 << bits) < size) {
+		bits++;
+	}
+
+	return bits;
+}
+
+xdebug_arena *xdebug_arena_ctor(size_t block_size)
+{
+	xdebug_arena *arena = xdcalloc(1, sizeof(xdebug_arena));
+
+	arena->block_size = block_size;
+
+	return arena;
+}
+
+void xdebug_arena_dtor(xdebug_arena *arena)
+{
+	xdebug_arena_block *block = arena->blocks;
+	xdebug_arena_block *next;
+
+	while (block) {
+		next = block->next;
+		xdfree(block->data);
+		xdfree(block);
+		block = next;
+	}
+
+	xdfree(arena);
+}
+
+void *xdebug_arena_malloc(xdebug_arena *arena, size_t size)
+{
+	unsigned int        bits = size_class(size);
+	size_t              rounded_size = (size_t) 1 << bits;
+	xdebug_arena_block *block = arena->blocks;
+	void               *ptr;
+
+	/* Reuse memory that has been given back first */
+	if (arena->free_lists[bits]) {
+		ptr = arena->free_lists[bits];
+		arena->free_lists[bits] = *(void**) ptr;
+
+		return ptr;
+	}
+
+	if (!block || block->size - block->used < rounded_size) {
+		block = xdmalloc(sizeof(xdebug_arena_block));
+		block->size = rounded_size > arena->block_size ? rounded_size : arena->block_size;
+		block->data = xdmalloc(block->size);
+		block->used = 0;
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+
+	ptr = block->data + block->used;
+	block->used += rounded_size;
+
+	return ptr;
+}
+
+/* The memory is kept on a free list for its size, which uses the memory
+ * itself for the links */
+void xdebug_arena_free(xdebug_arena *arena, void *ptr, size_t size)
+{
+	unsigned int bits = size_class(size);
+
+	*(void**) ptr = arena->free_lists[bits];
+	arena->free_lists[bits] = ptr;
+}
@@ -0,0 +1,49 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __XDEBUG_ARENA_H__
+#define __XDEBUG_ARENA_H__
+
+#include <stddef.h>
+
+/* A bump allocator, which only frees its memory all at once when it is
+ * destroyed. Allocations are rounded up to a power of two, and can be given
+ * back with xdebug_arena_free(), after which they are reused for allocations
+ * of the same size. */
+
+#define XDEBUG_ARENA_MIN_SIZE_BITS 4
+#define XDEBUG_ARENA_SIZE_CLASSES  (sizeof(size_t) * 8)
+
+typedef struct _xdebug_arena_block {
+	struct _xdebug_arena_block *next;
+	char                       *data;
+	size_t                      size;
+	size_t                      used;
+} xdebug_arena_block;
+
+typedef struct _xdebug_arena {
+	xdebug_arena_block *blocks;
+	size_t              block_size;
+	void               *free_lists[XDEBUG_ARENA_SIZE_CLASSES];
+} xdebug_arena;
+
+xdebug_arena *xdebug_arena_ctor(size_t block_size);
+void xdebug_arena_dtor(xdebug_arena *arena);
+
+void *xdebug_arena_malloc(xdebug_arena *arena, size_t size);
+void xdebug_arena_free(xdebug_arena *arena, void *ptr, size_t size);
+
+#endif
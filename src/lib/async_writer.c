@@ -0,0 +1,310 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#include "php_xdebug.h"
+#include "lib_private.h"
+#include "async_writer.h"
+#include "file.h"
+#include "log.h"
+#include "mm.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(xdebug)
+
+int xdebug_async_writer_policy_from_setting(const char *setting)
+{
+	if (!setting || setting[0] == '\0' || strcmp(setting, "off") == 0) {
+		return XDEBUG_ASYNC_WRITER_OFF;
+	}
+	if (strcmp(setting, "block") == 0) {
+		return XDEBUG_ASYNC_WRITER_BLOCK;
+	}
+	if (strcmp(setting, "drop") == 0) {
+		return XDEBUG_ASYNC_WRITER_DROP;
+	}
+
+	xdebug_log_ex(XLOG_CHAN_CONFIG, XLOG_WARN, "ASYNC", "The value '%s' for xdebug.async_writer is not supported, writing files directly", setting);
+
+	return XDEBUG_ASYNC_WRITER_OFF;
+}
+
+#if HAVE_XDEBUG_PTHREADS
+/* A forked child has a copy of the writer, but not its thread. The child
+ * therefore writes directly, which it can tell by the generation number. */
+static volatile int fork_generation = 0;
+
+static void async_writer_atfork_child(void)
+{
+	fork_generation++;
+}
+
+void xdebug_async_writer_minit(void)
+{
+	static int registered = 0;
+
+	if (!registered) {
+		pthread_atfork(NULL, NULL, async_writer_atfork_child);
+		registered = 1;
+	}
+}
+
+/* The 'waiting' flag is set before the condition that is waited for is
+ * checked again, and the other thread changes 'head' or 'tail' before it
+ * checks the flag. As all of these are sequentially consistent, either the
+ * waiting thread sees the change, or the other thread sees the flag and
+ * signals it. */
+static void async_writer_wait(xdebug_async_writer *writer, volatile int *waiting, pthread_cond_t *cond, int (*ready)(xdebug_async_writer *writer))
+{
+	pthread_mutex_lock(&writer->lock);
+	__atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+	while (!ready(writer)) {
+		pthread_cond_wait(cond, &writer->lock);
+	}
+
+	__atomic_store_n(waiting, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+static void async_writer_wake(xdebug_async_writer *writer, volatile int *waiting, pthread_cond_t *cond)
+{
+	if (!__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	pthread_cond_signal(cond);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+static int async_writer_has_data_or_stop(xdebug_async_writer *writer)
+{
+	return
+		__atomic_load_n(&writer->head, __ATOMIC_SEQ_CST) != writer->tail ||
+		__atomic_load_n(&writer->stop, __ATOMIC_SEQ_CST);
+}
+
+static int async_writer_has_space(xdebug_async_writer *writer)
+{
+	return writer->head - __atomic_load_n(&writer->tail, __ATOMIC_SEQ_CST) < writer->size;
+}
+
+/* Only the writer thread touches the file, so this must not log or use any
+ * of the request's globals */
+static void async_writer_file_write(xdebug_file *file, const char *data, size_t length)
+{
+	switch (file->type) {
+		case XDEBUG_FILE_TYPE_NORMAL:
+			fwrite(data, 1, length, file->fp.normal);
+			break;
+#if HAVE_XDEBUG_ZLIB
+		case XDEBUG_FILE_TYPE_GZ:
+			gzwrite(file->fp.gz, data, length);
+			break;
+#endif
+	}
+}
+
+static void async_writer_file_flush(xdebug_file *file)
+{
+	switch (file->type) {
+		case XDEBUG_FILE_TYPE_NORMAL:
+			fflush(file->fp.normal);
+			break;
+#if HAVE_XDEBUG_ZLIB
+		case XDEBUG_FILE_TYPE_GZ:
+			gzflush(file->fp.gz, Z_SYNC_FLUSH);
+			break;
+#endif
+	}
+}
+
+static void *async_writer_thread(void *arg)
+{
+	xdebug_async_writer *writer = (xdebug_async_writer*) arg;
+	int                  flushed = 1;
+
+	for (;;) {
+		uint64_t head = __atomic_load_n(&writer->head, __ATOMIC_ACQUIRE);
+		uint64_t tail = writer->tail;
+		size_t   offset;
+		size_t   length;
+
+		if (head == tail) {
+			if (__atomic_load_n(&writer->stop, __ATOMIC_ACQUIRE)) {
+				/* Data might have been added right before the stop request */
+				if (__atomic_load_n(&writer->head, __ATOMIC_ACQUIRE) == tail) {
+					break;
+				}
+				continue;
+			}
+
+			/* Make the data visible to readers of the file while idle */
+			if (!flushed) {
+				async_writer_file_flush(writer->file);
+				flushed = 1;
+			}
+
+			async_writer_wait(writer, &writer->writer_waiting, &writer->data_available, async_writer_has_data_or_stop);
+			continue;
+		}
+
+		/* Write out what is available up to the end of the buffer, and the
+		 * wrapped around part in the next iteration */
+		offset = tail & (writer->size - 1);
+		length = head - tail;
+		if (length > writer->size - offset) {
+			length = writer->size - offset;
+		}
+
+		async_writer_file_write(writer->file, writer->buffer + offset, length);
+		flushed = 0;
+
+		__atomic_store_n(&writer->tail, tail + length, __ATOMIC_SEQ_CST);
+		async_writer_wake(writer, &writer->producer_waiting, &writer->space_available);
+	}
+
+	async_writer_file_flush(writer->file);
+
+	return NULL;
+}
+
+xdebug_async_writer *xdebug_async_writer_start(xdebug_file *file, int policy)
+{
+	xdebug_async_writer *writer = xdcalloc(1, sizeof(xdebug_async_writer));
+
+	writer->file = file;
+	writer->size = XDEBUG_ASYNC_WRITER_BUFFER_SIZE;
+	writer->buffer = xdmalloc(writer->size);
+	writer->policy = policy;
+	writer->fork_generation = fork_generation;
+
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->data_available, NULL);
+	pthread_cond_init(&writer->space_available, NULL);
+
+	if (pthread_create(&writer->thread, NULL, async_writer_thread, writer) != 0) {
+		xdebug_log_ex(XLOG_CHAN_BASE, XLOG_WARN, "ASYNC", "Could not start the writer thread for '%s', writing the file directly", file->name);
+
+		pthread_cond_destroy(&writer->space_available);
+		pthread_cond_destroy(&writer->data_available);
+		pthread_mutex_destroy(&writer->lock);
+		xdfree(writer->buffer);
+		xdfree(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+int xdebug_async_writer_is_owned(xdebug_async_writer *writer)
+{
+	return writer->fork_generation == fork_generation;
+}
+
+/* With the 'block' policy, the request thread waits until there is room in
+ * the buffer. With 'drop', data that does not fit is thrown away as a whole,
+ * so that no partial lines end up in the file. */
+void xdebug_async_writer_write(xdebug_async_writer *writer, const char *data, size_t length)
+{
+	uint64_t head = writer->head;
+
+	if (writer->policy == XDEBUG_ASYNC_WRITER_DROP) {
+		uint64_t tail = __atomic_load_n(&writer->tail, __ATOMIC_ACQUIRE);
+
+		if (length > writer->size - (head - tail)) {
+			writer->dropped += length;
+			return;
+		}
+	}
+
+	while (length > 0) {
+		uint64_t tail = __atomic_load_n(&writer->tail, __ATOMIC_ACQUIRE);
+		size_t   available = writer->size - (head - tail);
+		size_t   offset = head & (writer->size - 1);
+		size_t   chunk;
+
+		if (available == 0) {
+			async_writer_wait(writer, &writer->producer_waiting, &writer->space_available, async_writer_has_space);
+			continue;
+		}
+
+		chunk = length < available ? length : available;
+		if (chunk > writer->size - offset) {
+			chunk = writer->size - offset;
+		}
+
+		memcpy(writer->buffer + offset, data, chunk);
+		data += chunk;
+		length -= chunk;
+		head += chunk;
+
+		__atomic_store_n(&writer->head, head, __ATOMIC_SEQ_CST);
+		async_writer_wake(writer, &writer->writer_waiting, &writer->data_available);
+	}
+}
+
+/* Waits until everything has been written out, and frees the writer. The
+ * file itself is left open. */
+void xdebug_async_writer_stop(xdebug_async_writer *writer)
+{
+	if (xdebug_async_writer_is_owned(writer)) {
+		__atomic_store_n(&writer->stop, 1, __ATOMIC_SEQ_CST);
+		async_writer_wake(writer, &writer->writer_waiting, &writer->data_available);
+		pthread_join(writer->thread, NULL);
+
+		if (writer->dropped) {
+			xdebug_log_ex(
+				XLOG_CHAN_BASE, XLOG_WARN, "ASYNC",
+				"The writer for '%s' could not keep up, and %lu bytes were dropped",
+				writer->file->name, writer->dropped
+			);
+		}
+
+		/* A forked child's copies could have been locked by the parent's
+		 * writer thread at the time of the fork, so are left alone */
+		pthread_cond_destroy(&writer->space_available);
+		pthread_cond_destroy(&writer->data_available);
+		pthread_mutex_destroy(&writer->lock);
+	}
+
+	xdfree(writer->buffer);
+	xdfree(writer);
+}
+#else
+void xdebug_async_writer_minit(void)
+{
+}
+
+xdebug_async_writer *xdebug_async_writer_start(xdebug_file *file, int policy)
+{
+	xdebug_log_ex(XLOG_CHAN_BASE, XLOG_WARN, "ASYNC", "Writing files from a separate thread is not supported on this platform");
+
+	return NULL;
+}
+
+int xdebug_async_writer_is_owned(xdebug_async_writer *writer)
+{
+	return 0;
+}
+
+void xdebug_async_writer_write(xdebug_async_writer *writer, const char *data, size_t length)
+{
+}
+
+void xdebug_async_writer_stop(xdebug_async_writer *writer)
+{
+}
+#endif
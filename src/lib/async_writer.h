@@ -0,0 +1,78 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __HAVE_LIB_ASYNC_WRITER_H__
+#define __HAVE_LIB_ASYNC_WRITER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if HAVE_XDEBUG_PTHREADS
+# include <pthread.h>
+#endif
+
+#define XDEBUG_ASYNC_WRITER_OFF   0
+#define XDEBUG_ASYNC_WRITER_BLOCK 1
+#define XDEBUG_ASYNC_WRITER_DROP  2
+
+#define XDEBUG_ASYNC_WRITER_BUFFER_SIZE (4 * 1024 * 1024)
+
+struct _xdebug_file;
+
+/* A single producer, single consumer, ring buffer of bytes. The request
+ * thread only ever moves 'head', and the writer thread only 'tail'. Both are
+ * counters that keep increasing, and are only reduced to a position in the
+ * buffer when it is accessed. */
+typedef struct _xdebug_async_writer {
+	struct _xdebug_file *file;
+	char                *buffer;
+	size_t               size; /* a power of two */
+	int                  policy;
+	int                  fork_generation;
+	unsigned long        dropped;
+
+	/* Each on their own cache line, as the threads write them all the time */
+	char                 pad1[64];
+	volatile uint64_t    head;
+	char                 pad2[64];
+	volatile uint64_t    tail;
+	char                 pad3[64];
+
+	volatile int         stop;
+#if HAVE_XDEBUG_PTHREADS
+	pthread_t            thread;
+
+	/* A thread that has to wait for the other one sets its 'waiting' flag,
+	 * and sleeps on its condition until the other thread signals it. That
+	 * way the mutex is only taken when one of them is actually waiting. */
+	pthread_mutex_t      lock;
+	pthread_cond_t       data_available; /* signalled by the request thread */
+	pthread_cond_t       space_available; /* signalled by the writer thread */
+	volatile int         writer_waiting;
+	volatile int         producer_waiting;
+#endif
+} xdebug_async_writer;
+
+void xdebug_async_writer_minit(void);
+
+int xdebug_async_writer_policy_from_setting(const char *setting);
+
+xdebug_async_writer *xdebug_async_writer_start(struct _xdebug_file *file, int policy);
+int xdebug_async_writer_is_owned(xdebug_async_writer *writer);
+void xdebug_async_writer_write(xdebug_async_writer *writer, const char *data, size_t length);
+void xdebug_async_writer_stop(xdebug_async_writer *writer);
+
+#endif
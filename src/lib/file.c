@@ -29,7 +29,13 @@ void xdebug_file_init(xdebug_file *xf)
 #if HAVE_XDEBUG_ZLIB
 	xf->fp.gz     = NULL;
 #endif
+	xf->fp.sink   = NULL;
 	xf->name      = NULL;
+	xf->async_writer = NULL;
+	xf->buffer.l = 0;
+	xf->buffer.a = 0;
+	xf->buffer.d = NULL;
+	xf->buffer_size = 0;
 }
 
 xdebug_file *xdebug_file_ctor(void)
@@ -47,7 +53,9 @@ void xdebug_file_deinit(xdebug_file *xf)
 #if HAVE_XDEBUG_ZLIB
 	xf->fp.gz     = NULL;
 #endif
+	xf->fp.sink   = NULL;
 	xdfree(xf->name);
+	xdebug_str_destroy(&xf->buffer);
 }
 
 void xdebug_file_dtor(xdebug_file *xf)
@@ -56,7 +64,7 @@ void xdebug_file_dtor(xdebug_file *xf)
 	xdfree(xf);
 }
 
-int xdebug_file_open(xdebug_file *file, const char *filename, const char *extension, const char *mode)
+static int file_open(xdebug_file *file, const char *filename, const char *extension, const char *mode)
 {
 	if (XINI_LIB(use_compression)) {
 #ifdef HAVE_XDEBUG_ZLIB
@@ -117,10 +125,132 @@ uncompressed:
 	return 1;
 }
 
+int xdebug_file_open(xdebug_file *file, const char *filename, const char *extension, const char *mode)
+{
+	int policy;
+
+	if (!file_open(file, filename, extension, mode)) {
+		return 0;
+	}
+
+	policy = xdebug_async_writer_policy_from_setting(XINI_LIB(async_writer));
+	if (policy != XDEBUG_ASYNC_WRITER_OFF) {
+		file->async_writer = xdebug_async_writer_start(file, policy);
+	}
+
+	return 1;
+}
+
+/* Sends the data to the collector that listens on the Unix domain socket or
+ * FIFO 'path'. 'filename' and 'extension' only name the stream for the
+ * collector, and compression and the writer thread are not used. */
+int xdebug_file_open_sink(xdebug_file *file, const char *path, const char *filename, const char *extension)
+{
+	char *name = extension ? xdebug_sprintf("%s.%s", filename, extension) : xdstrdup(filename);
+
+	file->fp.sink = xdebug_sink_open(path, name);
+	if (!file->fp.sink) {
+		xdfree(name);
+		return 0;
+	}
+
+	file->type = XDEBUG_FILE_TYPE_SINK;
+	file->name = name;
+
+	return 1;
+}
+
+/* For trace and profile files, which go to xdebug.output_sink if it is set.
+ * Files that are written in one go, outside of a request, pass 0 for
+ * 'allow_async_writer', so that no writer thread is started for them. */
+int xdebug_file_open_output(xdebug_file *file, const char *filename, const char *extension, const char *mode, int allow_async_writer)
+{
+	if (XINI_LIB(output_sink) && strlen(XINI_LIB(output_sink))) {
+		return xdebug_file_open_sink(file, XINI_LIB(output_sink), filename, extension);
+	}
+
+	if (!allow_async_writer) {
+		return file_open(file, filename, extension, mode);
+	}
+
+	return xdebug_file_open(file, filename, extension, mode);
+}
+
+/* Whether data goes through the writer thread, instead of to the file */
+static inline int file_is_async(xdebug_file *file)
+{
+	return file->async_writer && xdebug_async_writer_is_owned(file->async_writer);
+}
+
+/* With a buffer size set, xdebug_file_printf() and xdebug_file_write() collect
+ * their data in memory, which is only written out once 'size' bytes have been
+ * collected, and with xdebug_file_flush() and xdebug_file_close() */
+void xdebug_file_set_buffer_size(xdebug_file *file, size_t size)
+{
+	file->buffer_size = size;
+}
+
+static size_t file_write(const void *ptr, size_t len, xdebug_file *file)
+{
+	if (file_is_async(file)) {
+		xdebug_async_writer_write(file->async_writer, ptr, len);
+		return len;
+	}
+
+	switch (file->type) {
+		case XDEBUG_FILE_TYPE_NORMAL:
+			return fwrite(ptr, 1, len, file->fp.normal);
+#if HAVE_XDEBUG_ZLIB
+		case XDEBUG_FILE_TYPE_GZ:
+			return gzfwrite(ptr, 1, len, file->fp.gz);
+#endif
+		case XDEBUG_FILE_TYPE_SINK:
+			xdebug_sink_write(file->fp.sink, ptr, len);
+			return len;
+		default:
+			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_CRIT, "FTYPE", "Unknown file type used with '%s'", file->name);
+			return 0;
+	}
+}
+
+static void file_write_buffer(xdebug_file *file)
+{
+	if (file->buffer.l == 0) {
+		return;
+	}
+
+	file_write(file->buffer.d, file->buffer.l, file);
+	file->buffer.l = 0;
+}
+
 int XDEBUG_ATTRIBUTE_FORMAT(printf, 2, 3) xdebug_file_printf(xdebug_file *file, const char *fmt, ...)
 {
 	va_list argv;
 
+	if (file->buffer_size) {
+		va_start(argv, fmt);
+		xdebug_str_add_va_fmt(&file->buffer, fmt, argv);
+		va_end(argv);
+
+		if (file->buffer.l >= file->buffer_size) {
+			file_write_buffer(file);
+		}
+		return 1;
+	}
+
+	if (file_is_async(file)) {
+		xdebug_str formatted_string = XDEBUG_STR_INITIALIZER;
+
+		va_start(argv, fmt);
+		xdebug_str_add_va_fmt(&formatted_string, fmt, argv);
+		va_end(argv);
+
+		xdebug_async_writer_write(file->async_writer, formatted_string.d, formatted_string.l);
+
+		xdebug_str_destroy(&formatted_string);
+		return 1;
+	}
+
 	switch (file->type) {
 		case XDEBUG_FILE_TYPE_NORMAL:
 			va_start(argv, fmt);
@@ -141,6 +271,18 @@ int XDEBUG_ATTRIBUTE_FORMAT(printf, 2, 3) xdebug_file_printf(xdebug_file *file,
 			break;
 		}
 #endif
+		case XDEBUG_FILE_TYPE_SINK: {
+			xdebug_str formatted_string = XDEBUG_STR_INITIALIZER;
+
+			va_start(argv, fmt);
+			xdebug_str_add_va_fmt(&formatted_string, fmt, argv);
+			va_end(argv);
+
+			xdebug_sink_write(file->fp.sink, formatted_string.d, formatted_string.l);
+
+			xdebug_str_destroy(&formatted_string);
+			break;
+		}
 		default:
 			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_CRIT, "FTYPE", "Unknown file type used with '%s'", file->name);
 			return 0;
@@ -151,6 +293,13 @@ int XDEBUG_ATTRIBUTE_FORMAT(printf, 2, 3) xdebug_file_printf(xdebug_file *file,
 
 int xdebug_file_flush(xdebug_file *file)
 {
+	file_write_buffer(file);
+
+	/* The writer thread flushes whenever it has caught up */
+	if (file_is_async(file)) {
+		return 0;
+	}
+
 	switch (file->type) {
 		case XDEBUG_FILE_TYPE_NORMAL:
 			return fflush(file->fp.normal);
@@ -158,6 +307,9 @@ int xdebug_file_flush(xdebug_file *file)
 		case XDEBUG_FILE_TYPE_GZ:
 			return gzflush(file->fp.gz, Z_FULL_FLUSH);
 #endif
+		case XDEBUG_FILE_TYPE_SINK:
+			xdebug_sink_flush(file->fp.sink);
+			return 0;
 		default:
 			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_CRIT, "FTYPE", "Unknown file type used with '%s'", file->name);
 			return EOF;
@@ -166,6 +318,13 @@ int xdebug_file_flush(xdebug_file *file)
 
 int xdebug_file_close(xdebug_file *file)
 {
+	file_write_buffer(file);
+
+	if (file->async_writer) {
+		xdebug_async_writer_stop(file->async_writer);
+		file->async_writer = NULL;
+	}
+
 	switch (file->type) {
 		case XDEBUG_FILE_TYPE_NORMAL:
 			return fclose(file->fp.normal);
@@ -179,6 +338,10 @@ int xdebug_file_close(xdebug_file *file)
 			return gzret;
 		}
 #endif
+		case XDEBUG_FILE_TYPE_SINK:
+			xdebug_sink_close(file->fp.sink, file->name);
+			file->fp.sink = NULL;
+			return 0;
 		default:
 			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_CRIT, "FTYPE", "Unknown file type used with '%s'", file->name);
 			return EOF;
@@ -187,15 +350,20 @@ int xdebug_file_close(xdebug_file *file)
 
 size_t xdebug_file_write(const void *ptr, size_t size, size_t nmemb, xdebug_file *file)
 {
-	switch (file->type) {
-		case XDEBUG_FILE_TYPE_NORMAL:
-			return fwrite(ptr, size, nmemb, file->fp.normal);
-#if HAVE_XDEBUG_ZLIB
-		case XDEBUG_FILE_TYPE_GZ:
-			return gzfwrite(ptr, size, nmemb, file->fp.gz);
-#endif
-		default:
-			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_CRIT, "FTYPE", "Unknown file type used with '%s'", file->name);
-			return EOF;
+	size_t len = size * nmemb;
+
+	if (file->buffer_size) {
+		if (file->buffer.l + len < file->buffer_size) {
+			xdebug_str_addl(&file->buffer, ptr, len, 0);
+			return nmemb;
+		}
+
+		file_write_buffer(file);
+	}
+
+	if (len && file_write(ptr, len, file) != len) {
+		return 0;
 	}
+
+	return nmemb;
 }
@@ -24,11 +24,16 @@
 # include <zlib.h>
 #endif
 
+#include "async_writer.h"
+#include "sink.h"
+#include "str.h"
+
 #define XDEBUG_FILE_TYPE_NULL    0
 #define XDEBUG_FILE_TYPE_NORMAL  1
 #if HAVE_XDEBUG_ZLIB
 # define XDEBUG_FILE_TYPE_GZ     2
 #endif
+#define XDEBUG_FILE_TYPE_SINK   3
 
 typedef struct _xdebug_file {
 	int type;
@@ -37,8 +42,12 @@ typedef struct _xdebug_file {
 #if HAVE_XDEBUG_ZLIB
 		gzFile  gz;
 #endif
+		xdebug_sink *sink;
 	} fp;
 	char *name;
+	xdebug_async_writer *async_writer; /* only with xdebug.async_writer */
+	xdebug_str  buffer;      /* only with xdebug_file_set_buffer_size() */
+	size_t      buffer_size;
 } xdebug_file;
 
 xdebug_file *xdebug_file_ctor(void);
@@ -46,6 +55,9 @@ void xdebug_file_dtor(xdebug_file *xf);
 void xdebug_file_init(xdebug_file *xf);
 void xdebug_file_deinit(xdebug_file *xf);
 int xdebug_file_open(xdebug_file *file, const char *filename, const char *extension, const char *mode);
+int xdebug_file_open_sink(xdebug_file *file, const char *path, const char *filename, const char *extension);
+int xdebug_file_open_output(xdebug_file *file, const char *filename, const char *extension, const char *mode, int allow_async_writer);
+void xdebug_file_set_buffer_size(xdebug_file *file, size_t size);
 int xdebug_file_flush(xdebug_file *file);
 int XDEBUG_ATTRIBUTE_FORMAT(printf, 2, 3) xdebug_file_printf(xdebug_file *file, const char *fmt, ...);
 size_t xdebug_file_write(const void *ptr, size_t size, size_t nmemb, xdebug_file *file);
@@ -30,6 +30,8 @@ void xdebug_init_library_globals(xdebug_library_globals_t *xg)
 
 	xg->log_file             = 0;
 
+	xg->var_display_generation = 0;
+
 	xg->active_execute_data  = NULL;
 	xg->opcode_handlers_set = xdebug_set_create(256);
 	memset(xg->original_opcode_handlers, 0, sizeof(xg->original_opcode_handlers));
@@ -104,6 +106,7 @@ void xdebug_library_post_deactivate(void)
 
 	xdebug_close_log();
 	xdebug_str_free(XG_LIB(diagnosis_buffer));
+	XG_LIB(diagnosis_buffer) = NULL;
 }
 
 
@@ -286,6 +289,13 @@ int xdebug_lib_start_upon_error(void)
 	return 0;
 }
 
+/* Lets users of cached variable export options know they need to read them
+ * again, see xdebug_var_export_options_refresh_from_ini() */
+void xdebug_lib_var_display_settings_changed(void)
+{
+	XG_LIB(var_display_generation)++;
+}
+
 const char *xdebug_lib_mode_from_value(int mode)
 {
 	switch (mode) {
@@ -71,10 +71,12 @@ typedef struct xdebug_var_name {
 #define XDEBUG_TRACE_OPTION_COMPUTERIZED   2
 #define XDEBUG_TRACE_OPTION_HTML           4
 #define XDEBUG_TRACE_OPTION_NAKED_FILENAME 8
+#define XDEBUG_TRACE_OPTION_CPU_TIME       16
 
 #define XDEBUG_CC_OPTION_UNUSED          1
 #define XDEBUG_CC_OPTION_DEAD_CODE       2
 #define XDEBUG_CC_OPTION_BRANCH_CHECK    4
+#define XDEBUG_CC_OPTION_HIT_COUNT       8
 
 #define STATUS_STARTING   0
 #define STATUS_STOPPING   1
@@ -129,23 +131,37 @@ typedef struct _xdebug_func {
 	int   internal;
 } xdebug_func;
 
+/* Additional profiler events, such as hardware counters */
+#define XDEBUG_PROFILER_MAX_EVENTS 8
+
 typedef struct xdebug_profile {
 	uint64_t      nanotime;
 	uint64_t      nanotime_mark;
 	long          memory;
 	long          mem_mark;
-	xdebug_llist *call_list;
+	struct _xdebug_call_entry *call_entries;
+	unsigned int  call_entries_count;
+	unsigned int  call_entries_size;
+	uint64_t      nanotime_children;
+	long          mem_children;
+	/* Only allocated when profiler events are collected, as one block of three
+	 * arrays with an element for each event */
+	uint64_t     *events;
+	uint64_t     *events_mark;
+	uint64_t     *events_children;
 } xdebug_profile;
 
 typedef struct _function_stack_entry {
 	/* function properties */
 	xdebug_func    function;
+	struct _xdebug_function_identity *identity;
 	unsigned int   function_nr;
 	unsigned short user_defined:1;
 	unsigned short level:15;
 
 	/* argument properties */
 	unsigned short     varc;
+	unsigned short     var_size;
 	xdebug_var_name   *var;
 	zval              *return_value;
 	xdebug_llist      *declared_vars;
@@ -168,13 +184,16 @@ typedef struct _function_stack_entry {
 	signed long  memory;
 	signed long  prev_memory;
 	uint64_t     nanotime;
+	uint64_t     cpu_nanotime;
 
 	/* profiling properties */
 	xdebug_profile profile;
 	struct {
 		int          lineno;
 		zend_string *filename;
-		char        *funcname;
+		struct _xdebug_function_identity *function;
+		struct _xdebug_aggregated_function *aggregated_function;
+		struct _xdebug_collapsed_node *collapsed_node;
 	} profiler;
 
 	/* misc properties */
@@ -210,6 +229,9 @@ typedef struct _xdebug_library_globals_t {
 
 	zend_bool     dumped;
 
+	/* Changes whenever one of the xdebug.var_display_* settings is changed */
+	unsigned int  var_display_generation;
+
 	/* used for collection errors */
 	zend_bool     do_collect_errors;
 
@@ -244,6 +266,15 @@ typedef struct _xdebug_library_settings_t {
 	/* Logging settings */
 	char         *log;       /* Filename to log protocol communication to */
 	zend_long     log_level; /* Log level XDEBUG_LOG_{ERR,WARN,INFO,DEBUG} */
+
+	/* "default" or "tsc" */
+	char         *clock_source;
+
+	/* "off", "block", or "drop" */
+	char         *async_writer;
+
+	/* Unix domain socket or FIFO for trace and profile output, instead of files */
+	char         *output_sink;
 } xdebug_library_settings_t;
 
 void xdebug_init_library_globals(xdebug_library_globals_t *xg);
@@ -291,6 +322,8 @@ int xdebug_lib_set_start_upon_error(char *value);
 int xdebug_lib_start_upon_error(void);
 int xdebug_lib_get_start_upon_error(void);
 
+void xdebug_lib_var_display_settings_changed(void);
+
 const char *xdebug_lib_mode_from_value(int mode);
 
 void xdebug_lib_set_active_data(zend_execute_data *execute_data);
@@ -328,13 +328,19 @@ void xdebug_print_info(void)
 	php_info_print_table_row(2, "Compressed File Support", "no");
 #endif
 
+#if HAVE_XDEBUG_TIMER_CREATE
+	php_info_print_table_row(2, "Sampling Profiler Support", "yes");
+#else
+	php_info_print_table_row(2, "Sampling Profiler Support", "no");
+#endif
+
 #if WIN32
 	php_info_print_table_row(2, "Clock Source", XG_BASE(nanotime_context).use_rel_time ? "QueryPerformanceFrequency" : "GetSystemTimePreciseAsFileTime");
 #else
 # if HAVE_XDEBUG_CLOCK_GETTIME_NSEC_NP
 	php_info_print_table_row(2, "Clock Source", "clock_gettime_nsec_np");
 # elif HAVE_XDEBUG_CLOCK_GETTIME
-	php_info_print_table_row(2, "Clock Source", "clock_gettime");
+	php_info_print_table_row(2, "Clock Source", xdebug_nanotime_uses_tsc() ? "tsc (calibrated against clock_gettime)" : "clock_gettime");
 # else
 	php_info_print_table_row(2, "Clock Source", "gettimeofday");
 # endif
@@ -863,6 +869,9 @@ static void info_extension_flags_set(INTERNAL_FUNCTION_PARAMETERS)
 #if HAVE_XDEBUG_ZLIB
 	add_next_index_stringl(return_value, "compression", 11);
 #endif
+#if HAVE_XDEBUG_TIMER_CREATE
+	add_next_index_stringl(return_value, "sampling", 8);
+#endif
 }
 
 
@@ -0,0 +1,375 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#include "php_xdebug.h"
+#include "lib_private.h"
+#include "log.h"
+#include "mm.h"
+#include "sink.h"
+
+#ifndef PHP_WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <limits.h>
+# include <signal.h>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/un.h>
+# if HAVE_POLL_H
+#  include <poll.h>
+# elif HAVE_SYS_POLL_H
+#  include <sys/poll.h>
+# endif
+# if HAVE_XDEBUG_PTHREADS
+#  include <pthread.h>
+#  define sink_sigmask pthread_sigmask
+# else
+#  define sink_sigmask sigprocmask
+# endif
+#endif
+
+ZEND_EXTERN_MODULE_GLOBALS(xdebug)
+
+#ifndef PHP_WIN32
+
+/* Frames to a socket can be larger, as nothing else is written to it */
+#define SINK_SOCKET_MAX_FRAME (64 * 1024)
+
+/* How long closing waits for the collector to read what is still pending */
+#define SINK_CLOSE_WAIT_MS    10
+#define SINK_CLOSE_WAIT_TRIES 10
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+static uint32_t last_stream_id = 0;
+
+static void put_uint32(char *buffer, uint32_t value)
+{
+	buffer[0] = (char) (value >> 24);
+	buffer[1] = (char) (value >> 16);
+	buffer[2] = (char) (value >> 8);
+	buffer[3] = (char) value;
+}
+
+/* Writing to a FIFO without a reader raises SIGPIPE, which would end the PHP
+ * process. The signal is blocked for the calling thread during the write, and
+ * a SIGPIPE that the write raised is consumed before the signal mask is
+ * restored. */
+static ssize_t write_without_sigpipe(int fd, const char *data, size_t length)
+{
+	sigset_t sigpipe_set, pending_set, old_set;
+	int      was_pending;
+	ssize_t  written;
+	int      saved_errno;
+
+	sigemptyset(&sigpipe_set);
+	sigaddset(&sigpipe_set, SIGPIPE);
+	sink_sigmask(SIG_BLOCK, &sigpipe_set, &old_set);
+
+	/* A SIGPIPE that was already pending belongs to someone else */
+	sigemptyset(&pending_set);
+	sigpending(&pending_set);
+	was_pending = sigismember(&pending_set, SIGPIPE);
+
+	written = write(fd, data, length);
+	saved_errno = errno;
+
+	if (written < 0 && saved_errno == EPIPE && !was_pending) {
+#if HAVE_SIGTIMEDWAIT
+		struct timespec no_wait = { 0, 0 };
+
+		while (sigtimedwait(&sigpipe_set, NULL, &no_wait) < 0 && errno == EINTR) {
+		}
+#else
+		int sig;
+
+		sigemptyset(&pending_set);
+		sigpending(&pending_set);
+		if (sigismember(&pending_set, SIGPIPE)) {
+			sigwait(&sigpipe_set, &sig);
+		}
+#endif
+	}
+
+	sink_sigmask(SIG_SETMASK, &old_set, NULL);
+	errno = saved_errno;
+
+	return written;
+}
+
+/* Returns the number of bytes written, which is 0 when the collector is not
+ * ready for more data */
+static size_t sink_write_fd(xdebug_sink *sink, const char *data, size_t length)
+{
+	ssize_t written;
+
+	if (sink->broken) {
+		return 0;
+	}
+
+	if (sink->is_fifo) {
+		written = write_without_sigpipe(sink->fd, data, length);
+	} else {
+		written = send(sink->fd, data, length, MSG_NOSIGNAL);
+	}
+
+	if (written < 0) {
+		/* Anything else, such as EPIPE when the collector went away */
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			sink->broken = 1;
+		}
+		return 0;
+	}
+
+	return (size_t) written;
+}
+
+/* Writes out as much of the pending data as the collector accepts */
+static void sink_drain(xdebug_sink *sink)
+{
+	while (sink->pending_offset < sink->pending.l) {
+		size_t length = sink->pending.l - sink->pending_offset;
+		size_t written;
+
+		/* Pending data to a FIFO is always a sequence of whole frames */
+		if (sink->is_fifo) {
+			length = XDEBUG_SINK_FRAME_HEADER_SIZE + (
+				((unsigned char) sink->pending.d[sink->pending_offset] << 24) |
+				((unsigned char) sink->pending.d[sink->pending_offset + 1] << 16) |
+				((unsigned char) sink->pending.d[sink->pending_offset + 2] << 8) |
+				(unsigned char) sink->pending.d[sink->pending_offset + 3]
+			);
+		}
+
+		written = sink_write_fd(sink, sink->pending.d + sink->pending_offset, length);
+		if (written == 0) {
+			break;
+		}
+		sink->pending_offset += written;
+	}
+
+	if (sink->pending_offset == sink->pending.l) {
+		sink->pending.l = 0;
+		sink->pending_offset = 0;
+	} else if (sink->pending_offset > sink->pending.l / 2) {
+		memmove(sink->pending.d, sink->pending.d + sink->pending_offset, sink->pending.l - sink->pending_offset);
+		sink->pending.l -= sink->pending_offset;
+		sink->pending_offset = 0;
+	}
+}
+
+static void sink_send_frame(xdebug_sink *sink, char type, const char *payload, size_t payload_length)
+{
+	char   header[XDEBUG_SINK_FRAME_HEADER_SIZE];
+	size_t written = 0;
+
+	if (sink->broken) {
+		sink->dropped += payload_length;
+		return;
+	}
+
+	put_uint32(header, (uint32_t) payload_length);
+	put_uint32(header + 4, (uint32_t) getpid());
+	put_uint32(header + 8, sink->stream_id);
+	header[12] = type;
+
+	sink_drain(sink);
+
+	/* Try to write the frame directly, which for a FIFO only works for the
+	 * whole frame at once */
+	if (sink->pending.l == 0) {
+		if (sink->is_fifo) {
+			char frame[PIPE_BUF];
+
+			memcpy(frame, header, XDEBUG_SINK_FRAME_HEADER_SIZE);
+			memcpy(frame + XDEBUG_SINK_FRAME_HEADER_SIZE, payload, payload_length);
+
+			if (sink_write_fd(sink, frame, XDEBUG_SINK_FRAME_HEADER_SIZE + payload_length) > 0) {
+				return;
+			}
+		} else {
+			written = sink_write_fd(sink, header, XDEBUG_SINK_FRAME_HEADER_SIZE);
+			if (written == XDEBUG_SINK_FRAME_HEADER_SIZE) {
+				written += sink_write_fd(sink, payload, payload_length);
+			}
+
+			if (written == XDEBUG_SINK_FRAME_HEADER_SIZE + payload_length) {
+				return;
+			}
+		}
+	}
+
+	/* Only whole frames can be dropped, as the collector would otherwise lose
+	 * track of where frames start. The rest of a partially written frame is
+	 * therefore always kept. */
+	if (written == 0 && (sink->broken || sink->pending.l - sink->pending_offset + XDEBUG_SINK_FRAME_HEADER_SIZE + payload_length > XDEBUG_SINK_BUFFER_SIZE)) {
+		sink->dropped += payload_length;
+		return;
+	}
+
+	if (written < XDEBUG_SINK_FRAME_HEADER_SIZE) {
+		xdebug_str_addl(&sink->pending, header + written, XDEBUG_SINK_FRAME_HEADER_SIZE - written, 0);
+		xdebug_str_addl(&sink->pending, payload, payload_length, 0);
+	} else {
+		written -= XDEBUG_SINK_FRAME_HEADER_SIZE;
+		xdebug_str_addl(&sink->pending, payload + written, payload_length - written, 0);
+	}
+}
+
+xdebug_sink *xdebug_sink_open(const char *path, const char *name)
+{
+	xdebug_sink *sink;
+	struct stat  buf;
+	int          fd;
+	int          is_fifo;
+
+	if (stat(path, &buf) != 0) {
+		xdebug_log_ex(XLOG_CHAN_BASE, XLOG_ERR, "SINK", "The output sink '%s' does not exist: %s", path, strerror(errno));
+		return NULL;
+	}
+
+	if (S_ISFIFO(buf.st_mode)) {
+		is_fifo = 1;
+
+		/* Fails with ENXIO when no collector has the FIFO open */
+		fd = open(path, O_WRONLY | O_NONBLOCK);
+		if (fd < 0) {
+			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_ERR, "SINK", "Could not open the output sink FIFO '%s': %s", path, strerror(errno));
+			return NULL;
+		}
+	} else if (S_ISSOCK(buf.st_mode)) {
+		struct sockaddr_un addr;
+
+		is_fifo = 0;
+
+		if (strlen(path) >= sizeof(addr.sun_path)) {
+			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_ERR, "SINK", "The path of the output sink socket '%s' is too long", path);
+			return NULL;
+		}
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path);
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+			xdebug_log_ex(XLOG_CHAN_BASE, XLOG_ERR, "SINK", "Could not connect to the output sink socket '%s': %s", path, strerror(errno));
+			if (fd >= 0) {
+				close(fd);
+			}
+			return NULL;
+		}
+#ifdef SO_NOSIGPIPE
+		{
+			int on = 1;
+			setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+		}
+#endif
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	} else {
+		xdebug_log_ex(XLOG_CHAN_BASE, XLOG_ERR, "SINK", "The output sink '%s' is not a Unix domain socket or a FIFO", path);
+		return NULL;
+	}
+
+	sink = xdcalloc(1, sizeof(xdebug_sink));
+	sink->fd = fd;
+	sink->is_fifo = is_fifo;
+	sink->stream_id = __atomic_add_fetch(&last_stream_id, 1, __ATOMIC_RELAXED);
+	sink->max_frame = is_fifo ? PIPE_BUF : SINK_SOCKET_MAX_FRAME;
+
+	sink_send_frame(sink, XDEBUG_SINK_FRAME_OPEN, name, strlen(name) < sink->max_frame - XDEBUG_SINK_FRAME_HEADER_SIZE ? strlen(name) : sink->max_frame - XDEBUG_SINK_FRAME_HEADER_SIZE);
+
+	return sink;
+}
+
+void xdebug_sink_write(xdebug_sink *sink, const char *data, size_t length)
+{
+	size_t max_payload = sink->max_frame - XDEBUG_SINK_FRAME_HEADER_SIZE;
+
+	while (length > 0) {
+		size_t chunk = length < max_payload ? length : max_payload;
+
+		sink_send_frame(sink, XDEBUG_SINK_FRAME_DATA, data, chunk);
+		data += chunk;
+		length -= chunk;
+	}
+}
+
+void xdebug_sink_flush(xdebug_sink *sink)
+{
+	sink_drain(sink);
+}
+
+/* Gives the collector a little time to read what is still pending, sends the
+ * close frame with the number of dropped bytes, and frees the sink */
+void xdebug_sink_close(xdebug_sink *sink, const char *name)
+{
+	char payload[8];
+	int  tries;
+
+	for (tries = 0; tries < SINK_CLOSE_WAIT_TRIES && sink->pending.l && !sink->broken; tries++) {
+		struct pollfd pfd;
+
+		pfd.fd = sink->fd;
+		pfd.events = POLLOUT;
+		poll(&pfd, 1, SINK_CLOSE_WAIT_MS);
+
+		sink_drain(sink);
+	}
+
+	put_uint32(payload, (uint32_t) ((uint64_t) sink->dropped >> 32));
+	put_uint32(payload + 4, (uint32_t) sink->dropped);
+	sink_send_frame(sink, XDEBUG_SINK_FRAME_CLOSE, payload, sizeof(payload));
+	sink_drain(sink);
+
+	if (sink->pending.l - sink->pending_offset) {
+		sink->dropped += sink->pending.l - sink->pending_offset;
+	}
+	if (sink->dropped) {
+		xdebug_log_ex(
+			XLOG_CHAN_BASE, XLOG_WARN, "SINKDROP",
+			"The collector of '%s' could not keep up, and %lu bytes were dropped",
+			name, sink->dropped
+		);
+	}
+
+	close(sink->fd);
+	xdebug_str_destroy(&sink->pending);
+	xdfree(sink);
+}
+#else
+xdebug_sink *xdebug_sink_open(const char *path, const char *name)
+{
+	xdebug_log_ex(XLOG_CHAN_BASE, XLOG_ERR, "SINK", "Writing to an output sink is not supported on this platform");
+
+	return NULL;
+}
+
+void xdebug_sink_write(xdebug_sink *sink, const char *data, size_t length)
+{
+}
+
+void xdebug_sink_flush(xdebug_sink *sink)
+{
+}
+
+void xdebug_sink_close(xdebug_sink *sink, const char *name)
+{
+}
+#endif
@@ -0,0 +1,56 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __HAVE_LIB_SINK_H__
+#define __HAVE_LIB_SINK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "str.h"
+
+/* How much data is kept while the collector does not read fast enough,
+ * before new data gets dropped */
+#define XDEBUG_SINK_BUFFER_SIZE (4 * 1024 * 1024)
+
+#define XDEBUG_SINK_FRAME_OPEN  'O'
+#define XDEBUG_SINK_FRAME_DATA  'D'
+#define XDEBUG_SINK_FRAME_CLOSE 'C'
+
+/* length (4), pid (4), stream id (4), and type (1) */
+#define XDEBUG_SINK_FRAME_HEADER_SIZE 13
+
+/* A Unix domain socket or FIFO that a collector reads from. Each file that is
+ * written to it is a stream of framed records. Writes never block: what can
+ * not be written right away is kept in 'pending', and once that is full,
+ * further data is dropped and counted. */
+typedef struct _xdebug_sink {
+	int            fd;
+	int            is_fifo;
+	int            broken;     /* the collector went away */
+	uint32_t       stream_id;
+	size_t         max_frame;  /* frames to a FIFO must be written atomically */
+	xdebug_str     pending;
+	size_t         pending_offset;
+	unsigned long  dropped;    /* in bytes */
+} xdebug_sink;
+
+xdebug_sink *xdebug_sink_open(const char *path, const char *name);
+void xdebug_sink_write(xdebug_sink *sink, const char *data, size_t length);
+void xdebug_sink_flush(xdebug_sink *sink);
+void xdebug_sink_close(xdebug_sink *sink, const char *name);
+
+#endif
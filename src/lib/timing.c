@@ -21,6 +21,7 @@
 # include <versionhelpers.h>
 #else
 # include <sys/time.h>
+# include <time.h>
 #endif
 
 #if HAVE_XDEBUG_CLOCK_GETTIME_NSEC_NP
@@ -30,9 +31,23 @@
 #endif
 
 #include "timing.h"
+#include "lib_private.h"
+#include "log.h"
+
+/* The TSC is only used as a faster replacement for CLOCK_MONOTONIC, against
+ * which it gets calibrated */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && HAVE_XDEBUG_CLOCK_GETTIME && !HAVE_XDEBUG_CLOCK_GETTIME_NSEC_NP
+# define XDEBUG_TSC 1
+# include <cpuid.h>
+# include <x86intrin.h>
+#else
+# define XDEBUG_TSC 0
+#endif
 
 #define NANOTIME_MIN_STEP 10
 
+#define TSC_CALIBRATION_NANOS (10 * NANOS_IN_MILLISEC)
+
 #if PHP_WIN32
 # define WIN_NANOS_IN_TICK          100
 # define WIN_TICKS_SINCE_1601_JAN_1 116444736000000000ULL
@@ -126,6 +141,104 @@ static uint64_t xdebug_get_nanotime_rel(xdebug_nanotime_context *nanotime_contex
 }
 #endif
 
+/* Returns the CPU time that the current thread has used, in nanoseconds, or 0
+ * if the platform can not tell */
+uint64_t xdebug_get_thread_cputime(void)
+{
+#if PHP_WIN32
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+
+	if (GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+		return (
+			(((uint64_t)kernel_time.dwHighDateTime << 32) + (uint64_t)kernel_time.dwLowDateTime) +
+			(((uint64_t)user_time.dwHighDateTime << 32) + (uint64_t)user_time.dwLowDateTime)
+		) * WIN_NANOS_IN_TICK;
+	}
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+		return (uint64_t)ts.tv_sec * NANOS_IN_SEC + (uint64_t)ts.tv_nsec;
+	}
+#endif
+
+	return 0;
+}
+
+#if XDEBUG_TSC
+/* Nanoseconds per TSC tick, as 32.32 fixed point number. This is process
+ * wide, as the TSC runs at the same rate for every thread. It stays 0 if the
+ * TSC is not used. */
+static uint64_t tsc_nanos_per_tick = 0;
+
+/* An invariant TSC runs at a constant rate in all ACPI P-, C-, and T-states,
+ * and is synchronised between cores */
+static int tsc_is_invariant(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+		return 0;
+	}
+
+	return (edx & (1 << 8)) != 0;
+}
+
+static int tsc_calibrate(void)
+{
+	uint64_t start_nanotime, end_nanotime;
+	uint64_t start_ticks, end_ticks;
+	uint64_t nanos_per_tick;
+
+	if (!tsc_is_invariant()) {
+		return 0;
+	}
+
+	start_nanotime = xdebug_get_nanotime_rel(NULL);
+	start_ticks = __rdtsc();
+	do {
+		end_nanotime = xdebug_get_nanotime_rel(NULL);
+	} while (end_nanotime - start_nanotime < TSC_CALIBRATION_NANOS);
+	end_ticks = __rdtsc();
+
+	if (end_ticks <= start_ticks) {
+		return 0;
+	}
+
+	nanos_per_tick = ((end_nanotime - start_nanotime) << 32) / (end_ticks - start_ticks);
+
+	/* The conversion below assumes a TSC rate of more than 1 GHz */
+	if (nanos_per_tick == 0 || nanos_per_tick >= ((uint64_t) 1 << 32)) {
+		return 0;
+	}
+
+	tsc_nanos_per_tick = nanos_per_tick;
+
+	return 1;
+}
+
+static inline uint64_t xdebug_get_nanotime_tsc(void)
+{
+	uint64_t ticks = __rdtsc();
+
+	/* Split, as 'ticks * tsc_nanos_per_tick' would overflow */
+	return (ticks >> 32) * tsc_nanos_per_tick + (((ticks & 0xFFFFFFFF) * tsc_nanos_per_tick) >> 32);
+}
+#endif
+
+#if PHP_WIN32 | HAVE_XDEBUG_CLOCK_GETTIME | HAVE_XDEBUG_CLOCK_GETTIME_NSEC_NP
+static inline uint64_t xdebug_get_nanotime_rel_or_tsc(xdebug_nanotime_context *nanotime_context)
+{
+# if XDEBUG_TSC
+	if (nanotime_context->use_tsc) {
+		return xdebug_get_nanotime_tsc();
+	}
+# endif
+
+	return xdebug_get_nanotime_rel(nanotime_context);
+}
+#endif
+
 void xdebug_nanotime_init(xdebug_base_globals_t *base)
 {
 	xdebug_nanotime_context context = {0};
@@ -149,27 +262,49 @@ void xdebug_nanotime_init(xdebug_base_globals_t *base)
 	context.use_rel_time = 1;
 #endif
 
+#if XDEBUG_TSC
+	context.use_tsc = tsc_nanos_per_tick != 0;
+#endif
+
 	context.start_abs = xdebug_get_nanotime_abs(&context);
 	context.last_abs = 0;
 #if PHP_WIN32 | HAVE_XDEBUG_CLOCK_GETTIME | HAVE_XDEBUG_CLOCK_GETTIME_NSEC_NP
-	context.start_rel = xdebug_get_nanotime_rel(&context);
+	context.start_rel = xdebug_get_nanotime_rel_or_tsc(&context);
 	context.last_rel = 0;
 #endif
 
 	base->nanotime_context = context;
 }
 
-uint64_t xdebug_get_nanotime(void)
+/* Selects the clock source with xdebug.clock_source, which can only be done
+ * once the INI settings have been read */
+void xdebug_nanotime_minit(void)
 {
-	uint64_t nanotime;
-	xdebug_nanotime_context *context;
+	if (strcmp(XINI_LIB(clock_source), "tsc") == 0) {
+#if XDEBUG_TSC
+		if (!tsc_calibrate()) {
+			xdebug_log_ex(XLOG_CHAN_CONFIG, XLOG_WARN, "TSC", "The TSC is not invariant, or could not be calibrated, falling back to the default clock source");
+		}
+#else
+		xdebug_log_ex(XLOG_CHAN_CONFIG, XLOG_WARN, "TSC", "The TSC clock source is not supported on this platform, falling back to the default clock source");
+#endif
+	} else if (strcmp(XINI_LIB(clock_source), "default") != 0) {
+		xdebug_log_ex(XLOG_CHAN_CONFIG, XLOG_WARN, "CLOCK", "The clock source '%s' is not supported, falling back to the default clock source", XINI_LIB(clock_source));
+	}
 
-	context = &XG_BASE(nanotime_context);
+	/* The context of the current thread was created before the settings
+	 * were known */
+	xdebug_nanotime_init(&XG(globals.base));
+}
+
+static uint64_t xdebug_get_nanotime_from_context(xdebug_nanotime_context *context)
+{
+	uint64_t nanotime;
 
 #if PHP_WIN32 | HAVE_XDEBUG_CLOCK_GETTIME | HAVE_XDEBUG_CLOCK_GETTIME_NSEC_NP
 	/* Relative timing */
 	if (context->use_rel_time) {
-		nanotime = xdebug_get_nanotime_rel(context);
+		nanotime = xdebug_get_nanotime_rel_or_tsc(context);
 
 		if (nanotime < context->last_rel + NANOTIME_MIN_STEP) {
 			context->last_rel += NANOTIME_MIN_STEP;
@@ -194,6 +329,20 @@ uint64_t xdebug_get_nanotime(void)
 	return nanotime;
 }
 
+uint64_t xdebug_get_nanotime(void)
+{
+	return xdebug_get_nanotime_from_context(&XG_BASE(nanotime_context));
+}
+
+int xdebug_nanotime_uses_tsc(void)
+{
+#if XDEBUG_TSC
+	return XG_BASE(nanotime_context).use_tsc;
+#else
+	return 0;
+#endif
+}
+
 char* xdebug_nanotime_to_chars(uint64_t nanotime, unsigned char precision)
 {
 	char *res;
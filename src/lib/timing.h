@@ -22,8 +22,11 @@
 #define NANOS_IN_SEC      1000000000
 
 void xdebug_nanotime_init(xdebug_base_globals_t *xg);
+void xdebug_nanotime_minit(void);
+int xdebug_nanotime_uses_tsc(void);
 
 uint64_t xdebug_get_nanotime(void);
+uint64_t xdebug_get_thread_cputime(void);
 
 char* xdebug_nanotime_to_chars(uint64_t nanotime, unsigned char precision);
 
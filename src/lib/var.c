@@ -946,6 +946,21 @@ xdebug_var_export_options* xdebug_var_export_options_from_ini(void)
 	return options;
 }
 
+/* Reads the settings again, if they have been changed with ini_set() since
+ * 'options' were created from them */
+void xdebug_var_export_options_refresh_from_ini(xdebug_var_export_options **options, unsigned int *generation)
+{
+	if (*generation == XG_LIB(var_display_generation)) {
+		return;
+	}
+
+	xdfree((*options)->runtime);
+	xdfree(*options);
+
+	*options = xdebug_var_export_options_from_ini();
+	*generation = XG_LIB(var_display_generation);
+}
+
 xdebug_var_export_options xdebug_var_nolimit_options = { XDEBUG_MAX_INT, XDEBUG_MAX_INT, 1023, 1, 0, 0, 0, NULL, 0 };
 
 xdebug_var_export_options* xdebug_var_get_nolimit_options(void)
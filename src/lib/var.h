@@ -60,6 +60,7 @@ typedef struct xdebug_var_export_options {
 void xdebug_get_php_symbol(zval *retval, xdebug_str* name);
 
 xdebug_var_export_options* xdebug_var_export_options_from_ini(void);
+void xdebug_var_export_options_refresh_from_ini(xdebug_var_export_options **options, unsigned int *generation);
 xdebug_var_export_options* xdebug_var_get_nolimit_options(void);
 
 xdebug_str* xdebug_get_property_type(zval* object, zval *val);
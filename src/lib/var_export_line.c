@@ -335,9 +335,10 @@ void xdebug_var_export_line(zval **struc, xdebug_str *str, int level, int debug_
 	}
 }
 
-xdebug_str* xdebug_get_zval_value_line(zval *val, int debug_zval, xdebug_var_export_options *options)
+/* Appends to 'str', so that callers that build up a line do not need a
+ * separate xdebug_str for each value */
+void xdebug_add_zval_value_line(xdebug_str *str, zval *val, int debug_zval, xdebug_var_export_options *options)
 {
-	xdebug_str *str = xdebug_str_new();
 	int default_options = 0;
 
 	if (!options) {
@@ -351,6 +352,13 @@ xdebug_str* xdebug_get_zval_value_line(zval *val, int debug_zval, xdebug_var_exp
 		xdfree(options->runtime);
 		xdfree(options);
 	}
+}
+
+xdebug_str* xdebug_get_zval_value_line(zval *val, int debug_zval, xdebug_var_export_options *options)
+{
+	xdebug_str *str = xdebug_str_new();
+
+	xdebug_add_zval_value_line(str, val, debug_zval, options);
 
 	return str;
 }
@@ -0,0 +1,184 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#include "lib/php-header.h"
+
+#include "php_xdebug.h"
+#include "perf_events.h"
+
+#include "lib/log.h"
+#include "lib/mm.h"
+#include "lib/usefulstuff.h"
+
+#if HAVE_LINUX_PERF_EVENT_H
+# include <errno.h>
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+ZEND_EXTERN_MODULE_GLOBALS(xdebug)
+
+#if HAVE_LINUX_PERF_EVENT_H
+typedef struct _xdebug_perf_event_type {
+	const char *setting;
+	const char *name;
+	uint32_t    type;
+	uint64_t    config;
+} xdebug_perf_event_type;
+
+/* The names are used as cachegrind event names, which can not contain spaces */
+static const xdebug_perf_event_type perf_event_types[] = {
+	{ "instructions",     "Instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "cycles",           "Cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "cache-misses",     "Cache_misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ "branch-misses",    "Branch_misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "context-switches", "Context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+	{ NULL, NULL, 0, 0 }
+};
+
+static const xdebug_perf_event_type *find_perf_event_type(const char *setting)
+{
+	const xdebug_perf_event_type *pet;
+
+	for (pet = perf_event_types; pet->setting; pet++) {
+		if (strcmp(pet->setting, setting) == 0) {
+			return pet;
+		}
+	}
+
+	return NULL;
+}
+
+static int open_perf_event(const xdebug_perf_event_type *pet, int group_fd)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = pet->type;
+	attr.config = pet->config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.disabled = group_fd == -1 ? 1 : 0;
+	attr.exclude_hv = 1;
+	/* Counting the kernel for hardware events requires perf_event_paranoid
+	 * to be lower than 2. Context switches happen in the kernel. */
+	attr.exclude_kernel = pet->type == PERF_TYPE_HARDWARE ? 1 : 0;
+
+	/* Only the calling thread, on any CPU */
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+void xdebug_perf_events_open(xdebug_perf_events *pe, const char *setting)
+{
+	xdebug_arg *parts;
+	int         i;
+
+	pe->count = 0;
+
+	parts = xdebug_arg_ctor();
+	xdebug_explode(",", setting, parts, -1);
+
+	for (i = 0; i < parts->c; i++) {
+		char                         *event_name = xdebug_trim(parts->args[i]);
+		const xdebug_perf_event_type *pet;
+		int                           fd;
+
+		if (event_name[0] == '\0') {
+			xdfree(event_name);
+			continue;
+		}
+
+		pet = find_perf_event_type(event_name);
+
+		if (!pet) {
+			xdebug_log_ex(XLOG_CHAN_PROFILE, XLOG_WARN, "PERFEVT", "The profiler event '%s' is not supported", event_name);
+		} else if (pe->count == XDEBUG_PERF_EVENTS_MAX) {
+			xdebug_log_ex(XLOG_CHAN_PROFILE, XLOG_WARN, "PERFEVT", "Too many profiler events, ignoring '%s'", event_name);
+		} else {
+			/* The first event that opens becomes the group leader */
+			fd = open_perf_event(pet, pe->count ? pe->fds[0] : -1);
+
+			if (fd == -1) {
+				xdebug_log_ex(XLOG_CHAN_PROFILE, XLOG_WARN, "PERFEVT", "The profiler event '%s' can not be opened: %s", event_name, strerror(errno));
+			} else {
+				pe->fds[pe->count] = fd;
+				pe->names[pe->count] = pet->name;
+				pe->count++;
+			}
+		}
+
+		xdfree(event_name);
+	}
+
+	xdebug_arg_dtor(parts);
+
+	if (pe->count) {
+		ioctl(pe->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(pe->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+}
+
+void xdebug_perf_events_close(xdebug_perf_events *pe)
+{
+	int i;
+
+	/* Siblings first, the group leader last */
+	for (i = pe->count - 1; i >= 0; i--) {
+		close(pe->fds[i]);
+	}
+
+	pe->count = 0;
+}
+
+/* Reads the current value of each opened event, in the order of 'names',
+ * with one system call. The values are all 0 if that fails. */
+int xdebug_perf_events_read(xdebug_perf_events *pe, uint64_t *values)
+{
+	uint64_t buffer[1 + XDEBUG_PERF_EVENTS_MAX];
+	int      i;
+
+	if (read(pe->fds[0], buffer, sizeof(buffer)) < (ssize_t) sizeof(uint64_t) || buffer[0] != (uint64_t) pe->count) {
+		memset(values, 0, pe->count * sizeof(uint64_t));
+		return 0;
+	}
+
+	for (i = 0; i < pe->count; i++) {
+		values[i] = buffer[1 + i];
+	}
+
+	return 1;
+}
+#else
+void xdebug_perf_events_open(xdebug_perf_events *pe, const char *setting)
+{
+	pe->count = 0;
+
+	if (setting[0] != '\0') {
+		xdebug_log_ex(XLOG_CHAN_PROFILE, XLOG_WARN, "PERFEVT", "Profiler events are not supported on this platform");
+	}
+}
+
+void xdebug_perf_events_close(xdebug_perf_events *pe)
+{
+}
+
+int xdebug_perf_events_read(xdebug_perf_events *pe, uint64_t *values)
+{
+	return 0;
+}
+#endif
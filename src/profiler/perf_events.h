@@ -0,0 +1,39 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __XDEBUG_PROFILER_PERF_EVENTS_H__
+#define __XDEBUG_PROFILER_PERF_EVENTS_H__
+
+#include <stdint.h>
+
+#define XDEBUG_PERF_EVENTS_MAX 5
+
+/* Hardware and software counters through perf_event_open(2), which are read
+ * all at once as one group. Events that the kernel refuses to open (because
+ * of perf_event_paranoid, seccomp, or missing hardware support in a VM) are
+ * left out, in which case 'count' is lower than the number of requested
+ * events. */
+typedef struct _xdebug_perf_events {
+	int         count;
+	int         fds[XDEBUG_PERF_EVENTS_MAX];
+	const char *names[XDEBUG_PERF_EVENTS_MAX];
+} xdebug_perf_events;
+
+void xdebug_perf_events_open(xdebug_perf_events *pe, const char *setting);
+void xdebug_perf_events_close(xdebug_perf_events *pe);
+int  xdebug_perf_events_read(xdebug_perf_events *pe, uint64_t *values);
+
+#endif
@@ -0,0 +1,476 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#include "lib/php-header.h"
+#include "Zend/zend_alloc.h"
+
+#include "php_xdebug.h"
+#include "profiler_private.h"
+#include "profile_cachegrind.h"
+
+#include "base/function_identity.h"
+#include "lib/arena.h"
+#include "lib/mm.h"
+#include "lib/str.h"
+
+extern ZEND_DECLARE_MODULE_GLOBALS(xdebug);
+
+#define XDEBUG_CALL_ENTRIES_INITIAL_SIZE 4
+#define XDEBUG_ARENA_BLOCK_SIZE          65536
+
+static void xdebug_profile_filename_ref_dtor(void *elem)
+{
+	xdebug_profile_filename_ref *ref = elem;
+
+	xdfree(ref->name);
+	xdfree(ref);
+}
+
+static xdebug_profile_cachegrind_context *cachegrind_context_ctor(char *fname, int allow_async_writer)
+{
+	xdebug_profile_cachegrind_context *tmp_cachegrind_context;
+
+	tmp_cachegrind_context = xdmalloc(sizeof(xdebug_profile_cachegrind_context));
+	tmp_cachegrind_context->profile_file = xdebug_profiler_open_file(fname, NULL, allow_async_writer);
+
+	if (!tmp_cachegrind_context->profile_file) {
+		xdfree(tmp_cachegrind_context);
+		return NULL;
+	}
+
+	tmp_cachegrind_context->filename_refs = xdebug_hash_alloc(128, xdebug_profile_filename_ref_dtor);
+	tmp_cachegrind_context->last_filename_ref = 1;
+	tmp_cachegrind_context->php_internal_seen_before = 0;
+	tmp_cachegrind_context->functionname_refs = xdebug_hash_alloc(128, xdfree);
+	tmp_cachegrind_context->last_functionname_ref = 0;
+	tmp_cachegrind_context->arena = xdebug_arena_ctor(XDEBUG_ARENA_BLOCK_SIZE);
+
+	return tmp_cachegrind_context;
+}
+
+void *xdebug_profile_cachegrind_init(char *fname)
+{
+	return cachegrind_context_ctor(fname, 1);
+}
+
+void xdebug_profile_cachegrind_deinit(void *ctxt)
+{
+	xdebug_profile_cachegrind_context *context = (xdebug_profile_cachegrind_context*) ctxt;
+
+	xdebug_file_close(context->profile_file);
+	xdebug_file_dtor(context->profile_file);
+	context->profile_file = NULL;
+
+	xdebug_hash_destroy(context->filename_refs);
+	xdebug_hash_destroy(context->functionname_refs);
+	xdebug_arena_dtor(context->arena);
+
+	xdfree(context);
+}
+
+/* 'requests' is only written for profiles that are merged from more than one
+ * request */
+static void write_header(xdebug_profile_cachegrind_context *context, char *script_name, unsigned long requests, int event_count, const char **event_names)
+{
+	int i;
+
+	if (XINI_PROF(profiler_append)) {
+		xdebug_file_printf(context->profile_file, "\n==== NEW PROFILING FILE ==============================================\n");
+	}
+	xdebug_file_printf(context->profile_file, "version: 1\ncreator: xdebug %s (PHP %s)\n", XDEBUG_VERSION, XG_BASE(php_version_run_time));
+	xdebug_file_printf(context->profile_file, "cmd: %s\n", script_name);
+	if (requests) {
+		xdebug_file_printf(context->profile_file, "desc: Requests: %lu\n", requests);
+	}
+	xdebug_file_printf(context->profile_file, "part: 1\npositions: line\n\n");
+	xdebug_file_printf(context->profile_file, "events: Time_(10ns) Memory_(bytes)");
+	for (i = 0; i < event_count; i++) {
+		xdebug_file_printf(context->profile_file, " %s", event_names[i]);
+	}
+	xdebug_file_printf(context->profile_file, "\n\n");
+	xdebug_file_flush(context->profile_file);
+}
+
+static void write_summary(xdebug_profile_cachegrind_context *context, uint64_t nanotime, size_t peak_memory, int event_count, uint64_t *events)
+{
+	int i;
+
+	xdebug_file_printf(context->profile_file, "summary: %lu %zd", NANOTIME_SCALE_10NS(nanotime), peak_memory);
+	for (i = 0; i < event_count; i++) {
+		xdebug_file_printf(context->profile_file, " %lu", (unsigned long) events[i]);
+	}
+	xdebug_file_printf(context->profile_file, "\n\n");
+
+	xdebug_file_flush(context->profile_file);
+}
+
+void xdebug_profile_cachegrind_write_header(void *ctxt, char *script_name)
+{
+	xdebug_profile_cachegrind_context *context = (xdebug_profile_cachegrind_context*) ctxt;
+
+	write_header(context, script_name, 0, XG_PROF(event_count), XG_PROF(event_names));
+}
+
+char *xdebug_profile_cachegrind_get_filename(void *ctxt)
+{
+	xdebug_profile_cachegrind_context *context = (xdebug_profile_cachegrind_context*) ctxt;
+
+	return context->profile_file->name;
+}
+
+static xdebug_profile_filename_ref *find_or_add_filename_ref(xdebug_profile_cachegrind_context *context, const char *name, size_t name_len)
+{
+	xdebug_profile_filename_ref *ref;
+
+	if (!xdebug_hash_find(context->filename_refs, name, name_len, (void*) &ref)) {
+		ref = xdmalloc(sizeof(xdebug_profile_filename_ref));
+		ref->id = 0;
+		ref->name = xdstrdup(name);
+
+		xdebug_hash_add(context->filename_refs, name, name_len, (void*) ref);
+	}
+
+	return ref;
+}
+
+static inline void add_filename_ref(xdebug_profile_cachegrind_context *context, xdebug_str *buffer, xdebug_profile_filename_ref *ref)
+{
+	xdebug_str_addc(buffer, '(');
+
+	if (ref->id) {
+		xdebug_str_add_uint64(buffer, ref->id);
+		xdebug_str_addc(buffer, ')');
+	} else {
+		context->last_filename_ref++;
+		ref->id = context->last_filename_ref;
+
+		xdebug_str_add_uint64(buffer, ref->id);
+		xdebug_str_add_literal(buffer, ") ");
+		xdebug_str_add(buffer, ref->name, 0);
+	}
+}
+
+static inline void add_functionname_ref(xdebug_profile_cachegrind_context *context, xdebug_str *buffer, xdebug_function_identity *fi, int user_defined)
+{
+	char          *ref;
+	unsigned long  key = FUNCTIONNAME_REF_KEY(fi, user_defined);
+
+	if (xdebug_hash_index_find(context->functionname_refs, key, (void*) &ref)) {
+		xdebug_str_add(buffer, ref, 0);
+	} else {
+		context->last_functionname_ref++;
+		ref = xdebug_sprintf("(%d)", context->last_functionname_ref);
+
+		xdebug_hash_index_add(context->functionname_refs, key, (void*) ref);
+
+		xdebug_str_add(buffer, ref, 0);
+		xdebug_str_addc(buffer, ' ');
+		if (user_defined == XDEBUG_BUILT_IN) {
+			xdebug_str_add_literal(buffer, "php::");
+		}
+		xdebug_str_addl(buffer, fi->name, fi->name_len, 0);
+	}
+}
+
+/* Adds the cost of each additional event, such as hardware counters. Frames
+ * that started before the profiler did have no event costs. */
+static inline void add_event_costs(xdebug_str *buffer, uint64_t *events, int event_count)
+{
+	int i;
+
+	for (i = 0; i < event_count; i++) {
+		xdebug_str_addc(buffer, ' ');
+		xdebug_str_add_uint64(buffer, events ? events[i] : 0);
+	}
+}
+
+/* Adds the fl= and fn= lines, or the cfl= and cfn= lines when prefix is "c" */
+static void add_function_refs(xdebug_profile_cachegrind_context *context, xdebug_str *buffer, const char *prefix, int user_defined, xdebug_profile_filename_ref *filename, xdebug_function_identity *fi)
+{
+	xdebug_str_add(buffer, prefix, 0);
+	if (user_defined == XDEBUG_BUILT_IN) {
+		if (context->php_internal_seen_before) {
+			xdebug_str_add_literal(buffer, "fl=(1)\n");
+		} else {
+			xdebug_str_add_literal(buffer, "fl=(1) php:internal\n");
+			context->php_internal_seen_before = 1;
+		}
+	} else {
+		xdebug_str_add_literal(buffer, "fl=");
+		add_filename_ref(context, buffer, filename);
+		xdebug_str_addc(buffer, '\n');
+	}
+
+	xdebug_str_add(buffer, prefix, 0);
+	xdebug_str_add_literal(buffer, "fn=");
+	add_functionname_ref(context, buffer, fi, user_defined);
+	xdebug_str_addc(buffer, '\n');
+}
+
+static xdebug_profile_filename_ref *aggregated_function_filename_ref(xdebug_profile_cachegrind_context *context, xdebug_aggregated_function *af)
+{
+	if (af->user_defined == XDEBUG_BUILT_IN) {
+		return NULL;
+	}
+
+	return find_or_add_filename_ref(context, af->filename, strlen(af->filename));
+}
+
+static void write_aggregated_functions(xdebug_profile_cachegrind_context *context, xdebug_llist *function_list, int event_count)
+{
+	xdebug_llist_element *le, *cle;
+
+	for (le = XDEBUG_LLIST_HEAD(function_list); le != NULL; le = XDEBUG_LLIST_NEXT(le)) {
+		xdebug_aggregated_function *af = XDEBUG_LLIST_VALP(le);
+		xdebug_str                  file_buffer = XDEBUG_STR_INITIALIZER;
+
+		add_function_refs(context, &file_buffer, "", af->user_defined, aggregated_function_filename_ref(context, af), af->function);
+
+		/* Adds %d %lu %lu, with lineno, time, and memory */
+		xdebug_str_add_uint64(&file_buffer, af->lineno);
+		xdebug_str_addc(&file_buffer, ' ');
+		xdebug_str_add_uint64(&file_buffer, NANOTIME_SCALE_10NS(af->nanotime));
+		xdebug_str_addc(&file_buffer, ' ');
+		xdebug_str_add_uint64(&file_buffer, af->mem_used);
+		add_event_costs(&file_buffer, af->events, event_count);
+		xdebug_str_addc(&file_buffer, '\n');
+
+		for (cle = XDEBUG_LLIST_HEAD(af->calls); cle != NULL; cle = XDEBUG_LLIST_NEXT(cle)) {
+			xdebug_aggregated_call *ac = XDEBUG_LLIST_VALP(cle);
+
+			add_function_refs(context, &file_buffer, "c", ac->callee->user_defined, aggregated_function_filename_ref(context, ac->callee), ac->callee->function);
+
+			xdebug_str_add_literal(&file_buffer, "calls=");
+			xdebug_str_add_uint64(&file_buffer, ac->calls);
+			xdebug_str_add_literal(&file_buffer, " 0 0\n");
+
+			/* Adds %d %lu %lu, with lineno, time, and memory */
+			xdebug_str_add_uint64(&file_buffer, ac->lineno);
+			xdebug_str_addc(&file_buffer, ' ');
+			xdebug_str_add_uint64(&file_buffer, NANOTIME_SCALE_10NS(ac->nanotime_taken));
+			xdebug_str_addc(&file_buffer, ' ');
+			xdebug_str_add_uint64(&file_buffer, ac->mem_used);
+			add_event_costs(&file_buffer, ac->events, event_count);
+			xdebug_str_addc(&file_buffer, '\n');
+		}
+		xdebug_str_addc(&file_buffer, '\n');
+
+		xdebug_file_write(file_buffer.d, sizeof(char), file_buffer.l, context->profile_file);
+		xdebug_str_dtor(file_buffer);
+	}
+}
+
+/* Every sample is the own cost of exactly one function */
+static uint64_t count_samples(xdebug_llist *function_list)
+{
+	xdebug_llist_element *le;
+	uint64_t              samples = 0;
+
+	for (le = XDEBUG_LLIST_HEAD(function_list); le != NULL; le = XDEBUG_LLIST_NEXT(le)) {
+		xdebug_aggregated_function *af = XDEBUG_LLIST_VALP(le);
+
+		samples += af->events[XDEBUG_PROFILER_SAMPLES_EVENT];
+	}
+
+	return samples;
+}
+
+void xdebug_profile_cachegrind_write_footer(void *ctxt)
+{
+	xdebug_profile_cachegrind_context *context = (xdebug_profile_cachegrind_context*) ctxt;
+	uint64_t                           events[XDEBUG_PROFILER_MAX_EVENTS];
+	int                                i;
+
+	if (XG_PROF(aggregated_function_list)) {
+		write_aggregated_functions(context, XG_PROF(aggregated_function_list), XG_PROF(event_count));
+	}
+
+	if (XG_PROF(sampling)) {
+		events[XDEBUG_PROFILER_SAMPLES_EVENT] = count_samples(XG_PROF(aggregated_function_list));
+	} else if (XG_PROF(event_count)) {
+		xdebug_profiler_read_events(events);
+		for (i = 0; i < XG_PROF(event_count); i++) {
+			events[i] -= XG_PROF(events_start)[i];
+		}
+	}
+
+	write_summary(
+		context,
+		xdebug_get_nanotime() - XG_PROF(profiler_start_nanotime),
+		zend_memory_peak_usage(0),
+		XG_PROF(event_count), events
+	);
+}
+
+/* Writes the call graph that was merged from several requests into a file of
+ * its own, which gets opened and closed here. This can run while a thread or
+ * the process shuts down, so no writer thread is used. */
+void xdebug_profile_cachegrind_write_merged(xdebug_profiler_merged *merged)
+{
+	xdebug_profile_cachegrind_context *context = cachegrind_context_ctor(merged->fname, 0);
+
+	if (!context) {
+		return;
+	}
+
+	write_header(context, merged->script_name, merged->requests, merged->event_count, merged->event_names);
+	write_aggregated_functions(context, merged->function_list, merged->event_count);
+	write_summary(context, merged->nanotime, merged->peak_memory, merged->event_count, merged->events);
+
+	xdebug_profile_cachegrind_deinit(context);
+}
+
+/* Returns a new entry at the end of the frame's call array, which grows by
+ * doubling its size */
+static xdebug_call_entry *add_call_entry(xdebug_profile_cachegrind_context *context, function_stack_entry *fse)
+{
+	if (fse->profile.call_entries_count == fse->profile.call_entries_size) {
+		size_t             entry_size = XDEBUG_CALL_ENTRY_SIZE(XG_PROF(event_count));
+		unsigned int       new_size = fse->profile.call_entries_size ? fse->profile.call_entries_size * 2 : XDEBUG_CALL_ENTRIES_INITIAL_SIZE;
+		xdebug_call_entry *new_entries = xdebug_arena_malloc(context->arena, new_size * entry_size);
+
+		if (fse->profile.call_entries) {
+			memcpy(new_entries, fse->profile.call_entries, fse->profile.call_entries_count * entry_size);
+			xdebug_arena_free(context->arena, fse->profile.call_entries, fse->profile.call_entries_size * entry_size);
+		}
+
+		fse->profile.call_entries = new_entries;
+		fse->profile.call_entries_size = new_size;
+	}
+
+	return XDEBUG_CALL_ENTRY(fse->profile.call_entries, fse->profile.call_entries_count++);
+}
+
+static void release_call_entries(xdebug_profile_cachegrind_context *context, function_stack_entry *fse)
+{
+	if (fse->profile.call_entries) {
+		xdebug_arena_free(context->arena, fse->profile.call_entries, fse->profile.call_entries_size * XDEBUG_CALL_ENTRY_SIZE(XG_PROF(event_count)));
+	}
+
+	fse->profile.call_entries = NULL;
+	fse->profile.call_entries_count = 0;
+	fse->profile.call_entries_size = 0;
+}
+
+void xdebug_profile_cachegrind_function_end(void *ctxt, function_stack_entry *fse)
+{
+	xdebug_profile_cachegrind_context *context = (xdebug_profile_cachegrind_context*) ctxt;
+	xdebug_profile_filename_ref       *filename_ref = NULL;
+	xdebug_str                         file_buffer = XDEBUG_STR_INITIALIZER;
+	unsigned int                       i;
+
+	if (fse->user_defined == XDEBUG_USER_DEFINED) {
+		filename_ref = find_or_add_filename_ref(context, ZSTR_VAL(fse->profiler.filename), ZSTR_LEN(fse->profiler.filename));
+	}
+
+	if (xdebug_vector_element_is_valid(XG_BASE(stack), fse - 1)) {
+		xdebug_call_entry *ce = add_call_entry(context, fse - 1);
+
+		ce->filename = filename_ref;
+		ce->function = fse->profiler.function;
+		ce->nanotime_taken = fse->profile.nanotime;
+		ce->lineno = fse->lineno;
+		ce->user_defined = fse->user_defined;
+		ce->mem_used = fse->profile.memory;
+		if (fse->profile.events) {
+			memcpy(ce->events, fse->profile.events, XG_PROF(event_count) * sizeof(uint64_t));
+		} else {
+			memset(ce->events, 0, XG_PROF(event_count) * sizeof(uint64_t));
+		}
+	}
+
+	/* use previously created filename and funcname (or a reference to them) to show
+	 * time spend */
+	add_function_refs(context, &file_buffer, "", fse->user_defined, filename_ref, fse->profiler.function);
+
+	/* Subtract time in calledfunction from time here */
+	for (i = 0; i < fse->profile.call_entries_count; i++) {
+		xdebug_call_entry *call_entry = XDEBUG_CALL_ENTRY(fse->profile.call_entries, i);
+
+		int                j;
+
+		fse->profile.nanotime -= call_entry->nanotime_taken;
+		fse->profile.memory -= call_entry->mem_used;
+		for (j = 0; fse->profile.events && j < XG_PROF(event_count); j++) {
+			fse->profile.events[j] -= call_entry->events[j];
+		}
+	}
+
+	/* Adds %d %lu %lu, with lineno, time, and memory */
+	xdebug_str_add_uint64(&file_buffer, fse->profiler.lineno);
+	xdebug_str_addc(&file_buffer, ' ');
+	xdebug_str_add_uint64(&file_buffer, NANOTIME_SCALE_10NS(fse->profile.nanotime));
+	xdebug_str_addc(&file_buffer, ' ');
+	xdebug_str_add_uint64(&file_buffer, fse->profile.memory >= 0 ? fse->profile.memory : 0);
+	add_event_costs(&file_buffer, fse->profile.events, XG_PROF(event_count));
+	xdebug_str_addc(&file_buffer, '\n');
+
+	/* dump call list */
+	for (i = 0; i < fse->profile.call_entries_count; i++) {
+		xdebug_call_entry *call_entry = XDEBUG_CALL_ENTRY(fse->profile.call_entries, i);
+
+		add_function_refs(context, &file_buffer, "c", call_entry->user_defined, call_entry->filename, call_entry->function);
+
+		xdebug_str_add_literal(&file_buffer, "calls=1 0 0\n");
+
+		/* Adds %d %lu %lu, with lineno, time, and memory */
+		xdebug_str_add_uint64(&file_buffer, call_entry->lineno);
+		xdebug_str_addc(&file_buffer, ' ');
+		xdebug_str_add_uint64(&file_buffer, NANOTIME_SCALE_10NS(call_entry->nanotime_taken));
+		xdebug_str_addc(&file_buffer, ' ');
+		xdebug_str_add_uint64(&file_buffer, call_entry->mem_used >= 0 ? call_entry->mem_used : 0);
+		add_event_costs(&file_buffer, call_entry->events, XG_PROF(event_count));
+		xdebug_str_addc(&file_buffer, '\n');
+	}
+	xdebug_str_addc(&file_buffer, '\n');
+
+	release_call_entries(context, fse);
+
+	xdebug_file_write(file_buffer.d, sizeof(char), file_buffer.l, context->profile_file);
+	xdebug_str_dtor(file_buffer);
+}
+
+/* Folds a sampled stack into the aggregated call graph, where each sample
+ * accounts for one sampling interval of time. The number of samples is kept
+ * in the "Samples" event, as samples are not calls, and 'calls=' is left at
+ * 0. */
+void xdebug_profile_cachegrind_add_sample(void *ctxt, xdebug_sampled_stack *ss)
+{
+	uint64_t nanotime = ss->count * XG_PROF(sample_interval);
+	int      i;
+
+	ss->frames[ss->depth - 1].function->nanotime += nanotime;
+	ss->frames[ss->depth - 1].function->events[XDEBUG_PROFILER_SAMPLES_EVENT] += ss->count;
+
+	for (i = 1; i < ss->depth; i++) {
+		xdebug_aggregated_call *ac = xdebug_profiler_find_or_add_aggregated_call(
+			ss->frames[i - 1].function, ss->frames[i].function, ss->frames[i].lineno
+		);
+
+		ac->nanotime_taken += nanotime;
+		ac->events[XDEBUG_PROFILER_SAMPLES_EVENT] += ss->count;
+	}
+}
+
+xdebug_profiler_handler_t xdebug_profiler_handler_cachegrind =
+{
+	xdebug_profile_cachegrind_init,
+	xdebug_profile_cachegrind_deinit,
+	xdebug_profile_cachegrind_write_header,
+	xdebug_profile_cachegrind_write_footer,
+	xdebug_profile_cachegrind_get_filename,
+	xdebug_profile_cachegrind_function_end,
+	xdebug_profile_cachegrind_add_sample
+};
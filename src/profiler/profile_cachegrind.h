@@ -0,0 +1,36 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#ifndef XDEBUG_PROFILE_CACHEGRIND_H
+#define XDEBUG_PROFILE_CACHEGRIND_H
+
+#include "profiler.h"
+#include "lib/arena.h"
+
+typedef struct _xdebug_profile_cachegrind_context
+{
+	xdebug_file *profile_file;
+	xdebug_hash *filename_refs;
+	int          last_filename_ref;
+	int          php_internal_seen_before;
+	xdebug_hash *functionname_refs;
+	int          last_functionname_ref;
+	xdebug_arena *arena;
+} xdebug_profile_cachegrind_context;
+
+extern xdebug_profiler_handler_t xdebug_profiler_handler_cachegrind;
+
+void xdebug_profile_cachegrind_write_merged(struct _xdebug_profiler_merged *merged);
+#endif
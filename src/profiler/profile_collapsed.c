@@ -0,0 +1,220 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#include "lib/php-header.h"
+
+#include "php_xdebug.h"
+#include "profiler_private.h"
+#include "profile_collapsed.h"
+
+#include "base/function_identity.h"
+#include "lib/mm.h"
+#include "lib/str.h"
+
+extern ZEND_DECLARE_MODULE_GLOBALS(xdebug);
+
+static void collapsed_node_dtor(void *dummy, void *elem)
+{
+	xdfree(elem);
+}
+
+void *xdebug_profile_collapsed_init(char *fname)
+{
+	xdebug_profile_collapsed_context *tmp_collapsed_context;
+
+	tmp_collapsed_context = xdmalloc(sizeof(xdebug_profile_collapsed_context));
+	tmp_collapsed_context->profile_file = xdebug_profiler_open_file(fname, "collapsed", 1);
+
+	if (!tmp_collapsed_context->profile_file) {
+		xdfree(tmp_collapsed_context);
+		return NULL;
+	}
+
+	tmp_collapsed_context->nodes = xdebug_hash_alloc(1024, NULL);
+	tmp_collapsed_context->node_list = xdebug_llist_alloc(collapsed_node_dtor);
+	tmp_collapsed_context->weight_is_samples = 0;
+
+	return tmp_collapsed_context;
+}
+
+void xdebug_profile_collapsed_deinit(void *ctxt)
+{
+	xdebug_profile_collapsed_context *context = (xdebug_profile_collapsed_context*) ctxt;
+
+	xdebug_file_close(context->profile_file);
+	xdebug_file_dtor(context->profile_file);
+	context->profile_file = NULL;
+
+	xdebug_hash_destroy(context->nodes);
+	xdebug_llist_destroy(context->node_list, NULL);
+
+	xdfree(context);
+}
+
+char *xdebug_profile_collapsed_get_filename(void *ctxt)
+{
+	xdebug_profile_collapsed_context *context = (xdebug_profile_collapsed_context*) ctxt;
+
+	return context->profile_file->name;
+}
+
+static xdebug_collapsed_node *find_or_add_node(xdebug_profile_collapsed_context *context, xdebug_collapsed_node *parent, xdebug_function_identity *fi, int user_defined)
+{
+	xdebug_collapsed_node     *node;
+	xdebug_collapsed_node_key  key;
+
+	/* The key is hashed as binary data, so padding needs to be cleared */
+	memset(&key, 0, sizeof(key));
+	key.parent = parent;
+	key.function = fi;
+	key.user_defined = user_defined;
+
+	if (!xdebug_hash_find(context->nodes, (char*) &key, sizeof(key), (void*) &node)) {
+		node = xdmalloc(sizeof(xdebug_collapsed_node));
+		node->parent = parent;
+		node->function = fi;
+		node->user_defined = user_defined;
+		node->weight = 0;
+
+		xdebug_hash_add(context->nodes, (char*) &key, sizeof(key), (void*) node);
+		xdebug_llist_insert_next(context->node_list, NULL, node);
+	}
+
+	return node;
+}
+
+static xdebug_collapsed_node *node_for_frame(xdebug_profile_collapsed_context *context, function_stack_entry *fse)
+{
+	function_stack_entry  *first = fse;
+	xdebug_collapsed_node *node = NULL;
+
+	if (fse->profiler.collapsed_node) {
+		return fse->profiler.collapsed_node;
+	}
+
+	/* Find the outermost frame that does not have its node yet, and then
+	 * build up the path from there */
+	while (xdebug_vector_element_is_valid(XG_BASE(stack), first - 1) && !(first - 1)->profiler.collapsed_node) {
+		first--;
+	}
+	if (xdebug_vector_element_is_valid(XG_BASE(stack), first - 1)) {
+		node = (first - 1)->profiler.collapsed_node;
+	}
+
+	for (; first <= fse; first++) {
+		xdebug_function_identity *fi = first->profiler.function ? first->profiler.function : xdebug_function_identity_for_frame(first);
+
+		node = find_or_add_node(context, node, fi, first->user_defined);
+		first->profiler.collapsed_node = node;
+	}
+
+	return node;
+}
+
+void xdebug_profile_collapsed_function_end(void *ctxt, function_stack_entry *fse)
+{
+	xdebug_profile_collapsed_context *context = (xdebug_profile_collapsed_context*) ctxt;
+	xdebug_collapsed_node            *node = node_for_frame(context, fse);
+
+	if (fse->profile.nanotime > fse->profile.nanotime_children) {
+		node->weight += fse->profile.nanotime - fse->profile.nanotime_children;
+	}
+}
+
+void xdebug_profile_collapsed_add_sample(void *ctxt, xdebug_sampled_stack *ss)
+{
+	xdebug_profile_collapsed_context *context = (xdebug_profile_collapsed_context*) ctxt;
+	xdebug_collapsed_node            *node = NULL;
+	int                               i;
+
+	context->weight_is_samples = 1;
+
+	for (i = 0; i < ss->depth; i++) {
+		node = find_or_add_node(context, node, ss->frames[i].function->function, ss->frames[i].function->user_defined);
+	}
+
+	node->weight += ss->count;
+}
+
+static void add_node_path(xdebug_str *buffer, xdebug_collapsed_node *node)
+{
+	xdebug_collapsed_node **path;
+	xdebug_collapsed_node  *tmp;
+	int                     depth = 0;
+	int                     i;
+
+	for (tmp = node; tmp; tmp = tmp->parent) {
+		depth++;
+	}
+
+	path = xdmalloc(depth * sizeof(xdebug_collapsed_node*));
+	for (tmp = node, i = depth - 1; tmp; tmp = tmp->parent, i--) {
+		path[i] = tmp;
+	}
+
+	for (i = 0; i < depth; i++) {
+		if (i > 0) {
+			xdebug_str_addc(buffer, ';');
+		}
+		if (path[i]->user_defined == XDEBUG_BUILT_IN) {
+			xdebug_str_add_literal(buffer, "php::");
+		}
+		xdebug_str_addl(buffer, path[i]->function->name, path[i]->function->name_len, 0);
+	}
+
+	xdfree(path);
+}
+
+/* Writes one "frame;frame;frame weight" line per distinct stack. The weight
+ * is the exclusive time in 10ns units, or the number of samples when the
+ * stacks came from the sampling profiler */
+void xdebug_profile_collapsed_write_footer(void *ctxt)
+{
+	xdebug_profile_collapsed_context *context = (xdebug_profile_collapsed_context*) ctxt;
+	xdebug_llist_element             *le;
+	xdebug_str                        file_buffer = XDEBUG_STR_INITIALIZER;
+
+	for (le = XDEBUG_LLIST_HEAD(context->node_list); le != NULL; le = XDEBUG_LLIST_NEXT(le)) {
+		xdebug_collapsed_node *node = XDEBUG_LLIST_VALP(le);
+		uint64_t               weight = context->weight_is_samples ? node->weight : NANOTIME_SCALE_10NS(node->weight);
+
+		if (weight == 0) {
+			continue;
+		}
+
+		add_node_path(&file_buffer, node);
+		xdebug_str_addc(&file_buffer, ' ');
+		xdebug_str_add_uint64(&file_buffer, weight);
+		xdebug_str_addc(&file_buffer, '\n');
+	}
+
+	if (file_buffer.l) {
+		xdebug_file_write(file_buffer.d, sizeof(char), file_buffer.l, context->profile_file);
+	}
+	xdebug_str_dtor(file_buffer);
+
+	xdebug_file_flush(context->profile_file);
+}
+
+xdebug_profiler_handler_t xdebug_profiler_handler_collapsed =
+{
+	xdebug_profile_collapsed_init,
+	xdebug_profile_collapsed_deinit,
+	NULL /* xdebug_profile_collapsed_write_header */,
+	xdebug_profile_collapsed_write_footer,
+	xdebug_profile_collapsed_get_filename,
+	xdebug_profile_collapsed_function_end,
+	xdebug_profile_collapsed_add_sample
+};
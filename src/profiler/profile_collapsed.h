@@ -0,0 +1,47 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#ifndef XDEBUG_PROFILE_COLLAPSED_H
+#define XDEBUG_PROFILE_COLLAPSED_H
+
+#include "profiler.h"
+#include "base/function_identity.h"
+
+/* Every distinct stack path is a node, that points to the node of its
+ * caller. The nodes are found through a (parent, function) key, so that
+ * building up the path for a new frame is a single hash lookup. */
+typedef struct _xdebug_collapsed_node {
+	struct _xdebug_collapsed_node *parent;
+	xdebug_function_identity      *function;
+	int                            user_defined;
+	uint64_t                       weight;
+} xdebug_collapsed_node;
+
+typedef struct _xdebug_collapsed_node_key {
+	xdebug_collapsed_node    *parent;
+	xdebug_function_identity *function;
+	int                       user_defined;
+} xdebug_collapsed_node_key;
+
+typedef struct _xdebug_profile_collapsed_context
+{
+	xdebug_file  *profile_file;
+	xdebug_hash  *nodes;
+	xdebug_llist *node_list; /* in order of creation */
+	int           weight_is_samples;
+} xdebug_profile_collapsed_context;
+
+extern xdebug_profiler_handler_t xdebug_profiler_handler_collapsed;
+#endif
@@ -26,10 +26,15 @@
 #include "php_xdebug.h"
 #include "profiler.h"
 #include "profiler_private.h"
+#include "profile_cachegrind.h"
+#include "profile_collapsed.h"
+
+#include "base/function_identity.h"
 
 #include "lib/log.h"
 #include "lib/mm.h"
 #include "lib/str.h"
+#include "lib/timing.h"
 #include "lib/var.h"
 #include "lib/usefulstuff.h"
 
@@ -37,29 +42,64 @@ ZEND_EXTERN_MODULE_GLOBALS(xdebug)
 
 int xdebug_profiler_exit_handler(XDEBUG_OPCODE_HANDLER_ARGS);
 
+static void profiler_merged_flush(void);
+static void profiler_merged_write(xdebug_profiler_merged *merged);
+
 void xdebug_init_profiler_globals(xdebug_profiler_globals_t *xg)
 {
 	xg->active = 0;
+	xg->merging = 0;
+	xg->merged = NULL;
+	xg->sampling = 0;
+	xg->sample_timer.ticks = 0;
+	xg->sample_timer.armed = 0;
+	xg->sample_timer.notifying = 0;
+}
+
+/* Runs for the globals of each thread when it ends, and for those of the main
+ * thread, or of the process without ZTS, at module shutdown. Whatever was
+ * merged since the last time it was written out belongs to this thread only,
+ * so it is written out here, and not through XG_PROF(). */
+void xdebug_deinit_profiler_globals(xdebug_profiler_globals_t *xg)
+{
+	if (xg->merged) {
+		profiler_merged_write(xg->merged);
+		xg->merged = NULL;
+	}
 }
 
 void xdebug_profiler_minit(void)
 {
 	/* Overload the "exit" opcode */
 	xdebug_set_opcode_handler(ZEND_EXIT, xdebug_profiler_exit_handler);
+
+	xdebug_profiler_sampler_minit();
 }
 
 void xdebug_profiler_mshutdown(void)
 {
+	xdebug_profiler_sampler_mshutdown();
 }
 
 void xdebug_profiler_rinit(void)
 {
-	xdebug_file_init(&XG_PROF(profile_file));
-	XG_PROF(profile_filename_refs) = NULL;
-	XG_PROF(profile_functionname_refs) = NULL;
-	XG_PROF(profile_last_filename_ref) = 0;
-	XG_PROF(php_internal_seen_before) = 0;
-	XG_PROF(profile_last_functionname_ref) = 0;
+	XG_PROF(profiler_handler) = NULL;
+	XG_PROF(profiler_context) = NULL;
+	XG_PROF(event_count) = 0;
+	XG_PROF(cpu_time_event) = 0;
+	XG_PROF(perf_events).count = 0;
+	XG_PROF(events_arena) = NULL;
+	XG_PROF(aggregated_functions) = NULL;
+	XG_PROF(aggregated_function_list) = NULL;
+	XG_PROF(aggregated_calls) = NULL;
+	XG_PROF(aggregated_last_function_id) = 0;
+	XG_PROF(merging) = 0;
+	XG_PROF(sampling) = 0;
+	XG_PROF(samples) = NULL;
+	XG_PROF(sample_list) = NULL;
+	XG_PROF(sample_collapsed_context) = NULL;
+	XG_PROF(sample_frames) = NULL;
+	XG_PROF(sample_frames_size) = 0;
 	XG_PROF(active) = 0;
 }
 
@@ -80,6 +120,7 @@ void xdebug_profiler_post_deactivate(void)
 void xdebug_profiler_pcntl_exec_handler(void)
 {
 	deinit_if_active();
+	profiler_merged_flush();
 }
 
 int xdebug_profiler_exit_handler(XDEBUG_OPCODE_HANDLER_ARGS)
@@ -109,7 +150,7 @@ void xdebug_profiler_init_if_requested(zend_op_array *op_array)
 
 void xdebug_profiler_execute_ex(function_stack_entry *fse, zend_op_array *op_array)
 {
-	if (!XG_PROF(active)) {
+	if (!XG_PROF(active) || XG_PROF(sampling)) {
 		return;
 	}
 
@@ -126,7 +167,7 @@ void xdebug_profiler_execute_ex_end(function_stack_entry *fse)
 
 void xdebug_profiler_execute_internal(function_stack_entry *fse)
 {
-	if (!XG_PROF(active)) {
+	if (!XG_PROF(active) || XG_PROF(sampling)) {
 		return;
 	}
 
@@ -144,36 +185,360 @@ void xdebug_profiler_execute_internal_end(function_stack_entry *fse)
 	xdebug_profiler_free_function_details(fse);
 }
 
-void xdebug_profile_call_entry_dtor(void *dummy, void *elem)
+static void profiler_aggregated_function_dtor(void *dummy, void *elem)
+{
+	xdebug_aggregated_function *af = elem;
+
+	xdebug_llist_destroy(af->calls, NULL);
+	xdfree(af->filename);
+	xdfree(af);
+}
+
+static xdebug_profiler_handler_t *xdebug_select_profiler_handler(void)
 {
-	xdebug_call_entry *ce = elem;
+	xdebug_profiler_handler_t *tmp;
+
+	switch (XINI_PROF(profiler_format)) {
+		case 0: tmp = &xdebug_profiler_handler_cachegrind; break;
+		case 1: tmp = &xdebug_profiler_handler_collapsed; break;
+		default:
+			php_error(E_NOTICE, "A wrong value for xdebug.profiler_format was selected (%d), defaulting to the cachegrind format", (int) XINI_PROF(profiler_format));
+			tmp = &xdebug_profiler_handler_cachegrind; break;
+	}
+
+	if (!tmp->init || !tmp->deinit || !tmp->get_filename || !tmp->function_end || !tmp->add_sample) {
+		xdebug_log_ex(XLOG_CHAN_PROFILE, XLOG_CRIT, "HNDLR", "Broken profiler handler for format '%d', missing 'init', 'deinit', 'get_filename', 'function_end', or 'add_sample' handler", (int) XINI_PROF(profiler_format));
+	}
+
+	return tmp;
+}
+
+/* The sampler does not look at events, so they are only collected when every
+ * call is profiled. It has an event of its own instead: the number of
+ * samples. */
+static void profiler_events_init(void)
+{
+	int i;
+
+	XG_PROF(event_count) = 0;
+	XG_PROF(cpu_time_event) = 0;
+	XG_PROF(events_arena) = NULL;
+
+	if (XG_PROF(sampling)) {
+		XG_PROF(event_names)[XDEBUG_PROFILER_SAMPLES_EVENT] = "Samples";
+		XG_PROF(event_count) = 1;
+		return;
+	}
+
+	/* The CPU time is always the first event, when enabled */
+	if (XINI_PROF(profiler_cpu_time)) {
+		XG_PROF(event_names)[XG_PROF(event_count)] = "CPU_Time_(10ns)";
+		XG_PROF(event_count)++;
+		XG_PROF(cpu_time_event) = 1;
+	}
+
+	if (!XINI_PROF(profiler_events) || !strlen(XINI_PROF(profiler_events))) {
+		return;
+	}
+
+	xdebug_perf_events_open(&XG_PROF(perf_events), XINI_PROF(profiler_events));
+	for (i = 0; i < XG_PROF(perf_events).count; i++) {
+		XG_PROF(event_names)[XG_PROF(event_count)] = XG_PROF(perf_events).names[i];
+		XG_PROF(event_count)++;
+	}
+}
+
+static void profiler_events_deinit(void)
+{
+	function_stack_entry *fse = XDEBUG_VECTOR_TAIL(XG_BASE(stack));
+	int                   i;
+
+	/* The frames that are still running lose their event costs along with
+	 * the arena */
+	if (XG_PROF(events_arena)) {
+		for (i = 0; i < XDEBUG_VECTOR_COUNT(XG_BASE(stack)); i++, fse--) {
+			fse->profile.events = NULL;
+			fse->profile.events_mark = NULL;
+			fse->profile.events_children = NULL;
+		}
+
+		xdebug_arena_dtor(XG_PROF(events_arena));
+		XG_PROF(events_arena) = NULL;
+	}
+
+	xdebug_perf_events_close(&XG_PROF(perf_events));
+	XG_PROF(event_count) = 0;
+	XG_PROF(cpu_time_event) = 0;
+}
+
+#define PROFILER_EVENTS_ARENA_BLOCK_SIZE 16384
+#define PROFILER_FRAME_EVENTS_SIZE       (3 * XG_PROF(event_count) * sizeof(uint64_t))
+
+/* Frames only get space for event costs while events are collected */
+static void profiler_frame_events_alloc(function_stack_entry *fse)
+{
+	if (!XG_PROF(events_arena)) {
+		XG_PROF(events_arena) = xdebug_arena_ctor(PROFILER_EVENTS_ARENA_BLOCK_SIZE);
+	}
+
+	fse->profile.events = xdebug_arena_malloc(XG_PROF(events_arena), PROFILER_FRAME_EVENTS_SIZE);
+	fse->profile.events_mark = fse->profile.events + XG_PROF(event_count);
+	fse->profile.events_children = fse->profile.events + 2 * XG_PROF(event_count);
+}
+
+static void profiler_frame_events_free(function_stack_entry *fse)
+{
+	if (!fse->profile.events) {
+		return;
+	}
+
+	xdebug_arena_free(XG_PROF(events_arena), fse->profile.events, PROFILER_FRAME_EVENTS_SIZE);
+	fse->profile.events = NULL;
+	fse->profile.events_mark = NULL;
+	fse->profile.events_children = NULL;
+}
+
+/* Fills 'values' with the current value of each event, in the order of
+ * 'event_names' */
+void xdebug_profiler_read_events(uint64_t *values)
+{
+	if (XG_PROF(cpu_time_event)) {
+		*values = xdebug_get_thread_cputime() / 10;
+		values++;
+	}
+
+	if (XG_PROF(perf_events).count) {
+		xdebug_perf_events_read(&XG_PROF(perf_events), values);
+	}
+}
+
+static void profiler_merged_function_dtor(void *dummy, void *elem)
+{
+	xdebug_aggregated_function *af = elem;
+
+	xdfree(af->function->name);
+	xdfree(af->function);
+	profiler_aggregated_function_dtor(dummy, elem);
+}
+
+/* Merging needs the aggregated call graph, which the sampler and the
+ * collapsed format do not build */
+static int profiler_merging_enabled(void)
+{
+	if (XINI_PROF(profiler_aggregate_requests) <= 0 && XINI_PROF(profiler_aggregate_interval) <= 0) {
+		return 0;
+	}
+
+	return XG_PROF(profiler_handler) == &xdebug_profiler_handler_cachegrind && XINI_PROF(profiler_sample_frequency) <= 0;
+}
+
+static void profiler_merged_free(xdebug_profiler_merged *merged)
+{
+	xdebug_hash_destroy(merged->calls);
+	xdebug_hash_destroy(merged->functions);
+	xdebug_llist_destroy(merged->function_list, NULL);
+	xdfree(merged->fname);
+	xdfree(merged->script_name);
+	xdfree(merged);
+}
+
+static void profiler_merged_write(xdebug_profiler_merged *merged)
+{
+	xdebug_profile_cachegrind_write_merged(merged);
+	profiler_merged_free(merged);
+}
+
+static void profiler_merged_flush(void)
+{
+	if (!XG_PROF(merged)) {
+		return;
+	}
+
+	profiler_merged_write(XG_PROF(merged));
+	XG_PROF(merged) = NULL;
+}
+
+static int profiler_merged_events_match(xdebug_profiler_merged *merged)
+{
+	int i;
+
+	if (merged->event_count != XG_PROF(event_count)) {
+		return 0;
+	}
+
+	for (i = 0; i < merged->event_count; i++) {
+		if (strcmp(merged->event_names[i], XG_PROF(event_names)[i]) != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* The file name is decided by the first request that gets merged */
+static void profiler_merged_begin(char *fname, char *script_name)
+{
+	xdebug_profiler_merged *merged;
+
+	/* Costs of different events can not be added up */
+	if (XG_PROF(merged) && !profiler_merged_events_match(XG_PROF(merged))) {
+		profiler_merged_flush();
+	}
+
+	if (XG_PROF(merged)) {
+		return;
+	}
+
+	merged = xdcalloc(1, sizeof(xdebug_profiler_merged));
+
+	merged->fname = xdstrdup(fname);
+	merged->script_name = xdstrdup(script_name);
+	merged->started = time(NULL);
+	merged->event_count = XG_PROF(event_count);
+	memcpy(merged->event_names, XG_PROF(event_names), sizeof(merged->event_names));
+	merged->functions = xdebug_hash_alloc(1024, NULL);
+	merged->function_list = xdebug_llist_alloc(profiler_merged_function_dtor);
+	merged->calls = xdebug_hash_alloc(4096, xdfree);
+
+	XG_PROF(merged) = merged;
+}
+
+static xdebug_aggregated_function *profiler_merged_find_or_add_function(xdebug_profiler_merged *merged, xdebug_aggregated_function *request_af)
+{
+	xdebug_aggregated_function *af;
+	char                       *key;
+
+	/* Function identities do not survive the request, and their names are
+	 * not unique across requests either, as every script has a {main} */
+	key = xdebug_sprintf("%d:%s:%s", request_af->user_defined, request_af->filename, request_af->function->name);
+
+	if (!xdebug_hash_find(merged->functions, key, strlen(key), (void*) &af)) {
+		af = xdcalloc(1, sizeof(xdebug_aggregated_function));
+
+		af->id = ++merged->last_function_id;
+		af->user_defined = request_af->user_defined;
+		af->filename = xdstrdup(request_af->filename);
+		af->lineno = request_af->lineno;
+		af->calls = xdebug_llist_alloc(NULL);
+
+		af->function = xdmalloc(sizeof(xdebug_function_identity));
+		af->function->id = af->id;
+		af->function->name = xdstrdup(request_af->function->name);
+		af->function->name_len = request_af->function->name_len;
+
+		xdebug_hash_add(merged->functions, key, strlen(key), (void*) af);
+		xdebug_llist_insert_next(merged->function_list, NULL, af);
+	}
+
+	xdfree(key);
+
+	return af;
+}
+
+static xdebug_aggregated_call *find_or_add_aggregated_call(xdebug_hash *calls, xdebug_aggregated_function *caller, xdebug_aggregated_function *callee, int lineno);
+
+/* Folds the call graph of the request that just ended into the merged one */
+static void profiler_merged_add_request(void)
+{
+	xdebug_profiler_merged      *merged = XG_PROF(merged);
+	xdebug_aggregated_function **map;
+	xdebug_llist_element        *le, *cle;
+	size_t                       peak_memory = zend_memory_peak_usage(0);
+	int                          i;
+
+	merged->requests++;
+	merged->nanotime += xdebug_get_nanotime() - XG_PROF(profiler_start_nanotime);
+	if (peak_memory > merged->peak_memory) {
+		merged->peak_memory = peak_memory;
+	}
+	if (XG_PROF(event_count)) {
+		uint64_t events[XDEBUG_PROFILER_MAX_EVENTS];
+
+		xdebug_profiler_read_events(events);
+		for (i = 0; i < XG_PROF(event_count); i++) {
+			merged->events[i] += events[i] - XG_PROF(events_start)[i];
+		}
+	}
+
+	/* Maps the ids of the request's functions, which start at 1, to the
+	 * merged functions */
+	map = xdmalloc((XG_PROF(aggregated_last_function_id) + 1) * sizeof(xdebug_aggregated_function*));
+
+	for (le = XDEBUG_LLIST_HEAD(XG_PROF(aggregated_function_list)); le != NULL; le = XDEBUG_LLIST_NEXT(le)) {
+		xdebug_aggregated_function *request_af = XDEBUG_LLIST_VALP(le);
+		xdebug_aggregated_function *af = profiler_merged_find_or_add_function(merged, request_af);
 
-	if (ce->function) {
-		xdfree(ce->function);
+		af->nanotime += request_af->nanotime;
+		af->mem_used += request_af->mem_used;
+		for (i = 0; i < XG_PROF(event_count); i++) {
+			af->events[i] += request_af->events[i];
+		}
+
+		map[request_af->id] = af;
 	}
-	if (ce->filename) {
-		zend_string_release(ce->filename);
+
+	for (le = XDEBUG_LLIST_HEAD(XG_PROF(aggregated_function_list)); le != NULL; le = XDEBUG_LLIST_NEXT(le)) {
+		xdebug_aggregated_function *request_af = XDEBUG_LLIST_VALP(le);
+
+		for (cle = XDEBUG_LLIST_HEAD(request_af->calls); cle != NULL; cle = XDEBUG_LLIST_NEXT(cle)) {
+			xdebug_aggregated_call *request_ac = XDEBUG_LLIST_VALP(cle);
+			xdebug_aggregated_call *ac = find_or_add_aggregated_call(
+				merged->calls, map[request_af->id], map[request_ac->callee->id], request_ac->lineno
+			);
+
+			ac->calls += request_ac->calls;
+			ac->nanotime_taken += request_ac->nanotime_taken;
+			ac->mem_used += request_ac->mem_used;
+			for (i = 0; i < XG_PROF(event_count); i++) {
+				ac->events[i] += request_ac->events[i];
+			}
+		}
 	}
-	xdfree(ce);
+
+	xdfree(map);
 }
 
-static void profiler_write_header(xdebug_file *file, char *script_name)
+static void profiler_merged_end_request(void)
 {
-	if (XINI_PROF(profiler_append)) {
-		xdebug_file_printf(file, "\n==== NEW PROFILING FILE ==============================================\n");
+	xdebug_profiler_merged *merged = XG_PROF(merged);
+
+	profiler_merged_add_request();
+
+	if (
+		(XINI_PROF(profiler_aggregate_requests) > 0 && merged->requests >= (unsigned long) XINI_PROF(profiler_aggregate_requests)) ||
+		(XINI_PROF(profiler_aggregate_interval) > 0 && time(NULL) - merged->started >= XINI_PROF(profiler_aggregate_interval))
+	) {
+		profiler_merged_flush();
 	}
-	xdebug_file_printf(file, "version: 1\ncreator: xdebug %s (PHP %s)\n", XDEBUG_VERSION, XG_BASE(php_version_run_time));
-	xdebug_file_printf(file, "cmd: %s\npart: 1\npositions: line\n\n", script_name);
-	xdebug_file_printf(file, "events: Time_(10ns) Memory_(bytes)\n\n");
-	xdebug_file_flush(file);
 }
 
-#define NANOTIME_SCALE_10NS(nanotime) ((unsigned long)(((nanotime) + 5) / 10))
+xdebug_file *xdebug_profiler_open_file(char *fname, const char *extension, int allow_async_writer)
+{
+	xdebug_file *file = xdebug_file_ctor();
+	char        *filename;
+	char        *output_dir = xdebug_lib_get_output_dir(); /* not duplicated */
+
+	/* Add a slash if none is present in the output_dir setting */
+	if (IS_SLASH(output_dir[strlen(output_dir) - 1])) {
+		filename = xdebug_sprintf("%s%s", output_dir, fname);
+	} else {
+		filename = xdebug_sprintf("%s%c%s", output_dir, DEFAULT_SLASH, fname);
+	}
+
+	if (!xdebug_file_open_output(file, filename, extension, XINI_PROF(profiler_append) ? "ab" : "wb", allow_async_writer)) {
+		xdebug_log_diagnose_permissions(XLOG_CHAN_PROFILE, output_dir, fname);
+		xdebug_file_dtor(file);
+		file = NULL;
+	}
+
+	xdfree(filename);
+
+	return file;
+}
 
 void xdebug_profiler_init(char *script_name)
 {
-	char *filename = NULL, *fname = NULL;
-	char *output_dir = NULL;
+	char *fname = NULL;
 
 	if (XG_PROF(active)) {
 		return;
@@ -186,41 +551,64 @@ void xdebug_profiler_init(char *script_name)
 		return;
 	}
 
-	/* Add a slash if none is present in the output_dir setting */
-	output_dir = xdebug_lib_get_output_dir(); /* not duplicated */
+	XG_PROF(profiler_handler) = xdebug_select_profiler_handler();
+	XG_PROF(merging) = profiler_merging_enabled();
 
-	if (IS_SLASH(output_dir[strlen(output_dir) - 1])) {
-		filename = xdebug_sprintf("%s%s", output_dir, fname);
-	} else {
-		filename = xdebug_sprintf("%s%c%s", output_dir, DEFAULT_SLASH, fname);
+	/* When merging, the file only gets opened once the merged call graph is
+	 * written out */
+	if (!XG_PROF(merging)) {
+		XG_PROF(profiler_context) = XG_PROF(profiler_handler)->init(fname);
+
+		if (!XG_PROF(profiler_context)) {
+			goto return_and_free_names;
+		}
 	}
 
-	if (!xdebug_file_open(&XG_PROF(profile_file), filename, NULL, XINI_PROF(profiler_append) ? "ab" : "wb")) {
-		xdebug_log_diagnose_permissions(XLOG_CHAN_PROFILE, output_dir, fname);
-		goto return_and_free_names;
+	/* Whether the sampler could be started decides which events there are */
+	if (XINI_PROF(profiler_sample_frequency) > 0) {
+		XG_PROF(sampling) = xdebug_profiler_sampler_init(fname);
 	}
 
-	profiler_write_header(&XG_PROF(profile_file), script_name);
+	profiler_events_init();
+
+	if (XG_PROF(merging)) {
+		profiler_merged_begin(fname, script_name);
+	} else {
+		if (XG_PROF(profiler_handler)->write_header) {
+			XG_PROF(profiler_handler)->write_header(XG_PROF(profiler_context), script_name);
+		}
+	}
 
-	if (!SG(headers_sent)) {
+	if (XG_PROF(profiler_context) && !SG(headers_sent)) {
 		sapi_header_line ctr = {0};
 
-		ctr.line = xdebug_sprintf("X-Xdebug-Profile-Filename: %s", XG_PROF(profile_file).name);
+		ctr.line = xdebug_sprintf("X-Xdebug-Profile-Filename: %s", XG_PROF(profiler_handler)->get_filename(XG_PROF(profiler_context)));
 		ctr.line_len = strlen(ctr.line);
 		sapi_header_op(SAPI_HEADER_REPLACE, &ctr);
 		xdfree((void*) ctr.line);
 	}
 
 	XG_PROF(profiler_start_nanotime) = xdebug_get_nanotime();
+	if (XG_PROF(event_count)) {
+		xdebug_profiler_read_events(XG_PROF(events_start));
+	}
 
 	XG_PROF(active) = 1;
-	XG_PROF(profile_filename_refs) = xdebug_hash_alloc(128, xdfree);
-	XG_PROF(profile_functionname_refs) = xdebug_hash_alloc(128, xdfree);
-	XG_PROF(profile_last_filename_ref) = 1;
-	XG_PROF(profile_last_functionname_ref) = 0;
+
+	/* The sampler builds its call graph out of the same structures. The
+	 * collapsed format is aggregated by nature, and does not need them. */
+	if (
+		(XINI_PROF(profiler_aggregate_calls) && XG_PROF(profiler_handler) == &xdebug_profiler_handler_cachegrind) ||
+		XG_PROF(sampling) ||
+		XG_PROF(merging)
+	) {
+		XG_PROF(aggregated_functions) = xdebug_hash_alloc(1024, NULL);
+		XG_PROF(aggregated_function_list) = xdebug_llist_alloc(profiler_aggregated_function_dtor);
+		XG_PROF(aggregated_calls) = xdebug_hash_alloc(4096, xdfree);
+		XG_PROF(aggregated_last_function_id) = 0;
+	}
 
 return_and_free_names:
-	xdfree(filename);
 	xdfree(fname);
 }
 
@@ -229,30 +617,39 @@ void xdebug_profiler_deinit()
 	function_stack_entry *fse = XDEBUG_VECTOR_TAIL(XG_BASE(stack));
 	int                   i;
 
-	for (i = 0; i < XDEBUG_VECTOR_COUNT(XG_BASE(stack)); i++, fse--) {
-		xdebug_profiler_function_end(fse);
+	if (XG_PROF(sampling)) {
+		xdebug_profiler_sampler_stop();
+		xdebug_profiler_sampler_deinit();
+		XG_PROF(sampling) = 0;
+	} else {
+		for (i = 0; i < XDEBUG_VECTOR_COUNT(XG_BASE(stack)); i++, fse--) {
+			xdebug_profiler_function_end(fse);
+		}
 	}
 
-	xdebug_file_printf(
-		&XG_PROF(profile_file),
-		"summary: %lu %zd\n\n",
-		NANOTIME_SCALE_10NS(xdebug_get_nanotime() - XG_PROF(profiler_start_nanotime)),
-		zend_memory_peak_usage(0)
-	);
-
 	XG_PROF(active) = 0;
 
-	xdebug_file_flush(&XG_PROF(profile_file));
-
-	if (XG_PROF(profile_file).type != XDEBUG_FILE_TYPE_NULL) {
-		xdebug_file_close(&XG_PROF(profile_file));
-		xdebug_file_deinit(&XG_PROF(profile_file));
+	if (XG_PROF(merging)) {
+		profiler_merged_end_request();
+		XG_PROF(merging) = 0;
+	} else {
+		if (XG_PROF(profiler_handler)->write_footer) {
+			XG_PROF(profiler_handler)->write_footer(XG_PROF(profiler_context));
+		}
+		XG_PROF(profiler_handler)->deinit(XG_PROF(profiler_context));
+		XG_PROF(profiler_context) = NULL;
 	}
 
-	xdebug_hash_destroy(XG_PROF(profile_filename_refs));
-	xdebug_hash_destroy(XG_PROF(profile_functionname_refs));
-	XG_PROF(profile_filename_refs) = NULL;
-	XG_PROF(profile_functionname_refs) = NULL;
+	profiler_events_deinit();
+
+	if (XG_PROF(aggregated_function_list)) {
+		xdebug_hash_destroy(XG_PROF(aggregated_calls));
+		xdebug_hash_destroy(XG_PROF(aggregated_functions));
+		xdebug_llist_destroy(XG_PROF(aggregated_function_list), NULL);
+		XG_PROF(aggregated_calls) = NULL;
+		XG_PROF(aggregated_functions) = NULL;
+		XG_PROF(aggregated_function_list) = NULL;
+	}
 }
 
 static inline void xdebug_profiler_function_push(function_stack_entry *fse)
@@ -261,11 +658,24 @@ static inline void xdebug_profiler_function_push(function_stack_entry *fse)
 	fse->profile.nanotime_mark = 0;
 	fse->profile.memory += (zend_memory_usage(0) - fse->profile.mem_mark);
 	fse->profile.mem_mark = 0;
+
+	if (fse->profile.events) {
+		uint64_t events[XDEBUG_PROFILER_MAX_EVENTS];
+		int      i;
+
+		xdebug_profiler_read_events(events);
+		for (i = 0; i < XG_PROF(event_count); i++) {
+			fse->profile.events[i] += events[i] - fse->profile.events_mark[i];
+		}
+	}
 }
 
 void xdebug_profiler_function_continue(function_stack_entry *fse)
 {
 	fse->profile.nanotime_mark = xdebug_get_nanotime();
+	if (fse->profile.events) {
+		xdebug_profiler_read_events(fse->profile.events_mark);
+	}
 }
 
 void xdebug_profiler_function_pause(function_stack_entry *fse)
@@ -273,55 +683,26 @@ void xdebug_profiler_function_pause(function_stack_entry *fse)
 	xdebug_profiler_function_push(fse);
 }
 
-static inline void add_filename_ref(xdebug_str *buffer, char *name)
+static xdebug_function_identity *include_function_identity(xdebug_function_identity *fi, function_stack_entry *fse)
 {
-	char *ref;
+	char *tmp_name = xdebug_sprintf("%s::%s", fi->name, ZSTR_VAL(fse->include_filename));
 
-	if (xdebug_hash_find(XG_PROF(profile_filename_refs), name, strlen(name), (void*) &ref)) {
-		xdebug_str_add(buffer, ref, 0);
-	} else {
-		XG_PROF(profile_last_filename_ref)++;
-		ref = xdebug_sprintf("(%d)", XG_PROF(profile_last_filename_ref));
-
-		xdebug_hash_add(XG_PROF(profile_filename_refs), name, strlen(name), (void*) ref);
-
-		xdebug_str_add(buffer, ref, 0);
-		xdebug_str_addc(buffer, ' ');
-		xdebug_str_add(buffer, name,  0);
-	}
-}
-
-static inline void add_functionname_ref(xdebug_str *buffer, char *name)
-{
-	char *ref;
-
-	if (xdebug_hash_find(XG_PROF(profile_functionname_refs), name, strlen(name), (void*) &ref)) {
-		xdebug_str_add(buffer, ref, 0);
-	} else {
-		XG_PROF(profile_last_functionname_ref)++;
-		ref = xdebug_sprintf("(%d)", XG_PROF(profile_last_functionname_ref));
-
-		xdebug_hash_add(XG_PROF(profile_functionname_refs), name, strlen(name), (void*) ref);
+	fi = xdebug_function_identity_intern(tmp_name, strlen(tmp_name));
+	xdfree(tmp_name);
 
-		xdebug_str_add(buffer, ref, 0);
-		xdebug_str_addc(buffer, ' ');
-		xdebug_str_add(buffer, name,  0);
-	}
+	return fi;
 }
 
 void xdebug_profiler_add_function_details_user(function_stack_entry *fse, zend_op_array *op_array)
 {
-	char *tmp_fname, *tmp_name;
+	xdebug_function_identity *fi = xdebug_function_identity_for_frame(fse);
 
-	tmp_name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
 	switch (fse->function.type) {
 		case XFUNC_INCLUDE:
 		case XFUNC_INCLUDE_ONCE:
 		case XFUNC_REQUIRE:
 		case XFUNC_REQUIRE_ONCE:
-			tmp_fname = xdebug_sprintf("%s::%s", tmp_name, ZSTR_VAL(fse->include_filename));
-			xdfree(tmp_name);
-			tmp_name = tmp_fname;
+			fi = include_function_identity(fi, fse);
 			fse->profiler.lineno = 1;
 			break;
 
@@ -342,23 +723,19 @@ void xdebug_profiler_add_function_details_user(function_stack_entry *fse, zend_o
 	} else {
 		fse->profiler.filename = zend_string_copy(fse->filename);
 	}
-	fse->profiler.funcname = xdstrdup(tmp_name);
-	xdfree(tmp_name);
+	fse->profiler.function = fi;
 }
 
 void xdebug_profiler_add_function_details_internal(function_stack_entry *fse)
 {
-	char *tmp_fname, *tmp_name;
+	xdebug_function_identity *fi = xdebug_function_identity_for_frame(fse);
 
-	tmp_name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
 	switch (fse->function.type) {
 		case XFUNC_INCLUDE:
 		case XFUNC_INCLUDE_ONCE:
 		case XFUNC_REQUIRE:
 		case XFUNC_REQUIRE_ONCE:
-			tmp_fname = xdebug_sprintf("%s::%s", tmp_name, fse->include_filename);
-			xdfree(tmp_name);
-			tmp_name = tmp_fname;
+			fi = include_function_identity(fi, fse);
 			fse->profiler.lineno = 1;
 			break;
 
@@ -371,9 +748,7 @@ void xdebug_profiler_add_function_details_internal(function_stack_entry *fse)
 	}
 
 	fse->profiler.filename = zend_string_copy(fse->filename);
-	fse->profiler.funcname = xdstrdup(tmp_name);
-
-	xdfree(tmp_name);
+	fse->profiler.function = fi;
 }
 
 void xdebug_profiler_function_begin(function_stack_entry *fse)
@@ -382,164 +757,172 @@ void xdebug_profiler_function_begin(function_stack_entry *fse)
 	fse->profile.nanotime_mark = xdebug_get_nanotime();
 	fse->profile.memory = 0;
 	fse->profile.mem_mark = zend_memory_usage(0);
-}
+	fse->profile.nanotime_children = 0;
+	fse->profile.mem_children = 0;
 
-#define TMP_KEY_BUFFER_LEN 1024
-#define TMP_KEY_PREFIX     "php::"
-#define TMP_KEY_PREFIX_LEN (sizeof(TMP_KEY_PREFIX)-1)
-#define TMP_KEY_MAX_LEN    (TMP_KEY_BUFFER_LEN-TMP_KEY_PREFIX_LEN-1)
+	if (XG_PROF(event_count)) {
+		if (!fse->profile.events) {
+			profiler_frame_events_alloc(fse);
+		}
+		memset(fse->profile.events, 0, XG_PROF(event_count) * sizeof(uint64_t));
+		memset(fse->profile.events_children, 0, XG_PROF(event_count) * sizeof(uint64_t));
+		xdebug_profiler_read_events(fse->profile.events_mark);
+	}
+}
 
-void xdebug_profiler_function_end(function_stack_entry *fse)
+static xdebug_aggregated_function *find_or_add_aggregated_function(function_stack_entry *fse)
 {
-	xdebug_llist_element *le;
-	xdebug_str file_buffer = XDEBUG_STR_INITIALIZER;
-	char tmp_key[TMP_KEY_BUFFER_LEN];
+	xdebug_aggregated_function *af;
+	unsigned long               key;
 
-	if (!XG_PROF(active)) {
-		return;
+	if (fse->profiler.aggregated_function) {
+		return fse->profiler.aggregated_function;
 	}
 
-	/* The temporary key always starts with 'php::' */
-	memcpy(tmp_key, TMP_KEY_PREFIX, TMP_KEY_PREFIX_LEN);
-
-	if (xdebug_vector_element_is_valid(XG_BASE(stack), fse - 1) && !(fse - 1)->profile.call_list) {
-		(fse - 1)->profile.call_list = xdebug_llist_alloc(xdebug_profile_call_entry_dtor);
-	}
-	if (!fse->profile.call_list) {
-		fse->profile.call_list = xdebug_llist_alloc(xdebug_profile_call_entry_dtor);
-	}
-	xdebug_profiler_function_push(fse);
+	key = FUNCTIONNAME_REF_KEY(fse->profiler.function, fse->user_defined);
 
-	if (xdebug_vector_element_is_valid(XG_BASE(stack), fse - 1)) {
-		xdebug_call_entry *ce = xdmalloc(sizeof(xdebug_call_entry));
+	if (!xdebug_hash_index_find(XG_PROF(aggregated_functions), key, (void*) &af)) {
+		af = xdcalloc(1, sizeof(xdebug_aggregated_function));
 
-		ce->filename = zend_string_copy(fse->profiler.filename);
-		ce->function = xdstrdup(fse->profiler.funcname);
-		ce->nanotime_taken = fse->profile.nanotime;
-		ce->lineno = fse->lineno;
-		ce->user_defined = fse->user_defined;
-		ce->mem_used = fse->profile.memory;
+		af->id = ++XG_PROF(aggregated_last_function_id);
+		af->user_defined = fse->user_defined;
+		af->filename = xdstrdup(ZSTR_VAL(fse->profiler.filename));
+		af->function = fse->profiler.function;
+		af->lineno = fse->profiler.lineno;
+		af->calls = xdebug_llist_alloc(NULL);
 
-		xdebug_llist_insert_next((fse - 1)->profile.call_list, NULL, ce);
+		xdebug_hash_index_add(XG_PROF(aggregated_functions), key, (void*) af);
+		xdebug_llist_insert_next(XG_PROF(aggregated_function_list), NULL, af);
 	}
 
-	/* use previously created filename and funcname (or a reference to them) to show
-	 * time spend */
-	if (fse->user_defined == XDEBUG_BUILT_IN) {
-		size_t tmp_key_funcname_len = strlen(fse->profiler.funcname);
+	fse->profiler.aggregated_function = af;
 
-		memcpy(tmp_key + TMP_KEY_PREFIX_LEN,
-			fse->profiler.funcname,
-			tmp_key_funcname_len > TMP_KEY_MAX_LEN ? TMP_KEY_MAX_LEN : tmp_key_funcname_len + 1
-		);
-		tmp_key[TMP_KEY_BUFFER_LEN - 1] = '\0';
+	return af;
+}
 
-		if (XG_PROF(php_internal_seen_before)) {
-			xdebug_str_add_literal(&file_buffer, "fl=(1)\n");
+/* The sampler only looks at a frame when a sample is taken, so the details
+ * might not have been collected yet */
+xdebug_aggregated_function *xdebug_profiler_aggregated_function_for_frame(function_stack_entry *fse)
+{
+	if (!fse->profiler.function) {
+		if (fse->user_defined == XDEBUG_USER_DEFINED) {
+			xdebug_profiler_add_function_details_user(fse, fse->op_array);
 		} else {
-			xdebug_str_add_literal(&file_buffer, "fl=(1) php:internal\n");
-			XG_PROF(php_internal_seen_before) = 1;
+			xdebug_profiler_add_function_details_internal(fse);
 		}
-		xdebug_str_add_literal(&file_buffer, "fn=");
-		add_functionname_ref(&file_buffer, tmp_key);
-		xdebug_str_addc(&file_buffer, '\n');
-	} else {
+	}
 
-		xdebug_str_add_literal(&file_buffer, "fl=");
-		add_filename_ref(&file_buffer, ZSTR_VAL(fse->profiler.filename));
+	return find_or_add_aggregated_function(fse);
+}
 
-		xdebug_str_add_literal(&file_buffer, "\nfn=");
-		add_functionname_ref(&file_buffer, fse->profiler.funcname);
-		xdebug_str_addc(&file_buffer, '\n');
-	}
+static xdebug_aggregated_call *find_or_add_aggregated_call(xdebug_hash *calls, xdebug_aggregated_function *caller, xdebug_aggregated_function *callee, int lineno)
+{
+	xdebug_aggregated_call     *ac;
+	xdebug_aggregated_call_key  key;
 
+	key.caller_id = caller->id;
+	key.callee_id = callee->id;
+	key.lineno = lineno;
 
-	/* Subtract time in calledfunction from time here */
-	for (le = XDEBUG_LLIST_HEAD(fse->profile.call_list); le != NULL; le = XDEBUG_LLIST_NEXT(le))
-	{
-		xdebug_call_entry *call_entry = XDEBUG_LLIST_VALP(le);
-		fse->profile.nanotime -= call_entry->nanotime_taken;
-		fse->profile.memory -= call_entry->mem_used;
-	}
+	if (!xdebug_hash_find(calls, (char*) &key, sizeof(key), (void*) &ac)) {
+		ac = xdcalloc(1, sizeof(xdebug_aggregated_call));
 
-	/* Adds %d %lu %lu, with lineno, time, and memory */
-	xdebug_str_add_uint64(&file_buffer, fse->profiler.lineno);
-	xdebug_str_addc(&file_buffer, ' ');
-	xdebug_str_add_uint64(&file_buffer, NANOTIME_SCALE_10NS(fse->profile.nanotime));
-	xdebug_str_addc(&file_buffer, ' ');
-	xdebug_str_add_uint64(&file_buffer, fse->profile.memory >= 0 ? fse->profile.memory : 0);
-	xdebug_str_addc(&file_buffer, '\n');
+		ac->callee = callee;
+		ac->lineno = lineno;
 
-	/* dump call list */
-	for (le = XDEBUG_LLIST_HEAD(fse->profile.call_list); le != NULL; le = XDEBUG_LLIST_NEXT(le))
-	{
-		xdebug_call_entry *call_entry = XDEBUG_LLIST_VALP(le);
+		xdebug_hash_add(calls, (char*) &key, sizeof(key), (void*) ac);
+		xdebug_llist_insert_next(caller->calls, NULL, ac);
+	}
 
-		if (call_entry->user_defined == XDEBUG_BUILT_IN) {
-			size_t tmp_key_funcname_len = strlen(call_entry->function);
+	return ac;
+}
 
-			memcpy(tmp_key + TMP_KEY_PREFIX_LEN,
-				call_entry->function,
-				tmp_key_funcname_len > TMP_KEY_MAX_LEN ? TMP_KEY_MAX_LEN : tmp_key_funcname_len + 1
-			);
-			tmp_key[TMP_KEY_BUFFER_LEN - 1] = '\0';
+xdebug_aggregated_call *xdebug_profiler_find_or_add_aggregated_call(xdebug_aggregated_function *caller, xdebug_aggregated_function *callee, int lineno)
+{
+	return find_or_add_aggregated_call(XG_PROF(aggregated_calls), caller, callee, lineno);
+}
 
-			if (XG_PROF(php_internal_seen_before)) {
-				xdebug_str_add_literal(&file_buffer, "cfl=(1)\n");
-			} else {
-				xdebug_str_add_literal(&file_buffer, "cfl=(1) php:internal\n");
-				XG_PROF(php_internal_seen_before) = 1;
-			}
+/* Instead of writing out a fl=/fn= block for every call, only fold the call
+ * into the call graph. The exclusive time and memory of the function are
+ * calculated by subtracting what its children have reported back through
+ * 'nanotime_children' and 'mem_children'. */
+static void profiler_function_end_aggregated(function_stack_entry *fse)
+{
+	xdebug_aggregated_function *af;
+	long                        mem_used;
+	int                         i;
 
-			xdebug_str_add_literal(&file_buffer, "cfn=");
-			add_functionname_ref(&file_buffer, tmp_key);
-			xdebug_str_addc(&file_buffer, '\n');
-		} else {
-			xdebug_str_add_literal(&file_buffer, "cfl=");
-			add_filename_ref(&file_buffer, ZSTR_VAL(call_entry->filename));
+	af = find_or_add_aggregated_function(fse);
 
-			xdebug_str_add_literal(&file_buffer, "\ncfn=");
-			add_functionname_ref(&file_buffer, call_entry->function);
-			xdebug_str_addc(&file_buffer, '\n');
+	if (xdebug_vector_element_is_valid(XG_BASE(stack), fse - 1)) {
+		xdebug_aggregated_function *caller = find_or_add_aggregated_function(fse - 1);
+		xdebug_aggregated_call     *ac = xdebug_profiler_find_or_add_aggregated_call(caller, af, fse->lineno);
+
+		ac->calls++;
+		ac->nanotime_taken += fse->profile.nanotime;
+		ac->mem_used += fse->profile.memory >= 0 ? fse->profile.memory : 0;
+		for (i = 0; fse->profile.events && i < XG_PROF(event_count); i++) {
+			ac->events[i] += fse->profile.events[i];
 		}
+	}
+
+	af->nanotime += fse->profile.nanotime - fse->profile.nanotime_children;
+	mem_used = fse->profile.memory - fse->profile.mem_children;
+	af->mem_used += mem_used >= 0 ? mem_used : 0;
+	for (i = 0; fse->profile.events && i < XG_PROF(event_count); i++) {
+		af->events[i] += fse->profile.events[i] - fse->profile.events_children[i];
+	}
+}
 
-		xdebug_str_add_literal(&file_buffer, "calls=1 0 0\n");
+void xdebug_profiler_function_end(function_stack_entry *fse)
+{
+	if (!XG_PROF(active) || XG_PROF(sampling)) {
+		return;
+	}
+
+	xdebug_profiler_function_push(fse);
+
+	if (xdebug_vector_element_is_valid(XG_BASE(stack), fse - 1)) {
+		int i;
 
-		/* Adds %d %lu %lu, with lineno, time, and memory */
-		xdebug_str_add_uint64(&file_buffer, call_entry->lineno);
-		xdebug_str_addc(&file_buffer, ' ');
-		xdebug_str_add_uint64(&file_buffer, NANOTIME_SCALE_10NS(call_entry->nanotime_taken));
-		xdebug_str_addc(&file_buffer, ' ');
-		xdebug_str_add_uint64(&file_buffer, call_entry->mem_used >= 0 ? call_entry->mem_used : 0);
-		xdebug_str_addc(&file_buffer, '\n');
+		(fse - 1)->profile.nanotime_children += fse->profile.nanotime;
+		(fse - 1)->profile.mem_children += fse->profile.memory;
+		for (i = 0; fse->profile.events && (fse - 1)->profile.events && i < XG_PROF(event_count); i++) {
+			(fse - 1)->profile.events_children[i] += fse->profile.events[i];
+		}
+	}
+
+	if (XG_PROF(aggregated_function_list)) {
+		profiler_function_end_aggregated(fse);
+		return;
 	}
-	xdebug_str_addc(&file_buffer, '\n');
 
-	xdebug_file_write(file_buffer.d, sizeof(char), file_buffer.l, &XG_PROF(profile_file));
-	xdebug_str_dtor(file_buffer);
+	XG_PROF(profiler_handler)->function_end(XG_PROF(profiler_context), fse);
 }
 
 void xdebug_profiler_free_function_details(function_stack_entry *fse)
 {
-	if (fse->profiler.funcname) {
-		xdfree(fse->profiler.funcname);
-		fse->profiler.funcname = NULL;
-	}
 	if (fse->profiler.filename) {
 		zend_string_release(fse->profiler.filename);
 		fse->profiler.filename = NULL;
 	}
+	fse->profiler.function = NULL;
+	fse->profiler.aggregated_function = NULL;
+	fse->profiler.collapsed_node = NULL;
+
+	profiler_frame_events_free(fse);
 }
 
 /* Returns a *pointer* to the current profile filename, if active. NULL
  * otherwise. Calling function is responsible for duplicating immediately */
 char *xdebug_get_profiler_filename()
 {
-	if (!XG_PROF(active)) {
+	/* With merging, no file is open while the request runs */
+	if (!XG_PROF(active) || !XG_PROF(profiler_context)) {
 		return NULL;
 	}
 
-	return XG_PROF(profile_file).name;
+	return XG_PROF(profiler_handler)->get_filename(XG_PROF(profiler_context));
 }
 
 PHP_FUNCTION(xdebug_get_profiler_filename)
@@ -19,28 +19,79 @@
 
 #include "lib/php-header.h"
 #include "TSRM.h"
+#include "lib/arena.h"
 #include "lib/file.h"
 #include "lib/lib.h"
 
 #include "php_xdebug.h"
+#include "perf_events.h"
+#include "sampler.h"
+
+struct _xdebug_sampled_stack;
+struct _xdebug_profiler_merged;
+
+typedef struct
+{
+	void *(*init)(char *fname);
+	void (*deinit)(void *ctxt);
+	void (*write_header)(void *ctxt, char *script_name);
+	void (*write_footer)(void *ctxt);
+	char *(*get_filename)(void *ctxt);
+	void (*function_end)(void *ctxt, function_stack_entry *fse);
+	void (*add_sample)(void *ctxt, struct _xdebug_sampled_stack *ss);
+} xdebug_profiler_handler_t;
 
 typedef struct _xdebug_profiler_globals_t {
-	zend_bool       active;
-	uint64_t        profiler_start_nanotime;
-	xdebug_file     profile_file;
-	xdebug_hash    *profile_filename_refs;
-	int             profile_last_filename_ref;
-	int             php_internal_seen_before;
-	xdebug_hash    *profile_functionname_refs;
-	int             profile_last_functionname_ref;
+	zend_bool                  active;
+	uint64_t                   profiler_start_nanotime;
+	xdebug_profiler_handler_t *profiler_handler;
+	void                      *profiler_context;
+
+	/* Additional events, with xdebug.profiler_events */
+	int                   event_count;
+	const char           *event_names[XDEBUG_PROFILER_MAX_EVENTS];
+	zend_bool             cpu_time_event;
+	uint64_t              events_start[XDEBUG_PROFILER_MAX_EVENTS];
+	xdebug_perf_events    perf_events;
+	xdebug_arena         *events_arena; /* for the frames' event costs */
+
+	/* Call graph, when aggregating calls */
+	xdebug_hash    *aggregated_functions;
+	xdebug_llist   *aggregated_function_list;
+	xdebug_hash    *aggregated_calls;
+	int             aggregated_last_function_id;
+
+	/* Call graph of earlier requests, with xdebug.profiler_aggregate_requests
+	 * or xdebug.profiler_aggregate_interval. Unlike everything else in here,
+	 * this survives the end of the request. */
+	zend_bool                       merging;
+	struct _xdebug_profiler_merged *merged;
+
+	/* Sampling profiler, with xdebug.profiler_sample_frequency */
+	zend_bool             sampling;
+	uint64_t              sample_interval; /* in nanoseconds */
+	xdebug_sampler_timer  sample_timer;
+	void                 *sample_collapsed_context;
+	xdebug_hash          *samples;
+	xdebug_llist         *sample_list;
+	void                 *sample_frames;
+	size_t                sample_frames_size;
 } xdebug_profiler_globals_t;
 
 typedef struct _xdebug_profiler_settings_t {
 	char         *profiler_output_name; /* "pid" or "crc32" */
 	zend_bool     profiler_append;
+	zend_bool     profiler_aggregate_calls;
+	zend_long     profiler_aggregate_requests;
+	zend_long     profiler_aggregate_interval;
+	zend_long     profiler_sample_frequency;
+	zend_long     profiler_format;
+	char         *profiler_events;
+	zend_bool     profiler_cpu_time;
 } xdebug_profiler_settings_t;
 
 void xdebug_init_profiler_globals(xdebug_profiler_globals_t *xg);
+void xdebug_deinit_profiler_globals(xdebug_profiler_globals_t *xg);
 void xdebug_profiler_minit(void);
 void xdebug_profiler_mshutdown(void);
 void xdebug_profiler_rinit(void);
@@ -54,6 +105,8 @@ void xdebug_profiler_execute_ex_end(function_stack_entry *fse);
 void xdebug_profiler_execute_internal(function_stack_entry *fse);
 void xdebug_profiler_execute_internal_end(function_stack_entry *fse);
 
+xdebug_file *xdebug_profiler_open_file(char *fname, const char *extension, int allow_async_writer);
+
 void xdebug_profiler_init(char *script_name);
 void xdebug_profiler_deinit();
 
@@ -64,8 +117,6 @@ void xdebug_profiler_free_function_details(function_stack_entry *fse);
 void xdebug_profiler_function_begin(function_stack_entry *fse);
 void xdebug_profiler_function_end(function_stack_entry *fse);
 
-void xdebug_profile_call_entry_dtor(void *dummy, void *elem);
-
 char *xdebug_get_profiler_filename(void);
 
 PHP_FUNCTION(xdebug_get_profiler_filename);
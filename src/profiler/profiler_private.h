@@ -16,16 +16,114 @@
 #ifndef __XDEBUG_PROFILER_PRIVATE_H__
 #define __XDEBUG_PROFILER_PRIVATE_H__
 
+#include "base/function_identity.h"
+
+/* Each file name is written out in full only once, after which the cachegrind
+ * file refers to it by its id. The id is only assigned when the name gets
+ * written for the first time. */
+typedef struct _xdebug_profile_filename_ref {
+	int   id;
+	char *name;
+} xdebug_profile_filename_ref;
+
+/* The calls that a frame makes are kept in an array in the frame's
+ * xdebug_profile, which is allocated from the cachegrind handler's arena.
+ * Each entry is followed by the costs of the profiler events, so entries
+ * need to be indexed with XDEBUG_CALL_ENTRY(). */
 typedef struct _xdebug_call_entry {
-	int          type; /* 0 = function call, 1 = line */
-	int          user_defined;
-	zend_string *filename;
-	char        *function;
-	int          lineno;
-	uint64_t     nanotime_taken;
-	long         mem_used;
+	int                          user_defined;
+	xdebug_profile_filename_ref *filename;
+	xdebug_function_identity    *function;
+	int                          lineno;
+	uint64_t                     nanotime_taken;
+	long                         mem_used;
+	uint64_t                     events[];
 } xdebug_call_entry;
 
+#define XDEBUG_CALL_ENTRY_SIZE(event_count) (sizeof(xdebug_call_entry) + (event_count) * sizeof(uint64_t))
+#define XDEBUG_CALL_ENTRY(entries, i) \
+	((xdebug_call_entry*) ((char*) (entries) + (i) * XDEBUG_CALL_ENTRY_SIZE(XG_PROF(event_count))))
+
+/* With the sampler, the number of samples is the only event */
+#define XDEBUG_PROFILER_SAMPLES_EVENT 0
+
+/* With xdebug.profiler_aggregate_calls, every distinct function gets one of
+ * these, and every distinct (caller, callee, line) edge one
+ * xdebug_aggregated_call. They are only written out at the end of the
+ * request. */
+typedef struct _xdebug_aggregated_function {
+	int                       id;
+	int                       user_defined;
+	char                     *filename;
+	xdebug_function_identity *function;
+	int                       lineno;
+	uint64_t                  nanotime;
+	long                      mem_used;
+	uint64_t                  events[XDEBUG_PROFILER_MAX_EVENTS];
+	xdebug_llist             *calls; /* in order of first occurrence */
+} xdebug_aggregated_function;
+
+typedef struct _xdebug_aggregated_call_key {
+	int caller_id;
+	int callee_id;
+	int lineno;
+} xdebug_aggregated_call_key;
+
+typedef struct _xdebug_aggregated_call {
+	xdebug_aggregated_function *callee;
+	int                         lineno;
+	unsigned long               calls;
+	uint64_t                    nanotime_taken;
+	long                        mem_used;
+	uint64_t                    events[XDEBUG_PROFILER_MAX_EVENTS];
+} xdebug_aggregated_call;
+
+/* With xdebug.profiler_aggregate_requests or xdebug.profiler_aggregate_interval,
+ * the call graph of each request is merged into this one, which lives in the
+ * module globals until enough requests, or time, have passed for it to be
+ * written out. Its functions carry their own identities, as those of a
+ * request are gone at the end of the request. */
+typedef struct _xdebug_profiler_merged {
+	char          *fname;          /* as formatted for the first request */
+	char          *script_name;
+	unsigned long  requests;
+	time_t         started;
+	uint64_t       nanotime;       /* of all requests together */
+	size_t         peak_memory;
+	int            event_count;
+	const char    *event_names[XDEBUG_PROFILER_MAX_EVENTS];
+	uint64_t       events[XDEBUG_PROFILER_MAX_EVENTS];
+	xdebug_hash   *functions;
+	xdebug_llist  *function_list;
+	xdebug_hash   *calls;
+	int            last_function_id;
+} xdebug_profiler_merged;
+
+/* With xdebug.profiler_sample_frequency, every distinct stack that the
+ * sampler sees gets one of these. 'frames' is also the key in the 'samples'
+ * hash, and starts with the outermost frame. */
+typedef struct _xdebug_sampled_frame {
+	xdebug_aggregated_function *function;
+	int                         lineno; /* where it was called from */
+} xdebug_sampled_frame;
+
+typedef struct _xdebug_sampled_stack {
+	unsigned long         count;
+	int                   depth;
+	xdebug_sampled_frame *frames;
+} xdebug_sampled_stack;
+
+xdebug_aggregated_function *xdebug_profiler_aggregated_function_for_frame(function_stack_entry *fse);
+xdebug_aggregated_call *xdebug_profiler_find_or_add_aggregated_call(xdebug_aggregated_function *caller, xdebug_aggregated_function *callee, int lineno);
+
+void xdebug_profiler_read_events(uint64_t *values);
+
+/* Internal and user defined functions get different refs, as the former are
+ * shown with a 'php::' prefix */
+#define FUNCTIONNAME_REF_KEY(fi, user_defined) ((((unsigned long) (fi)->id) << 1) | ((user_defined) == XDEBUG_BUILT_IN))
+
+#define NANOTIME_SCALE_10NS(nanotime) ((unsigned long)(((nanotime) + 5) / 10))
+
 #define XG_PROF(v)     (XG(globals.profiler.v))
 #define XINI_PROF(v)   (XG(settings.profiler.v))
 
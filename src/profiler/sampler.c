@@ -0,0 +1,276 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#include "lib/php-header.h"
+#include "TSRM.h"
+
+#include "php_xdebug.h"
+#include "profiler.h"
+#include "profiler_private.h"
+#include "profile_collapsed.h"
+#include "sampler.h"
+
+#include "lib/log.h"
+#include "lib/mm.h"
+#include "lib/timing.h"
+
+#if HAVE_XDEBUG_TIMER_CREATE
+# include <sched.h>
+#endif
+
+ZEND_EXTERN_MODULE_GLOBALS(xdebug)
+
+/* Sampling is driven by a POSIX timer that notifies through a thread of its
+ * own, instead of a signal. That way no system calls of the request get
+ * interrupted, and there is no clash with the SIGPROF timer that PHP uses
+ * for max_execution_time. The notification thread only counts the tick and
+ * sets the VM interrupt flag, and the sample is then taken by the executing
+ * thread itself, at the next safe point, through zend_interrupt_function. */
+
+#define XDEBUG_SAMPLER_MAX_FREQUENCY 10000
+
+#if HAVE_XDEBUG_TIMER_CREATE
+static void sampler_take_sample(int ticks)
+{
+	function_stack_entry *fse;
+	xdebug_sampled_frame *frames;
+	xdebug_sampled_stack *ss;
+	size_t                depth = XDEBUG_VECTOR_COUNT(XG_BASE(stack));
+	size_t                size = depth * sizeof(xdebug_sampled_frame);
+	size_t                i;
+
+	if (depth == 0) {
+		return;
+	}
+
+	if (size > XG_PROF(sample_frames_size)) {
+		XG_PROF(sample_frames) = xdrealloc(XG_PROF(sample_frames), size);
+		XG_PROF(sample_frames_size) = size;
+	}
+	frames = XG_PROF(sample_frames);
+
+	/* The frames are used as hash key, so padding needs to be cleared */
+	memset(frames, 0, size);
+
+	fse = XDEBUG_VECTOR_HEAD(XG_BASE(stack));
+	for (i = 0; i < depth; i++, fse++) {
+		frames[i].function = xdebug_profiler_aggregated_function_for_frame(fse);
+		frames[i].lineno = fse->lineno;
+	}
+
+	if (!xdebug_hash_find(XG_PROF(samples), (char*) frames, size, (void*) &ss)) {
+		ss = xdmalloc(sizeof(xdebug_sampled_stack));
+		ss->count = 0;
+		ss->depth = depth;
+		ss->frames = xdmalloc(size);
+		memcpy(ss->frames, frames, size);
+
+		xdebug_hash_add(XG_PROF(samples), (char*) ss->frames, size, (void*) ss);
+		xdebug_llist_insert_next(XG_PROF(sample_list), NULL, ss);
+	}
+
+	/* Ticks that arrived while PHP could not be interrupted, such as during
+	 * a long running internal function, are attributed to this stack */
+	ss->count += ticks;
+}
+
+static void (*xdebug_old_interrupt_function)(zend_execute_data *execute_data);
+
+static void xdebug_sampler_interrupt_function(zend_execute_data *execute_data)
+{
+	int ticks = __sync_lock_test_and_set(&XG_PROF(sample_timer).ticks, 0);
+
+	if (ticks && XG_PROF(sampling)) {
+		sampler_take_sample(ticks);
+	}
+
+	if (xdebug_old_interrupt_function) {
+		xdebug_old_interrupt_function(execute_data);
+	}
+}
+
+void xdebug_profiler_sampler_minit(void)
+{
+	xdebug_old_interrupt_function = zend_interrupt_function;
+	zend_interrupt_function = xdebug_sampler_interrupt_function;
+}
+
+void xdebug_profiler_sampler_mshutdown(void)
+{
+	zend_interrupt_function = xdebug_old_interrupt_function;
+}
+
+static void sampler_timer_notify(union sigval sv)
+{
+	xdebug_sampler_timer *timer = (xdebug_sampler_timer*) sv.sival_ptr;
+
+	__sync_fetch_and_add(&timer->notifying, 1);
+
+	if (__sync_fetch_and_add(&timer->armed, 0)) {
+		__sync_fetch_and_add(&timer->ticks, 1);
+# if PHP_VERSION_ID >= 80200
+		zend_atomic_bool_store(timer->vm_interrupt, true);
+# else
+		*timer->vm_interrupt = 1;
+# endif
+	}
+
+	__sync_fetch_and_sub(&timer->notifying, 1);
+}
+
+static int sampler_timer_start(uint64_t interval)
+{
+	xdebug_sampler_timer *timer = &XG_PROF(sample_timer);
+	struct sigevent       sev;
+	struct itimerspec     its;
+
+	timer->ticks = 0;
+	timer->notifying = 0;
+	timer->vm_interrupt = &EG(vm_interrupt);
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD;
+	sev.sigev_notify_function = sampler_timer_notify;
+	sev.sigev_value.sival_ptr = timer;
+
+	if (timer_create(CLOCK_MONOTONIC, &sev, &timer->timer_id) != 0) {
+		return 0;
+	}
+
+	its.it_interval.tv_sec = interval / NANOS_IN_SEC;
+	its.it_interval.tv_nsec = interval % NANOS_IN_SEC;
+	its.it_value = its.it_interval;
+
+	__sync_lock_test_and_set(&timer->armed, 1);
+
+	if (timer_settime(timer->timer_id, 0, &its, NULL) != 0) {
+		__sync_lock_test_and_set(&timer->armed, 0);
+		timer_delete(timer->timer_id);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void sampler_timer_stop(void)
+{
+	xdebug_sampler_timer *timer = &XG_PROF(sample_timer);
+
+	if (!__sync_lock_test_and_set(&timer->armed, 0)) {
+		return;
+	}
+
+	timer_delete(timer->timer_id);
+
+	/* Notifications that saw the timer as armed are not done with the VM
+	 * interrupt flag yet */
+	while (__sync_fetch_and_add(&timer->notifying, 0)) {
+		sched_yield();
+	}
+}
+#else
+void xdebug_profiler_sampler_minit(void)
+{
+}
+
+void xdebug_profiler_sampler_mshutdown(void)
+{
+}
+
+static int sampler_timer_start(uint64_t interval)
+{
+	return 0;
+}
+
+static void sampler_timer_stop(void)
+{
+}
+#endif
+
+static void sampled_stack_dtor(void *dummy, void *elem)
+{
+	xdebug_sampled_stack *ss = elem;
+
+	xdfree(ss->frames);
+	xdfree(ss);
+}
+
+/* Returns 0 when sampling is not possible, in which case the profiler falls
+ * back to instrumenting every call */
+int xdebug_profiler_sampler_init(char *fname)
+{
+	zend_long frequency = XINI_PROF(profiler_sample_frequency);
+
+	if (frequency > XDEBUG_SAMPLER_MAX_FREQUENCY) {
+		frequency = XDEBUG_SAMPLER_MAX_FREQUENCY;
+	}
+	XG_PROF(sample_interval) = NANOS_IN_SEC / frequency;
+
+	if (!sampler_timer_start(XG_PROF(sample_interval))) {
+		xdebug_log_ex(
+			XLOG_CHAN_PROFILE, XLOG_WARN, "SAMPLER",
+			"Can not start the sampling profiler on this platform, falling back to profiling every call"
+		);
+		return 0;
+	}
+
+	/* The samples are always also written in the collapsed stack format */
+	if (XG_PROF(profiler_handler) != &xdebug_profiler_handler_collapsed) {
+		XG_PROF(sample_collapsed_context) = xdebug_profiler_handler_collapsed.init(fname);
+	}
+
+	XG_PROF(samples) = xdebug_hash_alloc(1024, NULL);
+	XG_PROF(sample_list) = xdebug_llist_alloc(sampled_stack_dtor);
+
+	return 1;
+}
+
+void xdebug_profiler_sampler_stop(void)
+{
+	sampler_timer_stop();
+}
+
+void xdebug_profiler_sampler_deinit(void)
+{
+	xdebug_llist_element *le;
+
+	for (le = XDEBUG_LLIST_HEAD(XG_PROF(sample_list)); le != NULL; le = XDEBUG_LLIST_NEXT(le)) {
+		xdebug_sampled_stack *ss = XDEBUG_LLIST_VALP(le);
+
+		XG_PROF(profiler_handler)->add_sample(XG_PROF(profiler_context), ss);
+
+		if (XG_PROF(sample_collapsed_context)) {
+			xdebug_profiler_handler_collapsed.add_sample(XG_PROF(sample_collapsed_context), ss);
+		}
+	}
+
+	if (XG_PROF(sample_collapsed_context)) {
+		xdebug_profiler_handler_collapsed.write_footer(XG_PROF(sample_collapsed_context));
+		xdebug_profiler_handler_collapsed.deinit(XG_PROF(sample_collapsed_context));
+		XG_PROF(sample_collapsed_context) = NULL;
+	}
+
+	xdebug_hash_destroy(XG_PROF(samples));
+	xdebug_llist_destroy(XG_PROF(sample_list), NULL);
+	XG_PROF(samples) = NULL;
+	XG_PROF(sample_list) = NULL;
+
+	if (XG_PROF(sample_frames)) {
+		xdfree(XG_PROF(sample_frames));
+		XG_PROF(sample_frames) = NULL;
+		XG_PROF(sample_frames_size) = 0;
+	}
+}
@@ -0,0 +1,56 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+
+#ifndef __XDEBUG_PROFILER_SAMPLER_H__
+#define __XDEBUG_PROFILER_SAMPLER_H__
+
+#include "lib/php-header.h"
+#if PHP_VERSION_ID >= 80200
+# include "Zend/zend_atomic.h"
+#endif
+
+#if HAVE_XDEBUG_TIMER_CREATE
+# include <signal.h>
+# include <time.h>
+#endif
+
+/* The timer notifies through a separate thread, which can not access the
+ * request's globals. It only gets a pointer to this struct, which lives in
+ * the profiler's globals. A notification can still run after the timer has
+ * been deleted, so it only touches the VM interrupt flag while 'armed' is
+ * set, and 'notifying' lets stopping the timer wait for it to finish. */
+typedef struct _xdebug_sampler_timer {
+	volatile int           ticks;
+#if PHP_VERSION_ID >= 80200
+	zend_atomic_bool      *vm_interrupt;
+#else
+	volatile zend_bool    *vm_interrupt;
+#endif
+#if HAVE_XDEBUG_TIMER_CREATE
+	timer_t                timer_id;
+#endif
+	volatile int           armed;
+	volatile int           notifying;
+} xdebug_sampler_timer;
+
+void xdebug_profiler_sampler_minit(void);
+void xdebug_profiler_sampler_mshutdown(void);
+
+int  xdebug_profiler_sampler_init(char *fname);
+void xdebug_profiler_sampler_stop(void);
+void xdebug_profiler_sampler_deinit(void);
+
+#endif
@@ -0,0 +1,379 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#include "lib/php-header.h"
+
+#include "php_xdebug.h"
+#include "tracing_private.h"
+#include "trace_binary.h"
+
+#include "base/function_identity.h"
+#include "lib/lib_private.h"
+#include "lib/var_export_line.h"
+
+extern ZEND_DECLARE_MODULE_GLOBALS(xdebug);
+
+/*
+ * The binary format starts with the four bytes "XDTB", followed by the
+ * format version, the Xdebug version, the start time, and the header flags.
+ * After that, each record starts with a single type byte:
+ *
+ *   'S' id name                 defines a string of the string table
+ *   'E' level nr time memory function-id user-defined include-type include
+ *       filename-id lineno argc args...
+ *   'X' level nr time memory [cpu-time]
+ *   'R' level nr time memory value
+ *   'A' level filename-id lineno varname op [value right-varname]
+ *   'F' time memory end-time
+ *
+ * Numbers are unsigned LEB128 varints. Strings are a varint length followed
+ * by the bytes. Function names and file names are only written once, as an
+ * 'S' record before the first record that refers to them by id. Times are
+ * the zigzag encoded difference in nanoseconds with the time of the previous
+ * record, with the first one relative to the start of the request. The CPU
+ * time is in nanoseconds, and only present when the header flags have
+ * XDEBUG_TRACE_BINARY_FLAG_CPU_TIME set.
+ *
+ * The include-type is 0 for no include, 1 for an include or require with the
+ * file name's string id as include, and 2 for eval() with the evaluated code
+ * as (inline) string.
+ *
+ * Each argument is written as its flags (1 for variadic, 2 for a value that
+ * is not available), the string id of its name (0 when there is none), and,
+ * unless the flags have 2 set, its value. The right-varname of assignments
+ * is empty when the right hand side was not a variable.
+ *
+ * contrib/trace-binary-reader.php converts these files to the textual and
+ * computerized formats.
+ */
+
+#define BINARY_INCLUDE_NONE 0
+#define BINARY_INCLUDE_FILE 1
+#define BINARY_INCLUDE_EVAL 2
+
+#define BINARY_ARG_VARIADIC  1
+#define BINARY_ARG_UNDEFINED 2
+
+static void add_varint(xdebug_str *str, uint64_t value)
+{
+	char buffer[10];
+	int  len = 0;
+
+	while (value >= 0x80) {
+		buffer[len++] = (char) ((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	buffer[len++] = (char) value;
+
+	xdebug_str_addl(str, buffer, len, 0);
+}
+
+static void add_string(xdebug_str *str, const char *value, size_t value_len)
+{
+	add_varint(str, value_len);
+	xdebug_str_addl(str, value, value_len, 0);
+}
+
+static void add_time(xdebug_trace_binary_context *context, xdebug_str *str, uint64_t nanotime)
+{
+	int64_t delta = (int64_t) (nanotime - context->last_nanotime);
+
+	add_varint(str, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+	context->last_nanotime = nanotime;
+}
+
+/* Returns the string table id for 'value', and adds its 'S' record to 'str'
+ * if it has not been written yet. This needs to be called before starting
+ * the record that refers to the id. */
+static uint64_t string_ref(xdebug_trace_binary_context *context, xdebug_str *str, const char *value, size_t value_len)
+{
+	void *id;
+
+	if (xdebug_hash_find(context->string_ids, value, value_len, &id)) {
+		return (uint64_t) (uintptr_t) id;
+	}
+
+	context->last_string_id++;
+	xdebug_hash_add(context->string_ids, value, value_len, (void*) (uintptr_t) context->last_string_id);
+
+	xdebug_str_addc(str, 'S');
+	add_varint(str, context->last_string_id);
+	add_string(str, value, value_len);
+
+	return context->last_string_id;
+}
+
+/* The value is exported into a buffer that is reused for every value, as its
+ * length needs to be written before it */
+static void add_value(xdebug_trace_binary_context *context, xdebug_str *str, zval *zv, const char *fallback)
+{
+	if (!zv || Z_ISUNDEF_P(zv)) {
+		add_string(str, fallback, strlen(fallback));
+		return;
+	}
+
+	context->value.l = 0;
+	xdebug_add_zval_value_line(&context->value, zv, 0, context->export_options);
+	add_string(str, context->value.d, context->value.l);
+}
+
+static void write_record(xdebug_trace_binary_context *context, xdebug_str *str)
+{
+	xdebug_file_write(str->d, 1, str->l, context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
+	xdebug_str_destroy(str);
+}
+
+void *xdebug_trace_binary_init(char *fname, zend_string *script_filename, long options)
+{
+	xdebug_trace_binary_context *tmp_binary_context;
+
+	tmp_binary_context = xdmalloc(sizeof(xdebug_trace_binary_context));
+	tmp_binary_context->trace_file = xdebug_trace_open_file(fname, script_filename, options);
+
+	if (!tmp_binary_context->trace_file) {
+		xdfree(tmp_binary_context);
+		return NULL;
+	}
+
+	tmp_binary_context->options = options;
+	tmp_binary_context->string_ids = xdebug_hash_alloc(1024, NULL);
+	tmp_binary_context->last_string_id = 0;
+	tmp_binary_context->last_nanotime = XG_BASE(start_nanotime);
+	tmp_binary_context->value.l = 0;
+	tmp_binary_context->value.a = 0;
+	tmp_binary_context->value.d = NULL;
+	tmp_binary_context->export_options = xdebug_var_export_options_from_ini();
+
+	return tmp_binary_context;
+}
+
+void xdebug_trace_binary_deinit(void *ctxt)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+
+	xdebug_file_close(context->trace_file);
+	xdebug_file_dtor(context->trace_file);
+	context->trace_file = NULL;
+
+	xdebug_hash_destroy(context->string_ids);
+	xdebug_str_destroy(&context->value);
+	xdfree(context->export_options->runtime);
+	xdfree(context->export_options);
+
+	xdfree(context);
+}
+
+void xdebug_trace_binary_write_header(void *ctxt)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+	xdebug_str                   str = XDEBUG_STR_INITIALIZER;
+	char                        *str_time;
+
+	xdebug_str_add_literal(&str, XDEBUG_TRACE_BINARY_MAGIC);
+	add_varint(&str, XDEBUG_TRACE_BINARY_VERSION);
+	add_string(&str, XDEBUG_VERSION, strlen(XDEBUG_VERSION));
+
+	str_time = xdebug_nanotime_to_chars(xdebug_get_nanotime(), 6);
+	add_string(&str, str_time, strlen(str_time));
+	xdfree(str_time);
+
+	add_varint(&str, (context->options & XDEBUG_TRACE_OPTION_CPU_TIME) ? XDEBUG_TRACE_BINARY_FLAG_CPU_TIME : 0);
+
+	write_record(context, &str);
+}
+
+void xdebug_trace_binary_write_footer(void *ctxt)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+	xdebug_str                   str = XDEBUG_STR_INITIALIZER;
+	char                        *str_time;
+	uint64_t                     nanotime;
+
+	nanotime = xdebug_get_nanotime();
+
+	xdebug_str_addc(&str, 'F');
+	add_time(context, &str, nanotime);
+	add_varint(&str, zend_memory_usage(0));
+
+	str_time = xdebug_nanotime_to_chars(nanotime, 6);
+	add_string(&str, str_time, strlen(str_time));
+	xdfree(str_time);
+
+	write_record(context, &str);
+}
+
+char *xdebug_trace_binary_get_filename(void *ctxt)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+
+	return context->trace_file->name;
+}
+
+void xdebug_trace_binary_function_entry(void *ctxt, function_stack_entry *fse, int function_nr)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+	xdebug_function_identity    *fi;
+	xdebug_str                   str = XDEBUG_STR_INITIALIZER;
+	uint64_t                     function_id, filename_id, include_id = 0;
+	uint64_t                    *name_ids = NULL;
+	unsigned int                 j;
+	int                          sent_variables = fse->varc;
+
+	if (sent_variables > 0 && fse->var[sent_variables-1].is_variadic && Z_ISUNDEF(fse->var[sent_variables-1].data)) {
+		sent_variables--;
+	}
+
+	fi = xdebug_function_identity_for_frame(fse);
+
+	function_id = string_ref(context, &str, fi->name, fi->name_len);
+	filename_id = string_ref(context, &str, ZSTR_VAL(fse->filename), ZSTR_LEN(fse->filename));
+	if (fse->include_filename && fse->function.type != XFUNC_EVAL) {
+		include_id = string_ref(context, &str, ZSTR_VAL(fse->include_filename), ZSTR_LEN(fse->include_filename));
+	}
+	if (sent_variables > 0) {
+		name_ids = xdmalloc(sent_variables * sizeof(uint64_t));
+
+		for (j = 0; j < sent_variables; j++) {
+			name_ids[j] = fse->var[j].name ? string_ref(context, &str, ZSTR_VAL(fse->var[j].name), ZSTR_LEN(fse->var[j].name)) : 0;
+		}
+	}
+
+	xdebug_str_addc(&str, 'E');
+	add_varint(&str, fse->level);
+	add_varint(&str, function_nr);
+	add_time(context, &str, fse->nanotime);
+	add_varint(&str, fse->memory);
+	add_varint(&str, function_id);
+	add_varint(&str, fse->user_defined == XDEBUG_USER_DEFINED ? 1 : 0);
+
+	if (!fse->include_filename) {
+		add_varint(&str, BINARY_INCLUDE_NONE);
+	} else if (fse->function.type == XFUNC_EVAL) {
+		add_varint(&str, BINARY_INCLUDE_EVAL);
+		add_string(&str, ZSTR_VAL(fse->include_filename), ZSTR_LEN(fse->include_filename));
+	} else {
+		add_varint(&str, BINARY_INCLUDE_FILE);
+		add_varint(&str, include_id);
+	}
+
+	add_varint(&str, filename_id);
+	add_varint(&str, fse->lineno);
+
+	add_varint(&str, sent_variables);
+	for (j = 0; j < sent_variables; j++) {
+		int flags = 0;
+
+		if (fse->var[j].is_variadic) {
+			flags |= BINARY_ARG_VARIADIC;
+		}
+		if (Z_ISUNDEF(fse->var[j].data)) {
+			flags |= BINARY_ARG_UNDEFINED;
+		}
+
+		add_varint(&str, flags);
+		add_varint(&str, name_ids[j]);
+		if (!(flags & BINARY_ARG_UNDEFINED)) {
+			add_value(context, &str, &(fse->var[j].data), "???");
+		}
+	}
+	if (name_ids) {
+		xdfree(name_ids);
+	}
+
+	write_record(context, &str);
+
+	if (context->options & XDEBUG_TRACE_OPTION_CPU_TIME) {
+		fse->cpu_nanotime = xdebug_get_thread_cputime();
+	}
+}
+
+void xdebug_trace_binary_function_exit(void *ctxt, function_stack_entry *fse, int function_nr)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+	xdebug_str                   str = XDEBUG_STR_INITIALIZER;
+
+	xdebug_str_addc(&str, 'X');
+	add_varint(&str, fse->level);
+	add_varint(&str, function_nr);
+	add_time(context, &str, xdebug_get_nanotime());
+	add_varint(&str, zend_memory_usage(0));
+
+	if (context->options & XDEBUG_TRACE_OPTION_CPU_TIME) {
+		add_varint(&str, xdebug_get_thread_cputime() - fse->cpu_nanotime);
+	}
+
+	write_record(context, &str);
+}
+
+void xdebug_trace_binary_function_return_value(void *ctxt, function_stack_entry *fse, int function_nr, zval *return_value)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+	xdebug_str                   str = XDEBUG_STR_INITIALIZER;
+
+	xdebug_str_addc(&str, 'R');
+	add_varint(&str, fse->level);
+	add_varint(&str, function_nr);
+	add_time(context, &str, xdebug_get_nanotime());
+	add_varint(&str, zend_memory_usage(0));
+	add_value(context, &str, return_value, "???");
+
+	write_record(context, &str);
+}
+
+void xdebug_trace_binary_assignment(void *ctxt, function_stack_entry *fse, char *full_varname, zval *retval, char *right_full_varname, const char *op, char *filename, int lineno)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+	xdebug_str                   str = XDEBUG_STR_INITIALIZER;
+	uint64_t                     filename_id;
+
+	filename_id = string_ref(context, &str, filename, strlen(filename));
+
+	xdebug_str_addc(&str, 'A');
+	add_varint(&str, fse->level);
+	add_varint(&str, filename_id);
+	add_varint(&str, lineno);
+	add_string(&str, full_varname, strlen(full_varname));
+	add_string(&str, op, strlen(op));
+
+	if (op[0] != '\0') { /* pre/post inc/dec ops are special */
+		add_value(context, &str, retval, "NULL");
+		add_string(&str, right_full_varname ? right_full_varname : "", right_full_varname ? strlen(right_full_varname) : 0);
+	}
+
+	write_record(context, &str);
+}
+
+void xdebug_trace_binary_flush(void *ctxt)
+{
+	xdebug_trace_binary_context *context = (xdebug_trace_binary_context*) ctxt;
+
+	xdebug_file_flush(context->trace_file);
+}
+
+xdebug_trace_handler_t xdebug_trace_handler_binary =
+{
+	xdebug_trace_binary_init,
+	xdebug_trace_binary_deinit,
+	xdebug_trace_binary_write_header,
+	xdebug_trace_binary_write_footer,
+	xdebug_trace_binary_get_filename,
+	xdebug_trace_binary_function_entry,
+	xdebug_trace_binary_function_exit,
+	xdebug_trace_binary_function_return_value,
+	NULL /* xdebug_trace_binary_generator_return_value */,
+	xdebug_trace_binary_assignment,
+	xdebug_trace_binary_flush
+};
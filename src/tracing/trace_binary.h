@@ -0,0 +1,41 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#ifndef XDEBUG_TRACE_BINARY_H
+#define XDEBUG_TRACE_BINARY_H
+
+#include "tracing_private.h"
+#include "lib/hash.h"
+#include "lib/var.h"
+
+#define XDEBUG_TRACE_BINARY_MAGIC   "XDTB"
+#define XDEBUG_TRACE_BINARY_VERSION 1
+
+/* Flags in the header, which say which optional fields the records have */
+#define XDEBUG_TRACE_BINARY_FLAG_CPU_TIME 1
+
+typedef struct _xdebug_trace_binary_context
+{
+	xdebug_file *trace_file;
+	long         options;
+	xdebug_hash *string_ids;
+	uint64_t     last_string_id;
+	uint64_t     last_nanotime;
+	xdebug_str   value;
+	xdebug_var_export_options *export_options;
+} xdebug_trace_binary_context;
+
+extern xdebug_trace_handler_t xdebug_trace_handler_binary;
+#endif
@@ -20,6 +20,7 @@
 #include "tracing_private.h"
 #include "trace_computerized.h"
 
+#include "base/function_identity.h"
 #include "lib/lib_private.h"
 #include "lib/var_export_line.h"
 
@@ -37,6 +38,13 @@ void *xdebug_trace_computerized_init(char *fname, zend_string *script_filename,
 		return NULL;
 	}
 
+	tmp_computerized_context->options = options;
+
+	/* Read once, instead of for every value that is written, and only read
+	 * again when the settings are changed during the trace */
+	tmp_computerized_context->export_options = xdebug_var_export_options_from_ini();
+	tmp_computerized_context->export_options_generation = XG_LIB(var_display_generation);
+
 	return tmp_computerized_context;
 }
 
@@ -48,6 +56,9 @@ void xdebug_trace_computerized_deinit(void *ctxt)
 	xdebug_file_dtor(context->trace_file);
 	context->trace_file = NULL;
 
+	xdfree(context->export_options->runtime);
+	xdfree(context->export_options);
+
 	xdfree(context);
 }
 
@@ -92,21 +103,7 @@ char *xdebug_trace_computerized_get_filename(void *ctxt)
 	return context->trace_file->name;
 }
 
-static void add_single_value(xdebug_str *str, zval *zv)
-{
-	xdebug_str *tmp_value = NULL;
-
-	tmp_value = xdebug_get_zval_value_line(zv, 0, NULL);
-
-	if (tmp_value) {
-		xdebug_str_add_str(str, tmp_value);
-		xdebug_str_free(tmp_value);
-	} else {
-		xdebug_str_add_literal(str, "???");
-	}
-}
-
-static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse)
+static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse, xdebug_var_export_options *options)
 {
 	unsigned int j = 0; /* Counter */
 	int sent_variables = fse->varc;
@@ -123,7 +120,7 @@ static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse)
 		xdebug_str_addc(line_entry, '\t');
 
 		if (!Z_ISUNDEF(fse->var[j].data)) {
-			add_single_value(line_entry, &(fse->var[j].data));
+			xdebug_add_zval_value_line(line_entry, &(fse->var[j].data), 0, options);
 		} else {
 			xdebug_str_add_literal(line_entry, "???");
 		}
@@ -133,24 +130,24 @@ static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse)
 void xdebug_trace_computerized_function_entry(void *ctxt, function_stack_entry *fse, int function_nr)
 {
 	xdebug_trace_computerized_context *context = (xdebug_trace_computerized_context*) ctxt;
-	char *tmp_name;
+	xdebug_function_identity *fi;
 	xdebug_str str = XDEBUG_STR_INITIALIZER;
 
 	xdebug_str_add_fmt(&str, "%d\t", fse->level);
 	xdebug_str_add_fmt(&str, "%d\t", function_nr);
 
-	tmp_name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
+	fi = xdebug_function_identity_for_frame(fse);
 
 	xdebug_str_add_literal(&str, "0\t");
 	xdebug_str_add_fmt(&str, "%F\t", XDEBUG_SECONDS_SINCE_START(fse->nanotime));
 	xdebug_str_add_fmt(&str, "%lu\t", fse->memory);
-	xdebug_str_add_fmt(&str, "%s\t", tmp_name);
+	xdebug_str_addl(&str, fi->name, fi->name_len, 0);
+	xdebug_str_addc(&str, '\t');
 	if (fse->user_defined == XDEBUG_USER_DEFINED) {
 		xdebug_str_add_literal(&str, "1\t");
 	} else {
 		xdebug_str_add_literal(&str, "0\t");
 	}
-	xdfree(tmp_name);
 
 	if (fse->include_filename) {
 		if (fse->function.type == XFUNC_EVAL) {
@@ -170,14 +167,19 @@ void xdebug_trace_computerized_function_entry(void *ctxt, function_stack_entry *
 	/* Filename and Lineno (9, 10) */
 	xdebug_str_add_fmt(&str, "\t%s\t%d", ZSTR_VAL(fse->filename), fse->lineno);
 
-	add_arguments(&str, fse);
+	xdebug_var_export_options_refresh_from_ini(&context->export_options, &context->export_options_generation);
+	add_arguments(&str, fse, context->export_options);
 
 	/* Trailing \n */
 	xdebug_str_addc(&str, '\n');
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 	xdfree(str.d);
+
+	if (context->options & XDEBUG_TRACE_OPTION_CPU_TIME) {
+		fse->cpu_nanotime = xdebug_get_thread_cputime();
+	}
 }
 
 void xdebug_trace_computerized_function_exit(void *ctxt, function_stack_entry *fse, int function_nr)
@@ -190,10 +192,16 @@ void xdebug_trace_computerized_function_exit(void *ctxt, function_stack_entry *f
 
 	xdebug_str_add_literal(&str, "1\t");
 	xdebug_str_add_fmt(&str, "%F\t", XDEBUG_SECONDS_SINCE_START(xdebug_get_nanotime()));
-	xdebug_str_add_fmt(&str, "%lu\n", zend_memory_usage(0));
+	xdebug_str_add_fmt(&str, "%lu", zend_memory_usage(0));
+
+	/* CPU time spent in the call (6) */
+	if (context->options & XDEBUG_TRACE_OPTION_CPU_TIME) {
+		xdebug_str_add_fmt(&str, "\t%F", (xdebug_get_thread_cputime() - fse->cpu_nanotime) / (double) NANOS_IN_SEC);
+	}
+	xdebug_str_addc(&str, '\n');
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 	xdfree(str.d);
 }
 
@@ -206,12 +214,13 @@ void xdebug_trace_computerized_function_return_value(void *ctxt, function_stack_
 	xdebug_str_add_fmt(&str, "%d\t", function_nr);
 	xdebug_str_add_literal(&str, "R\t\t\t");
 
-	add_single_value(&str, return_value);
+	xdebug_var_export_options_refresh_from_ini(&context->export_options, &context->export_options_generation);
+	xdebug_add_zval_value_line(&str, return_value, 0, context->export_options);
 
 	xdebug_str_add_literal(&str, "\n");
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 	xdfree(str.d);
 }
 
@@ -252,11 +261,18 @@ void xdebug_trace_computerized_assignment(void *ctxt, function_stack_entry *fse,
 	xdebug_str_add_literal(&str, "\n");
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 
 	xdfree(str.d);
 }
 
+void xdebug_trace_computerized_flush(void *ctxt)
+{
+	xdebug_trace_computerized_context *context = (xdebug_trace_computerized_context*) ctxt;
+
+	xdebug_file_flush(context->trace_file);
+}
+
 xdebug_trace_handler_t xdebug_trace_handler_computerized =
 {
 	xdebug_trace_computerized_init,
@@ -268,5 +284,6 @@ xdebug_trace_handler_t xdebug_trace_handler_computerized =
 	xdebug_trace_computerized_function_exit,
 	xdebug_trace_computerized_function_return_value,
 	NULL /* xdebug_trace_computerized_generator_return_value */,
-	xdebug_trace_computerized_assignment
+	xdebug_trace_computerized_assignment,
+	xdebug_trace_computerized_flush
 };
@@ -17,10 +17,14 @@
 #define XDEBUG_TRACE_COMPUTERIZED_H
 
 #include "tracing_private.h"
+#include "lib/var.h"
 
 typedef struct _xdebug_trace_computerized_context
 {
 	xdebug_file *trace_file;
+	long         options;
+	xdebug_var_export_options *export_options;
+	unsigned int               export_options_generation;
 } xdebug_trace_computerized_context;
 
 extern xdebug_trace_handler_t xdebug_trace_handler_computerized;
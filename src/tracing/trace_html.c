@@ -19,6 +19,7 @@
 #include "tracing_private.h"
 #include "trace_html.h"
 
+#include "base/function_identity.h"
 #include "lib/var.h"
 
 extern ZEND_DECLARE_MODULE_GLOBALS(xdebug);
@@ -78,7 +79,7 @@ char *xdebug_trace_html_get_filename(void *ctxt)
 void xdebug_trace_html_function_entry(void *ctxt, function_stack_entry *fse, int function_nr)
 {
 	xdebug_trace_html_context *context = (xdebug_trace_html_context*) ctxt;
-	char *tmp_name;
+	xdebug_function_identity *fi;
 	unsigned int j;
 	xdebug_str str = XDEBUG_STR_INITIALIZER;
 
@@ -92,9 +93,10 @@ void xdebug_trace_html_function_entry(void *ctxt, function_stack_entry *fse, int
 	}
 	xdebug_str_add_literal(&str, "-&gt;</td>");
 
-	tmp_name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
-	xdebug_str_add_fmt(&str, "<td>%s(", tmp_name);
-	xdfree(tmp_name);
+	fi = xdebug_function_identity_for_frame(fse);
+	xdebug_str_add_literal(&str, "<td>");
+	xdebug_str_addl(&str, fi->name, fi->name_len, 0);
+	xdebug_str_addc(&str, '(');
 
 	if (fse->include_filename) {
 		if (fse->function.type == XFUNC_EVAL) {
@@ -117,10 +119,17 @@ void xdebug_trace_html_function_entry(void *ctxt, function_stack_entry *fse, int
 	xdebug_str_add_literal(&str, "</tr>\n");
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 	xdfree(str.d);
 }
 
+void xdebug_trace_html_flush(void *ctxt)
+{
+	xdebug_trace_html_context *context = (xdebug_trace_html_context*) ctxt;
+
+	xdebug_file_flush(context->trace_file);
+}
+
 xdebug_trace_handler_t xdebug_trace_handler_html =
 {
 	xdebug_trace_html_init,
@@ -132,5 +141,6 @@ xdebug_trace_handler_t xdebug_trace_handler_html =
 	NULL /* xdebug_trace_html_function_exit */,
 	NULL /* xdebug_trace_html_function_return_value */,
 	NULL /* xdebug_trace_html_generator_return_value */,
-	NULL /* xdebug_trace_html_assignment */
+	NULL /* xdebug_trace_html_assignment */,
+	xdebug_trace_html_flush
 };
@@ -0,0 +1,271 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#include "lib/php-header.h"
+
+#include "php_xdebug.h"
+#include "tracing_private.h"
+#include "trace_summary.h"
+
+#include "base/function_identity.h"
+#include "lib/lib_private.h"
+
+extern ZEND_DECLARE_MODULE_GLOBALS(xdebug);
+
+/*
+ * Instead of writing a record for each call, the summary format only counts
+ * per function how often it was called, and how much time and memory its
+ * calls took, both including (inclusive) and excluding (own) the calls that
+ * it made. The table that contrib/tracefile-analyser.php creates from a
+ * computerized trace is then written at the end of the trace, sorted by own
+ * time.
+ *
+ * Just like with the analyser, the inclusive cost of recursive calls is only
+ * counted for the outermost call, so that it is not counted more than once.
+ * The own cost is counted for every call.
+ */
+
+static void function_dtor(void *data)
+{
+	xdebug_trace_summary_function *function = (xdebug_trace_summary_function*) data;
+
+	xdfree(function->name);
+	xdfree(function);
+}
+
+static int function_compare(const void *a, const void *b)
+{
+	xdebug_trace_summary_function *fa = (xdebug_trace_summary_function*) (*(xdebug_hash_element**) a)->ptr;
+	xdebug_trace_summary_function *fb = (xdebug_trace_summary_function*) (*(xdebug_hash_element**) b)->ptr;
+
+	if (fa->time_own != fb->time_own) {
+		return fa->time_own > fb->time_own ? -1 : 1;
+	}
+
+	return strcmp(fa->name, fb->name);
+}
+
+void *xdebug_trace_summary_init(char *fname, zend_string *script_filename, long options)
+{
+	xdebug_trace_summary_context *tmp_summary_context;
+
+	tmp_summary_context = xdmalloc(sizeof(xdebug_trace_summary_context));
+	tmp_summary_context->trace_file = xdebug_trace_open_file(fname, script_filename, options);
+
+	if (!tmp_summary_context->trace_file) {
+		xdfree(tmp_summary_context);
+		return NULL;
+	}
+
+	tmp_summary_context->functions = xdebug_hash_alloc_with_sort(1024, function_dtor, function_compare);
+	tmp_summary_context->frames = NULL;
+	tmp_summary_context->frames_size = 0;
+
+	return tmp_summary_context;
+}
+
+void xdebug_trace_summary_deinit(void *ctxt)
+{
+	xdebug_trace_summary_context *context = (xdebug_trace_summary_context*) ctxt;
+
+	xdebug_file_close(context->trace_file);
+	xdebug_file_dtor(context->trace_file);
+	context->trace_file = NULL;
+
+	xdebug_hash_destroy(context->functions);
+	if (context->frames) {
+		xdfree(context->frames);
+	}
+
+	xdfree(context);
+}
+
+void xdebug_trace_summary_write_header(void *ctxt)
+{
+	xdebug_trace_summary_context *context = (xdebug_trace_summary_context*) ctxt;
+	char *str_time;
+
+	str_time = xdebug_nanotime_to_chars(xdebug_get_nanotime(), 6);
+	xdebug_file_printf(context->trace_file, "TRACE START [%s]\n", str_time);
+	xdfree(str_time);
+
+	xdebug_file_flush(context->trace_file);
+}
+
+static void find_longest_name(void *user, xdebug_hash_element *he)
+{
+	size_t                        *max_len = (size_t*) user;
+	xdebug_trace_summary_function *function = (xdebug_trace_summary_function*) he->ptr;
+
+	if (function->calls && function->name_len > *max_len) {
+		*max_len = function->name_len;
+	}
+}
+
+static void add_padding(xdebug_str *str, char c, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		xdebug_str_addc(str, c);
+	}
+}
+
+static void add_function_line(void *user, xdebug_hash_element *he, void *argument)
+{
+	xdebug_str                    *str = (xdebug_str*) user;
+	size_t                         max_len = *(size_t*) argument;
+	xdebug_trace_summary_function *function = (xdebug_trace_summary_function*) he->ptr;
+
+	/* Such as xdebug_stop_trace(), which ends the trace before it returns */
+	if (!function->calls) {
+		return;
+	}
+
+	xdebug_str_addl(str, function->name, function->name_len, 0);
+	add_padding(str, ' ', max_len - function->name_len);
+	xdebug_str_add_fmt(
+		str, " %5lu  %3.4F %8ld  %3.4F %8ld\n",
+		function->calls,
+		function->time_inclusive / (double) NANOS_IN_SEC, (long) function->memory_inclusive,
+		function->time_own / (double) NANOS_IN_SEC, (long) function->memory_own
+	);
+}
+
+void xdebug_trace_summary_write_footer(void *ctxt)
+{
+	xdebug_trace_summary_context *context = (xdebug_trace_summary_context*) ctxt;
+	xdebug_str                    str = XDEBUG_STR_INITIALIZER;
+	char                         *str_time;
+	size_t                        max_len = 8; /* strlen("function") */
+
+	xdebug_hash_apply(context->functions, (void*) &max_len, find_longest_name);
+
+	/* The same table as contrib/tracefile-analyser.php shows */
+	add_padding(&str, ' ', max_len);
+	xdebug_str_add_literal(&str, "        Inclusive        Own\n");
+	xdebug_str_add_literal(&str, "function");
+	add_padding(&str, ' ', max_len - 8);
+	xdebug_str_add_literal(&str, "#calls  time     memory  time     memory\n");
+	add_padding(&str, '-', max_len);
+	xdebug_str_add_literal(&str, "----------------------------------------\n");
+
+	xdebug_hash_apply_with_argument(context->functions, (void*) &str, add_function_line, (void*) &max_len);
+
+	xdebug_file_write(str.d, 1, str.l, context->trace_file);
+	xdebug_str_destroy(&str);
+
+	str_time = xdebug_nanotime_to_chars(xdebug_get_nanotime(), 6);
+	xdebug_file_printf(context->trace_file, "TRACE END   [%s]\n\n", str_time);
+	xdfree(str_time);
+
+	xdebug_file_flush(context->trace_file);
+}
+
+char *xdebug_trace_summary_get_filename(void *ctxt)
+{
+	xdebug_trace_summary_context *context = (xdebug_trace_summary_context*) ctxt;
+
+	return context->trace_file->name;
+}
+
+void xdebug_trace_summary_function_entry(void *ctxt, function_stack_entry *fse, int function_nr)
+{
+	xdebug_trace_summary_context  *context = (xdebug_trace_summary_context*) ctxt;
+	xdebug_function_identity      *fi;
+	xdebug_trace_summary_function *function;
+
+	fi = xdebug_function_identity_for_frame(fse);
+
+	if (!xdebug_hash_find(context->functions, fi->name, fi->name_len, (void*) &function)) {
+		function = xdcalloc(1, sizeof(xdebug_trace_summary_function));
+		function->name = xdstrndup(fi->name, fi->name_len);
+		function->name_len = fi->name_len;
+
+		xdebug_hash_add(context->functions, fi->name, fi->name_len, (void*) function);
+	}
+
+	if (fse->level >= context->frames_size) {
+		unsigned int old_size = context->frames_size;
+
+		context->frames_size = fse->level + 32;
+		context->frames = xdrealloc(context->frames, context->frames_size * sizeof(xdebug_trace_summary_frame));
+		memset(context->frames + old_size, 0, (context->frames_size - old_size) * sizeof(xdebug_trace_summary_frame));
+	}
+
+	context->frames[fse->level].function = function;
+	context->frames[fse->level].time_children = 0;
+	context->frames[fse->level].memory_children = 0;
+
+	function->active++;
+}
+
+void xdebug_trace_summary_function_exit(void *ctxt, function_stack_entry *fse, int function_nr)
+{
+	xdebug_trace_summary_context  *context = (xdebug_trace_summary_context*) ctxt;
+	xdebug_trace_summary_frame    *frame;
+	xdebug_trace_summary_function *function;
+	uint64_t                       time_inclusive;
+	int64_t                        memory_inclusive;
+
+	/* Calls that started before the trace did have no frame */
+	if (fse->level >= context->frames_size || !context->frames[fse->level].function) {
+		return;
+	}
+
+	frame = &context->frames[fse->level];
+	function = frame->function;
+
+	time_inclusive = xdebug_get_nanotime() - fse->nanotime;
+	memory_inclusive = (int64_t) zend_memory_usage(0) - (int64_t) fse->memory;
+
+	function->calls++;
+	function->active--;
+	function->time_own += time_inclusive - frame->time_children;
+	function->memory_own += memory_inclusive - frame->memory_children;
+	if (function->active == 0) {
+		function->time_inclusive += time_inclusive;
+		function->memory_inclusive += memory_inclusive;
+	}
+
+	if (fse->level > 0) {
+		context->frames[fse->level - 1].time_children += time_inclusive;
+		context->frames[fse->level - 1].memory_children += memory_inclusive;
+	}
+
+	frame->function = NULL;
+}
+
+void xdebug_trace_summary_flush(void *ctxt)
+{
+	xdebug_trace_summary_context *context = (xdebug_trace_summary_context*) ctxt;
+
+	xdebug_file_flush(context->trace_file);
+}
+
+xdebug_trace_handler_t xdebug_trace_handler_summary =
+{
+	xdebug_trace_summary_init,
+	xdebug_trace_summary_deinit,
+	xdebug_trace_summary_write_header,
+	xdebug_trace_summary_write_footer,
+	xdebug_trace_summary_get_filename,
+	xdebug_trace_summary_function_entry,
+	xdebug_trace_summary_function_exit,
+	NULL /* xdebug_trace_summary_function_return_value */,
+	NULL /* xdebug_trace_summary_generator_return_value */,
+	NULL /* xdebug_trace_summary_assignment */,
+	xdebug_trace_summary_flush
+};
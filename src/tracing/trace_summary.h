@@ -0,0 +1,51 @@
+/*
+   +----------------------------------------------------------------------+
+   | Xdebug                                                               |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2002-2022 Derick Rethans                               |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 1.01 of the Xdebug license,   |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available at through the world-wide-web at                           |
+   | https://xdebug.org/license.php                                       |
+   | If you did not receive a copy of the Xdebug license and are unable   |
+   | to obtain it through the world-wide-web, please send a note to       |
+   | derick@xdebug.org so we can mail you a copy immediately.             |
+   +----------------------------------------------------------------------+
+ */
+#ifndef XDEBUG_TRACE_SUMMARY_H
+#define XDEBUG_TRACE_SUMMARY_H
+
+#include "tracing_private.h"
+#include "lib/hash.h"
+
+typedef struct _xdebug_trace_summary_function
+{
+	char          *name;
+	size_t         name_len;
+	unsigned long  calls;
+	unsigned int   active; /* the number of calls that are on the stack */
+	uint64_t       time_inclusive;
+	uint64_t       time_own;
+	int64_t        memory_inclusive;
+	int64_t        memory_own;
+} xdebug_trace_summary_function;
+
+/* Collects the cost of the children of a frame that is on the stack */
+typedef struct _xdebug_trace_summary_frame
+{
+	xdebug_trace_summary_function *function;
+	uint64_t                       time_children;
+	int64_t                        memory_children;
+} xdebug_trace_summary_frame;
+
+typedef struct _xdebug_trace_summary_context
+{
+	xdebug_file                *trace_file;
+	xdebug_hash                *functions;
+	xdebug_trace_summary_frame *frames; /* indexed by level */
+	unsigned int                frames_size;
+} xdebug_trace_summary_context;
+
+extern xdebug_trace_handler_t xdebug_trace_handler_summary;
+#endif
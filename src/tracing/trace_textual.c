@@ -20,6 +20,7 @@
 #include "tracing_private.h"
 #include "trace_textual.h"
 
+#include "base/function_identity.h"
 #include "lib/lib_private.h"
 #include "lib/var_export_line.h"
 
@@ -37,6 +38,11 @@ void *xdebug_trace_textual_init(char *fname, zend_string *script_filename, long
 		return NULL;
 	}
 
+	/* Read once, instead of for every value that is written, and only read
+	 * again when the settings are changed during the trace */
+	tmp_textual_context->export_options = xdebug_var_export_options_from_ini();
+	tmp_textual_context->export_options_generation = XG_LIB(var_display_generation);
+
 	return tmp_textual_context;
 }
 
@@ -48,6 +54,9 @@ void xdebug_trace_textual_deinit(void *ctxt)
 	xdebug_file_dtor(context->trace_file);
 	context->trace_file = NULL;
 
+	xdfree(context->export_options->runtime);
+	xdfree(context->export_options);
+
 	xdfree(context);
 }
 
@@ -91,21 +100,7 @@ char *xdebug_trace_textual_get_filename(void *ctxt)
 	return context->trace_file->name;
 }
 
-static void add_single_value(xdebug_str *str, zval *zv)
-{
-	xdebug_str *tmp_value = NULL;
-
-	tmp_value = xdebug_get_zval_value_line(zv, 0, NULL);
-
-	if (tmp_value) {
-		xdebug_str_add_str(str, tmp_value);
-		xdebug_str_free(tmp_value);
-	} else {
-		xdebug_str_add_literal(str, "???");
-	}
-}
-
-static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse)
+static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse, xdebug_var_export_options *options)
 {
 	unsigned int j = 0; /* Counter */
 	int c = 0; /* Comma flag */
@@ -153,7 +148,7 @@ static void add_arguments(xdebug_str *line_entry, function_stack_entry *fse)
 		}
 
 		if (!Z_ISUNDEF(fse->var[j].data)) {
-			add_single_value(line_entry, &fse->var[j].data);
+			xdebug_add_zval_value_line(line_entry, &fse->var[j].data, 0, options);
 		} else {
 			xdebug_str_add_literal(line_entry, "???");
 		}
@@ -168,21 +163,22 @@ void xdebug_trace_textual_function_entry(void *ctxt, function_stack_entry *fse,
 {
 	xdebug_trace_textual_context *context = (xdebug_trace_textual_context*) ctxt;
 	unsigned int j = 0; /* Counter */
-	char *tmp_name;
+	xdebug_function_identity *fi;
 	xdebug_str str = XDEBUG_STR_INITIALIZER;
 
-	tmp_name = xdebug_show_fname(fse->function, XDEBUG_SHOW_FNAME_DEFAULT);
+	fi = xdebug_function_identity_for_frame(fse);
 
 	xdebug_str_add_fmt(&str, "%10.4F ", XDEBUG_SECONDS_SINCE_START(fse->nanotime));
 	xdebug_str_add_fmt(&str, "%10lu ", fse->memory);
 	for (j = 0; j < fse->level; j++) {
 		xdebug_str_add_literal(&str, "  ");
 	}
-	xdebug_str_add_fmt(&str, "-> %s(", tmp_name);
-
-	xdfree(tmp_name);
+	xdebug_str_add_literal(&str, "-> ");
+	xdebug_str_addl(&str, fi->name, fi->name_len, 0);
+	xdebug_str_addc(&str, '(');
 
-	add_arguments(&str, fse);
+	xdebug_var_export_options_refresh_from_ini(&context->export_options, &context->export_options_generation);
+	add_arguments(&str, fse, context->export_options);
 
 	if (fse->include_filename) {
 		if (fse->function.type == XFUNC_EVAL) {
@@ -202,7 +198,7 @@ void xdebug_trace_textual_function_entry(void *ctxt, function_stack_entry *fse,
 	xdebug_str_add_fmt(&str, ") %s:%d\n", ZSTR_VAL(fse->filename), fse->lineno);
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 
 	xdfree(str.d);
 }
@@ -226,19 +222,15 @@ void xdebug_trace_textual_function_return_value(void *ctxt, function_stack_entry
 {
 	xdebug_trace_textual_context *context = (xdebug_trace_textual_context*) ctxt;
 	xdebug_str                    str = XDEBUG_STR_INITIALIZER;
-	xdebug_str                   *tmp_value;
 
 	xdebug_return_trace_stack_common(&str, fse);
 
-	tmp_value = xdebug_get_zval_value_line(return_value, 0, NULL);
-	if (tmp_value) {
-		xdebug_str_add_str(&str, tmp_value);
-		xdebug_str_free(tmp_value);
-	}
+	xdebug_var_export_options_refresh_from_ini(&context->export_options, &context->export_options_generation);
+	xdebug_add_zval_value_line(&str, return_value, 0, context->export_options);
 	xdebug_str_addc(&str, '\n');
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 
 	xdebug_str_destroy(&str);
 }
@@ -278,7 +270,7 @@ void xdebug_trace_textual_generator_return_value(void *ctxt, function_stack_entr
 	xdebug_str_add_literal(&str, ")\n");
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 
 	xdebug_str_destroy(&str);
 }
@@ -320,11 +312,18 @@ void xdebug_trace_textual_assignment(void *ctxt, function_stack_entry *fse, char
 	xdebug_str_add_fmt(&str, " %s:%d\n", filename, lineno);
 
 	xdebug_file_printf(context->trace_file, "%s", str.d);
-	xdebug_file_flush(context->trace_file);
+	xdebug_trace_flush_record(context->trace_file);
 
 	xdfree(str.d);
 }
 
+void xdebug_trace_textual_flush(void *ctxt)
+{
+	xdebug_trace_textual_context *context = (xdebug_trace_textual_context*) ctxt;
+
+	xdebug_file_flush(context->trace_file);
+}
+
 xdebug_trace_handler_t xdebug_trace_handler_textual =
 {
 	xdebug_trace_textual_init,
@@ -336,5 +335,6 @@ xdebug_trace_handler_t xdebug_trace_handler_textual =
 	NULL /*xdebug_trace_textual_function_exit */,
 	xdebug_trace_textual_function_return_value,
 	xdebug_trace_textual_generator_return_value,
-	xdebug_trace_textual_assignment
+	xdebug_trace_textual_assignment,
+	xdebug_trace_textual_flush
 };
@@ -17,10 +17,13 @@
 #define XDEBUG_TRACE_TEXTUAL_H
 
 #include "tracing_private.h"
+#include "lib/var.h"
 
 typedef struct _xdebug_trace_textual_context
 {
 	xdebug_file *trace_file;
+	xdebug_var_export_options *export_options;
+	unsigned int               export_options_generation;
 } xdebug_trace_textual_context;
 
 extern xdebug_trace_handler_t xdebug_trace_handler_textual;
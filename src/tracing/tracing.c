@@ -21,6 +21,8 @@
 #include "trace_textual.h"
 #include "trace_computerized.h"
 #include "trace_html.h"
+#include "trace_binary.h"
+#include "trace_summary.h"
 
 #include "lib/compat.h"
 #include "lib/log.h"
@@ -37,6 +39,8 @@ static xdebug_trace_handler_t *xdebug_select_trace_handler(int options)
 		case 0: tmp = &xdebug_trace_handler_textual; break;
 		case 1: tmp = &xdebug_trace_handler_computerized; break;
 		case 2: tmp = &xdebug_trace_handler_html; break;
+		case 3: tmp = &xdebug_trace_handler_binary; break;
+		case 4: tmp = &xdebug_trace_handler_summary; break;
 		default:
 			php_error(E_NOTICE, "A wrong value for xdebug.trace_format was selected (%d), defaulting to the textual format", (int) XINI_TRACE(trace_format));
 			tmp = &xdebug_trace_handler_textual; break;
@@ -85,13 +89,16 @@ xdebug_file *xdebug_trace_open_file(char *requested_filename, zend_string *scrip
 		}
 	}
 
-	if (!xdebug_file_open(
+	if (!xdebug_file_open_output(
 		file,
 		filename_to_use,
 		(options & XDEBUG_TRACE_OPTION_NAKED_FILENAME) ? NULL : "xt",
-		(options & XDEBUG_TRACE_OPTION_APPEND) ? "ab" : "wb"
+		(options & XDEBUG_TRACE_OPTION_APPEND) ? "ab" : "wb",
+		1
 	)) {
 		xdebug_log_diagnose_permissions(XLOG_CHAN_TRACE, output_dir, generated_filename);
+	} else if (XINI_TRACE(trace_buffer_size) > 0) {
+		xdebug_file_set_buffer_size(file, XINI_TRACE(trace_buffer_size));
 	}
 
 	if (generated_filename) {
@@ -102,6 +109,22 @@ xdebug_file *xdebug_trace_open_file(char *requested_filename, zend_string *scrip
 	return file;
 }
 
+/* Called by the trace handlers after writing each record. Without a buffer,
+ * the record is flushed right away, so that it survives a crash. */
+void xdebug_trace_flush_record(xdebug_file *file)
+{
+	if (!file->buffer_size) {
+		xdebug_file_flush(file);
+	}
+}
+
+static void xdebug_flush_trace(void)
+{
+	if (XG_TRACE(trace_context) && XG_TRACE(trace_handler)->flush) {
+		XG_TRACE(trace_handler)->flush(XG_TRACE(trace_context));
+	}
+}
+
 static char* xdebug_start_trace(char* fname, zend_string *script_filename, long options)
 {
 	if (XG_TRACE(trace_context)) {
@@ -192,6 +215,19 @@ PHP_FUNCTION(xdebug_stop_trace)
 	xdebug_stop_trace();
 }
 
+PHP_FUNCTION(xdebug_flush_trace)
+{
+	WARN_AND_RETURN_IF_MODE_IS_NOT(XDEBUG_MODE_TRACING);
+
+	if (!XG_TRACE(trace_context)) {
+		RETURN_FALSE;
+	}
+
+	xdebug_flush_trace();
+
+	RETURN_TRUE;
+}
+
 PHP_FUNCTION(xdebug_get_tracefile_name)
 {
 	char *filename;
@@ -657,6 +693,7 @@ void xdebug_tracing_register_constants(INIT_FUNC_ARGS)
 	REGISTER_LONG_CONSTANT("XDEBUG_TRACE_COMPUTERIZED", XDEBUG_TRACE_OPTION_COMPUTERIZED, CONST_CS | CONST_PERSISTENT);
 	REGISTER_LONG_CONSTANT("XDEBUG_TRACE_HTML", XDEBUG_TRACE_OPTION_HTML, CONST_CS | CONST_PERSISTENT);
 	REGISTER_LONG_CONSTANT("XDEBUG_TRACE_NAKED_FILENAME", XDEBUG_TRACE_OPTION_NAKED_FILENAME, CONST_CS | CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("XDEBUG_TRACE_CPU_TIME", XDEBUG_TRACE_OPTION_CPU_TIME, CONST_CS | CONST_PERSISTENT);
 }
 
 void xdebug_tracing_rinit(void)
@@ -674,6 +711,27 @@ void xdebug_tracing_post_deactivate(void)
 	XG_TRACE(trace_context) = NULL;
 }
 
+/* Without xdebug.trace_buffer_size every record is flushed right away, and
+ * there is nothing for xdebug_tracing_error_cb() to do */
+int xdebug_tracing_buffers_records(void)
+{
+	return XINI_TRACE(trace_buffer_size) > 0;
+}
+
+/* Writes out the buffered trace records before PHP bails out on a fatal error */
+void xdebug_tracing_error_cb(int type)
+{
+	switch (type) {
+		case E_ERROR:
+		case E_CORE_ERROR:
+		case E_COMPILE_ERROR:
+		case E_USER_ERROR:
+		case E_PARSE:
+			xdebug_flush_trace();
+			break;
+	}
+}
+
 void xdebug_tracing_init_if_requested(zend_op_array *op_array)
 {
 	if (xdebug_lib_start_with_request(XDEBUG_MODE_TRACING) || xdebug_lib_start_with_trigger(XDEBUG_MODE_TRACING, NULL)) {
@@ -35,6 +35,7 @@ typedef struct
 	void (*return_value)(void *ctxt, function_stack_entry *fse, int function_nr, zval *return_value);
 	void (*generator_return_value)(void *ctxt, function_stack_entry *fse, int function_nr, zend_generator *generator);
 	void (*assignment)(void *ctxt, function_stack_entry *fse, char *full_varname, zval *value, char *right_full_varname, const char *op, char *file, int lineno);
+	void (*flush)(void *ctxt);
 } xdebug_trace_handler_t;
 
 typedef struct _xdebug_tracing_globals_t {
@@ -46,6 +47,7 @@ typedef struct _xdebug_tracing_settings_t {
 	char         *trace_output_name;
 	zend_long     trace_options;
 	zend_long     trace_format;
+	zend_long     trace_buffer_size;
 
 	zend_bool     collect_assignments;
 	zend_bool     collect_return;
@@ -55,6 +57,8 @@ void xdebug_init_tracing_globals(xdebug_tracing_globals_t *xg);
 void xdebug_tracing_minit(INIT_FUNC_ARGS);
 void xdebug_tracing_rinit(void);
 void xdebug_tracing_post_deactivate(void);
+int xdebug_tracing_buffers_records(void);
+void xdebug_tracing_error_cb(int type);
 void xdebug_tracing_register_constants(INIT_FUNC_ARGS);
 
 void xdebug_tracing_init_if_requested(zend_op_array *op_array);
@@ -61,5 +61,6 @@ int xdebug_post_inc_static_prop_handler(zend_execute_data *execute_data);
 int xdebug_post_dec_static_prop_handler(zend_execute_data *execute_data);
 
 xdebug_file *xdebug_trace_open_file(char *fname, zend_string *script_filename, long options);
+void xdebug_trace_flush_record(xdebug_file *file);
 
 #endif
@@ -0,0 +1,69 @@
+--TEST--
+Code coverage: analysis results with xdebug.coverage_cache_dir are read back by other processes (!opcache)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!opcache; !win');
+?>
+--FILE--
+<?php
+function cache_dir()
+{
+	$dir = sys_get_temp_dir() . '/' . uniqid('xdebug-cc', true);
+	mkdir($dir);
+
+	return $dir;
+}
+
+function run($dir, $restarts)
+{
+	$php = getenv('TEST_PHP_EXECUTABLE') . ' -d xdebug.mode=coverage';
+
+	return trim(`$php -d xdebug.coverage_cache_dir=$dir ` . escapeshellarg(__DIR__ . '/coverage-analysis-cache-002.inc') . " $restarts");
+}
+
+function cache_files($dir)
+{
+	clearstatcache();
+
+	$files = [];
+	foreach (glob("$dir/xdebug-cc.*") as $file) {
+		$files[basename($file)] = [ fileinode($file), filesize($file) ];
+	}
+	ksort($files);
+
+	return $files;
+}
+
+function sizes($files)
+{
+	return array_map(function($file) { return $file[1]; }, $files);
+}
+
+/* Restarting code coverage in a request does not add the same records again */
+$once = cache_dir();
+run($once, 1);
+
+$restarted = cache_dir();
+$first = run($restarted, 3);
+$files = cache_files($restarted);
+
+echo count($files), "\n";
+var_dump(sizes($files) === sizes(cache_files($once)));
+
+/* A second process finds all records, and so does not write the files again */
+$second = run($restarted, 3);
+
+var_dump($files === cache_files($restarted));
+var_dump($first === $second);
+
+foreach ([$once, $restarted] as $dir) {
+	array_map('unlink', glob("$dir/*"));
+	rmdir($dir);
+}
+?>
+--EXPECT--
+1
+bool(true)
+bool(true)
+bool(true)
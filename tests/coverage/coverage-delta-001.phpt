@@ -0,0 +1,64 @@
+--TEST--
+Code coverage: xdebug_get_code_coverage_delta() (!opcache)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!opcache');
+?>
+--INI--
+xdebug.mode=coverage
+--FILE--
+<?php
+function show($delta)
+{
+	foreach ($delta as $file => $lines) {
+		if (basename($file) === 'coverage-delta-001.inc') {
+			var_dump($lines);
+		}
+	}
+	echo "--\n";
+}
+
+include 'coverage-delta-001.inc';
+
+xdebug_start_code_coverage();
+
+a();
+$d1 = xdebug_get_code_coverage_delta();
+
+b(true);
+$d2 = xdebug_get_code_coverage_delta();
+
+$d3 = xdebug_get_code_coverage_delta();
+
+a();
+$d4 = xdebug_get_code_coverage_delta();
+
+xdebug_stop_code_coverage();
+
+show($d1);
+show($d2);
+show($d3);
+show($d4);
+?>
+--EXPECT--
+array(1) {
+  [4]=>
+  int(1)
+}
+--
+array(3) {
+  [7]=>
+  int(1)
+  [9]=>
+  int(1)
+  [10]=>
+  int(1)
+}
+--
+--
+array(1) {
+  [4]=>
+  int(1)
+}
+--
@@ -0,0 +1,93 @@
+--TEST--
+Code coverage: XDEBUG_CC_HIT_COUNT (!opcache)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!opcache');
+?>
+--INI--
+xdebug.mode=coverage
+--FILE--
+<?php
+function run()
+{
+	a(); a(); a();
+	b(true); b(true); b(false);
+}
+
+function show($coverage)
+{
+	foreach ($coverage as $file => $info) {
+		if (basename($file) !== 'coverage-hit-count-001.inc') {
+			continue;
+		}
+
+		if (!isset($info['functions'])) {
+			var_dump($info);
+			continue;
+		}
+
+		var_dump($info['lines']);
+
+		$lineStarts = [];
+		foreach ($info['functions']['b']['branches'] as $opStart => $branch) {
+			$lineStarts[$opStart] = $branch['line_start'];
+			if (in_array($branch['line_start'], [7, 10, 12])) {
+				echo "branch at line {$branch['line_start']}: {$branch['hit']}\n";
+			}
+		}
+		foreach ($info['functions']['b']['paths'] as $path) {
+			if ($path['hit']) {
+				$lines = array_map(function ($op) use ($lineStarts) { return $lineStarts[$op]; }, $path['path']);
+				echo "path through lines ", implode(', ', $lines), ": {$path['hit']}\n";
+			}
+		}
+	}
+}
+
+include 'coverage-hit-count-001.inc';
+
+xdebug_start_code_coverage(XDEBUG_CC_HIT_COUNT);
+run();
+show(xdebug_get_code_coverage());
+xdebug_stop_code_coverage();
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED | XDEBUG_CC_BRANCH_CHECK | XDEBUG_CC_HIT_COUNT);
+run();
+show(xdebug_get_code_coverage());
+xdebug_stop_code_coverage();
+?>
+--EXPECT--
+array(5) {
+  [4]=>
+  int(3)
+  [7]=>
+  int(3)
+  [9]=>
+  int(3)
+  [10]=>
+  int(2)
+  [12]=>
+  int(1)
+}
+array(7) {
+  [4]=>
+  int(3)
+  [5]=>
+  int(-1)
+  [7]=>
+  int(3)
+  [9]=>
+  int(3)
+  [10]=>
+  int(2)
+  [12]=>
+  int(1)
+  [13]=>
+  int(-1)
+}
+branch at line 7: 3
+branch at line 10: 2
+branch at line 12: 1
+path through lines 7, 10: 2
+path through lines 7, 12: 1
@@ -0,0 +1,51 @@
+--TEST--
+Code coverage: coverage of forked children with xdebug.coverage_merge_forks=1 (!opcache)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!opcache; !win; ext pcntl');
+?>
+--INI--
+xdebug.mode=coverage
+xdebug.coverage_merge_forks=1
+xdebug.output_dir={TMP}
+xdebug.use_compression=0
+--FILE--
+<?php
+include 'coverage-delta-001.inc';
+
+xdebug_start_code_coverage();
+
+$pid = pcntl_fork();
+if ($pid === 0) {
+	b(false);
+	exit();
+}
+pcntl_waitpid($pid, $status);
+
+a();
+
+$cc = xdebug_get_code_coverage();
+xdebug_stop_code_coverage();
+
+foreach ($cc as $file => $lines) {
+	if (basename($file) === 'coverage-delta-001.inc') {
+		var_dump($lines);
+	}
+}
+
+var_dump(glob(sys_get_temp_dir() . '/xdebug-coverage.' . getmypid() . '.*'));
+?>
+--EXPECT--
+array(4) {
+  [4]=>
+  int(1)
+  [7]=>
+  int(1)
+  [9]=>
+  int(1)
+  [12]=>
+  int(1)
+}
+array(0) {
+}
@@ -0,0 +1,31 @@
+--TEST--
+Code coverage: hits from destroyed op_arrays are kept
+--INI--
+xdebug.mode=coverage
+--FILE--
+<?php
+xdebug_start_code_coverage();
+
+for ($i = 0; $i < 3; $i++) {
+	eval('$a = 1;' . str_repeat("\n", $i) . '$b = 2;');
+}
+
+$cc = xdebug_get_code_coverage();
+xdebug_stop_code_coverage();
+
+foreach ($cc as $file => $lines) {
+	if (strpos($file, "eval()'d code") !== false) {
+		ksort($lines);
+		var_dump($lines);
+	}
+}
+?>
+--EXPECT--
+array(3) {
+  [1]=>
+  int(1)
+  [2]=>
+  int(1)
+  [3]=>
+  int(1)
+}
@@ -0,0 +1,40 @@
+--TEST--
+Code coverage: xdebug.coverage_path_limit
+--INI--
+xdebug.mode=coverage
+xdebug.coverage_path_limit=16
+--FILE--
+<?php
+function three($a)
+{
+	if ($a & 1) { echo '1'; }
+	if ($a & 2) { echo '2'; }
+	if ($a & 4) { echo '4'; }
+}
+
+function five($a)
+{
+	if ($a & 1) { echo '1'; }
+	if ($a & 2) { echo '2'; }
+	if ($a & 4) { echo '4'; }
+	if ($a & 8) { echo '8'; }
+	if ($a & 16) { echo '16'; }
+}
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED | XDEBUG_CC_DEAD_CODE | XDEBUG_CC_BRANCH_CHECK);
+three(5);
+five(31);
+echo "\n";
+$coverage = xdebug_get_code_coverage();
+xdebug_stop_code_coverage();
+
+foreach (['three', 'five'] as $function) {
+	$info = $coverage[__FILE__]['functions'][$function];
+	echo $function, ': ', count($info['paths']), ' paths, ';
+	echo isset($info['path_limit_reached']) ? 'limit reached' : 'complete', "\n";
+}
+?>
+--EXPECT--
+14124816
+three: 8 paths, complete
+five: 16 paths, limit reached
@@ -0,0 +1,38 @@
+--TEST--
+Code coverage: xdebug.coverage_path_limit with loops stops finding paths at the limit
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!win');
+?>
+--FILE--
+<?php
+function run($limit)
+{
+	$php = getenv('TEST_PHP_EXECUTABLE') . " -d xdebug.mode=coverage -d xdebug.coverage_path_limit=$limit";
+
+	return json_decode(`$php ` . escapeshellarg(__DIR__ . '/coverage-path-limit-002.inc'), true);
+}
+
+$all = run(0);
+$limited = run(8);
+
+echo 'without limit: ', count($all['paths']) > 8 ? 'more than 8 paths' : 'too few paths', ', ';
+echo $all['limit_reached'] ? 'limit reached' : 'complete', "\n";
+
+echo 'with limit: ', count($limited['paths']), ' paths, ';
+echo $limited['limit_reached'] ? 'limit reached' : 'complete', "\n";
+
+/* Paths are found in the same order, so the limit keeps the first ones */
+var_dump($limited['paths'] === array_slice($all['paths'], 0, 8));
+
+/* Every path starts at the entry point, and none is collected twice */
+var_dump(count(array_filter($all['paths'], function($path) { return $path[0] !== 0; })));
+var_dump(count(array_unique(array_map('json_encode', $all['paths']))) === count($all['paths']));
+?>
+--EXPECT--
+without limit: more than 8 paths, complete
+with limit: 8 paths, limit reached
+bool(true)
+int(0)
+bool(true)
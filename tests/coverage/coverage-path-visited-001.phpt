@@ -0,0 +1,74 @@
+--TEST--
+Code coverage: paths of nested and repeated function calls are collected per call
+--INI--
+xdebug.mode=coverage
+--FILE--
+<?php
+function choose($a)
+{
+	if ($a) {
+		echo 'a';
+	} else {
+		echo 'b';
+	}
+}
+
+function twice()
+{
+	/* Both calls run at the same stack level, one after the other */
+	choose(true);
+	choose(false);
+}
+
+function countdown($n)
+{
+	if ($n > 0) {
+		countdown($n - 1);
+	}
+	echo $n;
+}
+
+function loop($n)
+{
+	/* Every call runs at the same stack level as the one before it */
+	for ($i = 0; $i < $n; $i++) {
+		choose($i & 1);
+	}
+}
+
+function report($coverage, $functions)
+{
+	foreach ($functions as $function) {
+		$paths = $coverage[__FILE__]['functions'][$function]['paths'];
+		$hit = array_filter($paths, function($path) { return $path['hit']; });
+
+		echo $function, ': ', count($paths), ' paths, ', count($hit), " hit\n";
+	}
+}
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED | XDEBUG_CC_DEAD_CODE | XDEBUG_CC_BRANCH_CHECK);
+twice();
+echo "\n";
+report(xdebug_get_code_coverage(), ['choose', 'twice']);
+xdebug_stop_code_coverage();
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED | XDEBUG_CC_DEAD_CODE | XDEBUG_CC_BRANCH_CHECK);
+countdown(2);
+echo "\n";
+report(xdebug_get_code_coverage(), ['countdown']);
+xdebug_stop_code_coverage();
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED | XDEBUG_CC_DEAD_CODE | XDEBUG_CC_BRANCH_CHECK);
+loop(2);
+echo "\n";
+report(xdebug_get_code_coverage(), ['choose']);
+xdebug_stop_code_coverage();
+?>
+--EXPECT--
+ab
+choose: 2 paths, 2 hit
+twice: 1 paths, 1 hit
+012
+countdown: 2 paths, 2 hit
+ba
+choose: 2 paths, 2 hit
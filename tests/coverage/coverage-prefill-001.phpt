@@ -0,0 +1,36 @@
+--TEST--
+Code coverage: unused functions declared at runtime and in eval()'d code (!opcache)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!opcache');
+?>
+--INI--
+xdebug.mode=coverage
+--FILE--
+<?php
+function nothing()
+{
+}
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED);
+
+include 'coverage-prefill-001.inc';
+eval("\nfunction from_eval()\n{\n\treturn 42;\n}\n");
+nothing();
+
+$coverage = xdebug_get_code_coverage();
+xdebug_stop_code_coverage();
+
+foreach ($coverage as $file => $lines) {
+	if (basename($file) === 'coverage-prefill-001.inc') {
+		echo "conditional(): ", $lines[5], ' ', $lines[6], "\n";
+	}
+	if (strpos($file, "eval()'d code") !== false) {
+		echo "from_eval(): ", $lines[4], ' ', $lines[5], "\n";
+	}
+}
+?>
+--EXPECT--
+conditional(): -1 -1
+from_eval(): -1 -1
@@ -0,0 +1,51 @@
+--TEST--
+Code coverage: xdebug_dump_code_coverage() with branch check (!opcache)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!opcache');
+?>
+--INI--
+xdebug.mode=coverage
+xdebug.use_compression=0
+--FILE--
+<?php
+require dirname( __FILE__ ) . '/../../contrib/coverage-reader.php';
+
+xdebug_start_code_coverage(XDEBUG_CC_UNUSED | XDEBUG_CC_DEAD_CODE | XDEBUG_CC_BRANCH_CHECK);
+
+include 'bug01195.inc';
+
+xdebug_stop_code_coverage(false);
+
+$filename = xdebug_dump_code_coverage(sys_get_temp_dir() . '/dump-code-coverage-001.txt');
+$c = xdebug_get_code_coverage();
+
+echo file_get_contents($filename);
+var_dump(xdebug_read_code_coverage($filename) === $c);
+
+unlink($filename);
+?>
+--EXPECTF--
+foo
+foo
+foo
+the end
+version: 1
+creator: xdebug %s (PHP %s)
+branch_check: 1
+
+%Afile %sbug01195.inc
+line 2 1
+%Afunction fe
+branch 0 2 2 4 1 0:3:1 1:7:0
+branch 3 3 4 4 1 0:4:1 1:7:1
+branch 4 6 6 4 1 0:3:1
+branch 7 11 4 9 1 0:2147483645:0
+path 1 0 3 4 3 7
+path 0 0 3 7
+path 0 0 7
+function {main}
+branch 0 4 11 13 1 0:2147483645:0
+path 1 0
+%Abool(true)
@@ -0,0 +1,79 @@
+--TEST--
+Profiler: aggregated calls (xdebug.profiler_aggregate_calls=1)
+--INI--
+xdebug.mode=profile
+xdebug.start_with_request=default
+xdebug.profiler_aggregate_calls=1
+--FILE--
+<?php
+require_once 'capture-profile.inc';
+
+function foo($a) {
+	return str_repeat($a, 2);
+}
+
+for ($i = 0; $i < 5; $i++) {
+	foo("test");
+}
+foo("once more");
+
+exit();
+?>
+--EXPECTF--
+version: 1
+creator: xdebug %d.%s (PHP %s)
+cmd: %sprofiler_aggregate_calls-001.php
+part: 1
+positions: line
+
+events: Time_(10ns) Memory_(bytes)
+
+fl=(1) php:internal
+fn=(1) php::xdebug_get_profiler_filename
+2 %d %d
+
+fl=(2) %scapture-profile.inc
+fn=(2) require_once::%scapture-profile.inc
+1 %d %d
+cfl=(1)
+cfn=(1)
+calls=1 0 0
+2 %d %d
+cfl=(1)
+cfn=(3) php::register_shutdown_function
+calls=1 0 0
+16 %d %d
+
+fl=(1)
+fn=(3)
+16 %d %d
+
+fl=(3) %sprofiler_aggregate_calls-001.php
+fn=(4) {main}
+1 %d %d
+cfl=(2)
+cfn=(2)
+calls=1 0 0
+2 %d %d
+cfl=(3)
+cfn=(5) foo
+calls=5 0 0
+9 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+11 %d %d
+
+fl=(1)
+fn=(6) php::str_repeat
+5 %d %d
+
+fl=(3)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(6)
+calls=6 0 0
+5 %d %d
+
+summary: %d %d
@@ -0,0 +1,87 @@
+--TEST--
+Profiler: merging requests (xdebug.profiler_aggregate_requests=1)
+--INI--
+xdebug.mode=profile
+xdebug.start_with_request=default
+xdebug.use_compression=0
+xdebug.profiler_output_name=cachegrind.out.merged.%p
+xdebug.profiler_aggregate_requests=1
+--FILE--
+<?php
+var_dump(xdebug_get_profiler_filename());
+
+function foo($a) {
+	return str_repeat($a, 2);
+}
+
+function capture()
+{
+	$filename = ini_get('xdebug.output_dir') . '/cachegrind.out.merged.' . getmypid();
+
+	echo file_get_contents($filename);
+	unlink($filename);
+}
+register_shutdown_function('capture');
+
+for ($i = 0; $i < 3; $i++) {
+	foo("test");
+}
+
+exit();
+?>
+--EXPECTF--
+bool(false)
+version: 1
+creator: xdebug %d.%s (PHP %s)
+cmd: %sprofiler_aggregate_requests-001.php
+desc: Requests: 1
+part: 1
+positions: line
+
+events: Time_(10ns) Memory_(bytes)
+
+fl=(1) php:internal
+fn=(1) php::xdebug_get_profiler_filename
+2 %d %d
+
+fl=(2) %sprofiler_aggregate_requests-001.php
+fn=(2) {main}
+1 %d %d
+cfl=(1)
+cfn=(1)
+calls=1 0 0
+2 %d %d
+cfl=(1)
+cfn=(3) php::var_dump
+calls=1 0 0
+2 %d %d
+cfl=(1)
+cfn=(4) php::register_shutdown_function
+calls=1 0 0
+15 %d %d
+cfl=(2)
+cfn=(5) foo
+calls=3 0 0
+18 %d %d
+
+fl=(1)
+fn=(3)
+2 %d %d
+
+fl=(1)
+fn=(4)
+15 %d %d
+
+fl=(1)
+fn=(6) php::str_repeat
+5 %d %d
+
+fl=(2)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(6)
+calls=3 0 0
+5 %d %d
+
+summary: %d %d
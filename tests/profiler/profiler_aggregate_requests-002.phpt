@@ -0,0 +1,74 @@
+--TEST--
+Profiler: merging requests keeps the {main} of different scripts apart
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!win');
+?>
+--FILE--
+<?php
+$dir = sys_get_temp_dir() . '/' . uniqid('xdebug-merged', true);
+mkdir($dir);
+
+file_put_contents("$dir/index.php", "<?php\nstr_repeat('index', 2);\n");
+file_put_contents("$dir/api.php", "<?php\nstrlen('api');\n");
+
+$port = 20000 + (getmypid() % 10000);
+$settings = [
+	'xdebug.mode' => 'profile',
+	'xdebug.start_with_request' => 'yes',
+	'xdebug.use_compression' => '0',
+	'xdebug.output_dir' => $dir,
+	'xdebug.profiler_output_name' => 'cachegrind.out.merged',
+	'xdebug.profiler_aggregate_requests' => '2',
+];
+
+$command = getenv('TEST_PHP_EXECUTABLE');
+foreach ($settings as $name => $value) {
+	$command .= ' -d ' . escapeshellarg("$name=$value");
+}
+$command .= " -S 127.0.0.1:$port -t " . escapeshellarg($dir);
+
+$server = proc_open('exec ' . $command, [ 1 => [ 'file', '/dev/null', 'w' ], 2 => [ 'file', '/dev/null', 'w' ] ], $pipes);
+
+for ($i = 0; $i < 100 && !($fp = @fsockopen('127.0.0.1', $port)); $i++) {
+	usleep(50000);
+}
+if ($fp) {
+	fclose($fp);
+}
+
+/* Both requests are handled by the same process, which merges them */
+file_get_contents("http://127.0.0.1:$port/index.php");
+file_get_contents("http://127.0.0.1:$port/api.php");
+
+/* The merged profile is written after the response has been sent */
+$filename = "$dir/cachegrind.out.merged";
+for ($i = 0; $i < 100 && strpos((string) @file_get_contents($filename), 'summary:') === false; $i++) {
+	usleep(50000);
+}
+
+proc_terminate($server);
+proc_close($server);
+
+/* Lists the file of each {main} in the merged profile */
+$files = [];
+$file = null;
+foreach (file($filename) as $line) {
+	if (preg_match('/^fl=\((\d+)\)(?: (.+))?$/', trim($line), $matches)) {
+		if (isset($matches[2])) {
+			$files[$matches[1]] = $matches[2];
+		}
+		$file = $files[$matches[1]];
+	}
+	if (preg_match('/^fn=\(\d+\) \{main\}$/', trim($line))) {
+		echo basename($file), "\n";
+	}
+}
+
+array_map('unlink', glob("$dir/*"));
+rmdir($dir);
+?>
+--EXPECT--
+index.php
+api.php
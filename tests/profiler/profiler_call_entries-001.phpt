@@ -0,0 +1,153 @@
+--TEST--
+Profiler: more calls from one function than the initial call entry array holds
+--INI--
+xdebug.mode=profile
+xdebug.start_with_request=default
+--FILE--
+<?php
+require_once 'capture-profile.inc';
+
+function foo($a) {
+	return str_repeat($a, 2);
+}
+
+for ($i = 0; $i < 6; $i++) {
+	foo("test");
+}
+
+exit();
+?>
+--EXPECTF--
+version: 1
+creator: xdebug %d.%s (PHP %s)
+cmd: %sprofiler_call_entries-001.php
+part: 1
+positions: line
+
+events: Time_(10ns) Memory_(bytes)
+
+fl=(1) php:internal
+fn=(1) php::xdebug_get_profiler_filename
+2 %d %d
+
+fl=(1)
+fn=(2) php::register_shutdown_function
+16 %d %d
+
+fl=(2) %scapture-profile.inc
+fn=(3) require_once::%scapture-profile.inc
+1 %d %d
+cfl=(1)
+cfn=(1)
+calls=1 0 0
+2 %d %d
+cfl=(1)
+cfn=(2)
+calls=1 0 0
+16 %d %d
+
+fl=(1)
+fn=(4) php::str_repeat
+5 %d %d
+
+fl=(3) %sprofiler_call_entries-001.php
+fn=(5) foo
+4 %d %d
+cfl=(1)
+cfn=(4)
+calls=1 0 0
+5 %d %d
+
+fl=(1)
+fn=(4)
+5 %d %d
+
+fl=(3)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(4)
+calls=1 0 0
+5 %d %d
+
+fl=(1)
+fn=(4)
+5 %d %d
+
+fl=(3)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(4)
+calls=1 0 0
+5 %d %d
+
+fl=(1)
+fn=(4)
+5 %d %d
+
+fl=(3)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(4)
+calls=1 0 0
+5 %d %d
+
+fl=(1)
+fn=(4)
+5 %d %d
+
+fl=(3)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(4)
+calls=1 0 0
+5 %d %d
+
+fl=(1)
+fn=(4)
+5 %d %d
+
+fl=(3)
+fn=(5)
+4 %d %d
+cfl=(1)
+cfn=(4)
+calls=1 0 0
+5 %d %d
+
+fl=(3)
+fn=(6) {main}
+1 %d %d
+cfl=(2)
+cfn=(3)
+calls=1 0 0
+2 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+9 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+9 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+9 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+9 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+9 %d %d
+cfl=(3)
+cfn=(5)
+calls=1 0 0
+9 %d %d
+
+summary: %d %d
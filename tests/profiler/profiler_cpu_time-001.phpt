@@ -0,0 +1,50 @@
+--TEST--
+Profiler: CPU time as additional event (xdebug.profiler_cpu_time=1)
+--INI--
+xdebug.mode=profile
+xdebug.start_with_request=default
+xdebug.profiler_cpu_time=1
+--FILE--
+<?php
+require_once 'capture-profile.inc';
+
+exit();
+?>
+--EXPECTF--
+version: 1
+creator: xdebug %d.%s (PHP %s)
+cmd: %sprofiler_cpu_time-001.php
+part: 1
+positions: line
+
+events: Time_(10ns) Memory_(bytes) CPU_Time_(10ns)
+
+fl=(1) php:internal
+fn=(1) php::xdebug_get_profiler_filename
+2 %d %d %d
+
+fl=(1)
+fn=(2) php::register_shutdown_function
+16 %d %d %d
+
+fl=(2) %scapture-profile.inc
+fn=(3) require_once::%scapture-profile.inc
+1 %d %d %d
+cfl=(1)
+cfn=(1)
+calls=1 0 0
+2 %d %d %d
+cfl=(1)
+cfn=(2)
+calls=1 0 0
+16 %d %d %d
+
+fl=(3) %sprofiler_cpu_time-001.php
+fn=(4) {main}
+1 %d %d %d
+cfl=(2)
+cfn=(3)
+calls=1 0 0
+2 %d %d %d
+
+summary: %d %d %d
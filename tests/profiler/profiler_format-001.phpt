@@ -0,0 +1,28 @@
+--TEST--
+Profiler: collapsed stack format (xdebug.profiler_format=1)
+--INI--
+xdebug.mode=profile
+xdebug.start_with_request=default
+xdebug.profiler_format=1
+--FILE--
+<?php
+require_once 'capture-profile.inc';
+
+function foo($a) {
+	return str_repeat($a, 2);
+}
+
+function bar() {
+	foo("x");
+	foo("y");
+}
+
+bar();
+foo("z");
+
+exit();
+?>
+--EXPECTF--
+%A{main};require_once::%scapture-profile.inc;php::xdebug_get_profiler_filename %d
+%A{main};bar;foo;php::str_repeat %d
+%A{main};foo;php::str_repeat %d
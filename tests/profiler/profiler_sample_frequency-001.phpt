@@ -0,0 +1,65 @@
+--TEST--
+Profiler: sampling profiler (xdebug.profiler_sample_frequency=1000)
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('ext-flag sampling');
+?>
+--INI--
+xdebug.mode=profile
+xdebug.start_with_request=default
+xdebug.use_compression=0
+xdebug.profiler_sample_frequency=1000
+--FILE--
+<?php
+$filename = xdebug_get_profiler_filename();
+
+function busy()
+{
+	$end = hrtime(true) + 100000000;
+	while (hrtime(true) < $end) {
+	}
+}
+
+function capture()
+{
+	global $filename;
+
+	echo file_get_contents($filename);
+	echo "----\n";
+	echo file_get_contents($filename . '.collapsed');
+
+	unlink($filename);
+	unlink($filename . '.collapsed');
+}
+register_shutdown_function('capture');
+
+busy();
+
+exit();
+?>
+--EXPECTF--
+version: 1
+creator: xdebug %d.%s (PHP %s)
+cmd: %sprofiler_sample_frequency-001.php
+part: 1
+positions: line
+
+events: Time_(10ns) Memory_(bytes) Samples
+
+fl=(2) %sprofiler_sample_frequency-001.php
+fn=(1) {main}
+1 %d 0 %d
+cfl=(2)
+cfn=(2) busy
+calls=0 0 0
+24 %d 0 %d
+
+fl=(2)
+fn=(2)
+4 %d 0 %d
+
+summary: %d %d %d
+
+----
+%A{main};busy %d
@@ -0,0 +1,50 @@
+--TEST--
+Trace: writing the trace file from a separate thread (xdebug.async_writer=block)
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.trace_format=1
+xdebug.async_writer=block
+xdebug.dump_globals=0
+xdebug.collect_return=0
+xdebug.collect_assignments=0
+--FILE--
+<?php
+require_once 'capture-trace.inc';
+
+function foo()
+{
+    echo "Hi";
+	echo strrev( "Hi" ), "\n";
+}
+
+function bar()
+{
+    echo "There\n";
+	echo strrev( "There" ), "\n";
+}
+
+register_shutdown_function("bar");
+
+foo();
+
+xdebug_stop_trace();
+?>
+--EXPECTF--
+HiiH
+Version: %d.%s
+File format: %d
+TRACE START [%s]
+2	1	1	%f	%d
+2	7	0	%f	%d	register_shutdown_function	0		%sasync_writer-001.php	16	1	'bar'
+2	7	1	%f	%d
+2	8	0	%f	%d	foo	1		%sasync_writer-001.php	18	0
+3	9	0	%f	%d	strrev	0		%sasync_writer-001.php	7	1	'Hi'
+3	9	1	%f	%d
+2	8	1	%f	%d
+2	10	0	%f	%d	xdebug_stop_trace	0		%sasync_writer-001.php	20	0
+			%f	%d
+TRACE END   [%s]
+
+There
+erehT
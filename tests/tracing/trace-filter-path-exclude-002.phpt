@@ -0,0 +1,50 @@
+--TEST--
+Filtered tracing: path exclude [2] (many prefixes, case insensitive, changed filter)
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.collect_return=1
+xdebug.collect_assignments=0
+xdebug.trace_format=0
+--FILE--
+<?php
+$cwd = __DIR__; $s = DIRECTORY_SEPARATOR; $includeDir = realpath( $cwd . '/..' );
+$prefixes = [];
+for ( $i = 0; $i < 250; $i++ ) { $prefixes[] = "{$includeDir}{$s}vendor{$s}package-{$i}"; }
+$prefixes[] = "{$includeDir}{$s}FILTER{$s}XDEBUG";
+$prefixes[] = "{$includeDir}{$s}filter{$s}xdebug{$s}xdebug.php";
+xdebug_set_filter(XDEBUG_FILTER_TRACING, XDEBUG_PATH_EXCLUDE, $prefixes );
+
+include "{$includeDir}/filter/foobar/foobar.php";
+include "{$includeDir}/filter/xdebug/xdebug.php";
+
+require_once 'capture-trace.inc';
+
+Foobar::foo("hi");
+Xdebug::foo("hi");
+
+xdebug_set_filter(XDEBUG_FILTER_TRACING, XDEBUG_PATH_EXCLUDE, [ "{$includeDir}{$s}filter{$s}foobar" ] );
+
+Foobar::foo("hi");
+Xdebug::foo("hi");
+
+xdebug_stop_trace();
+?>
+--EXPECTF--
+ello!
+ello!
+ello!
+ello!
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+%w%f %w%d     -> Foobar::foo($s = 'hi') %strace-filter-path-exclude-002.php:14
+%w%f %w%d       -> strstr($haystack = 'Hello!\n', $needle = 'e') %sfilter%efoobar%efoobar.php:6
+%w%f %w%d        >=> 'ello!\n'
+%w%f %w%d     -> Xdebug::foo($s = 'hi') %strace-filter-path-exclude-002.php:15
+%w%f %w%d     -> xdebug_set_filter($group = 768, $listType = 2, $configuration = [%s]) %strace-filter-path-exclude-002.php:17
+%w%f %w%d     -> Foobar::foo($s = 'hi') %strace-filter-path-exclude-002.php:19
+%w%f %w%d     -> Xdebug::foo($s = 'hi') %strace-filter-path-exclude-002.php:20
+%w%f %w%d       -> strstr($haystack = 'Hello!\n', $needle = 'e') %sfilter%exdebug%exdebug.php:6
+%w%f %w%d        >=> 'ello!\n'
+%w%f %w%d     -> xdebug_stop_trace() %strace-filter-path-exclude-002.php:22
+%w%f %w%d
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
@@ -0,0 +1,47 @@
+--TEST--
+Trace: changing the xdebug.var_display_* settings during a trace
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.collect_return=1
+xdebug.collect_assignments=0
+xdebug.trace_format=0
+xdebug.var_display_max_depth=3
+xdebug.var_display_max_children=3
+--FILE--
+<?php
+require_once 'capture-trace.inc';
+
+function show($value)
+{
+	return $value;
+}
+
+show([1, 2, 3]);
+show([[1]]);
+
+ini_set('xdebug.var_display_max_children', 1);
+ini_set('xdebug.var_display_max_depth', 1);
+
+show([1, 2, 3]);
+show([[1]]);
+
+xdebug_stop_trace();
+?>
+--EXPECTF--
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+%w%f %w%d     -> show($value = [0 => 1, 1 => 2, 2 => 3]) %strace-var-display-settings-001.php:9
+%w%f %w%d      >=> [0 => 1, 1 => 2, 2 => 3]
+%w%f %w%d     -> show($value = [0 => [0 => 1]]) %strace-var-display-settings-001.php:10
+%w%f %w%d      >=> [0 => [0 => 1]]
+%w%f %w%d     -> ini_set($%s = 'xdebug.var_display_max_children', $%s = 1) %strace-var-display-settings-001.php:12
+%w%f %w%d      >=> '3'
+%w%f %w%d     -> ini_set($%s = 'xdebug.var_display_max_depth', $%s = 1) %strace-var-display-settings-001.php:13
+%w%f %w%d      >=> '3'
+%w%f %w%d     -> show($value = [0 => 1, ...]) %strace-var-display-settings-001.php:15
+%w%f %w%d      >=> [0 => 1, ...]
+%w%f %w%d     -> show($value = [0 => [...]]) %strace-var-display-settings-001.php:16
+%w%f %w%d      >=> [0 => [...]]
+%w%f %w%d     -> xdebug_stop_trace() %strace-var-display-settings-001.php:18
+%w%f %w%d
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
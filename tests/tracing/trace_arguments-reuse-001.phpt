@@ -0,0 +1,40 @@
+--TEST--
+Trace: arguments of frames at the same depth with different argument counts
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.collect_return=0
+xdebug.collect_assignments=0
+xdebug.trace_format=0
+--FILE--
+<?php
+require_once 'capture-trace.inc';
+
+function one($a) { return $a; }
+function three($a, $b, $c) { return one($a); }
+function takeAll(string $one, ...$args) { return one($one); }
+
+three(1, 2, 3);
+one(4);
+three(5, "six", [7]);
+takeAll("x", 1, 2, 3);
+takeAll("y", k: 2);
+one(8);
+
+xdebug_stop_trace();
+?>
+--EXPECTF--
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+%w%f %w%d     -> three($a = 1, $b = 2, $c = 3) %strace_arguments-reuse-001.php:8
+%w%f %w%d       -> one($a = 1) %strace_arguments-reuse-001.php:5
+%w%f %w%d     -> one($a = 4) %strace_arguments-reuse-001.php:9
+%w%f %w%d     -> three($a = 5, $b = 'six', $c = [0 => 7]) %strace_arguments-reuse-001.php:10
+%w%f %w%d       -> one($a = 5) %strace_arguments-reuse-001.php:5
+%w%f %w%d     -> takeAll($one = 'x', ...$args = variadic(0 => 1, 1 => 2, 2 => 3)) %strace_arguments-reuse-001.php:11
+%w%f %w%d       -> one($a = 'x') %strace_arguments-reuse-001.php:6
+%w%f %w%d     -> takeAll($one = 'y', ...$args = variadic($k => 2)) %strace_arguments-reuse-001.php:12
+%w%f %w%d       -> one($a = 'y') %strace_arguments-reuse-001.php:6
+%w%f %w%d     -> one($a = 8) %strace_arguments-reuse-001.php:13
+%w%f %w%d     -> xdebug_stop_trace() %strace_arguments-reuse-001.php:15
+%w%f %w%d
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
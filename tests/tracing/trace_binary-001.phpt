@@ -0,0 +1,52 @@
+--TEST--
+Trace: binary format, converted to the computerized and textual formats
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.trace_format=3
+xdebug.collect_return=1
+xdebug.collect_assignments=0
+xdebug.use_compression=0
+--FILE--
+<?php
+require dirname( __FILE__ ) . '/../../contrib/trace-binary-reader.php';
+$tf = xdebug_start_trace(sys_get_temp_dir() . '/' . uniqid('xdt', TRUE));
+
+function foo($a)
+{
+	return strrev($a);
+}
+
+foo("Hi");
+xdebug_stop_trace();
+
+$output = fopen('php://output', 'w');
+foreach ([XdebugBinaryTraceReader::FORMAT_COMPUTERIZED, XdebugBinaryTraceReader::FORMAT_TEXTUAL] as $format) {
+	$reader = new XdebugBinaryTraceReader($tf);
+	$reader->convert($format, $output);
+}
+unlink($tf);
+?>
+--EXPECTF--
+Version: %d.%s
+File format: 4
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+2	%d	1	%f	%d
+2	%d	0	%f	%d	foo	1		%strace_binary-001.php	10	1	'Hi'
+3	%d	0	%f	%d	strrev	0		%strace_binary-001.php	7	1	'Hi'
+3	%d	1	%f	%d
+3	%d	R			'iH'
+2	%d	1	%f	%d
+2	%d	R			'iH'
+2	%d	0	%f	%d	xdebug_stop_trace	0		%strace_binary-001.php	11	0
+			%f	%d
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
+
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+%w%f %w%d     -> foo($a = 'Hi') %strace_binary-001.php:10
+%w%f %w%d       -> strrev($%s = 'Hi') %strace_binary-001.php:7
+%w%f %w%d        >=> 'iH'
+%w%f %w%d      >=> 'iH'
+%w%f %w%d     -> xdebug_stop_trace() %strace_binary-001.php:11
+%w%f %w%d
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
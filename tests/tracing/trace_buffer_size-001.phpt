@@ -0,0 +1,62 @@
+--TEST--
+Trace: records are buffered with xdebug.trace_buffer_size, and written with xdebug_flush_trace()
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.trace_format=1
+xdebug.trace_buffer_size=1048576
+xdebug.collect_return=0
+xdebug.collect_assignments=0
+xdebug.use_compression=0
+--FILE--
+<?php
+$tf = xdebug_start_trace(sys_get_temp_dir() . '/' . uniqid('xdt', TRUE));
+
+function foo()
+{
+	return strrev("Hi");
+}
+
+foo();
+
+clearstatcache();
+$buffered = filesize($tf);
+var_dump(xdebug_flush_trace());
+clearstatcache();
+var_dump(filesize($tf) > $buffered);
+
+xdebug_stop_trace();
+var_dump(xdebug_flush_trace());
+
+echo file_get_contents($tf);
+unlink($tf);
+?>
+--EXPECTF--
+bool(true)
+bool(true)
+bool(false)
+Version: %d.%s
+File format: %d
+TRACE START [%s]
+2	%d	1	%f	%d
+2	%d	0	%f	%d	foo	1		%strace_buffer_size-001.php	9	0
+3	%d	0	%f	%d	strrev	0		%strace_buffer_size-001.php	6	1	'Hi'
+3	%d	1	%f	%d
+2	%d	1	%f	%d
+2	%d	0	%f	%d	clearstatcache	0		%strace_buffer_size-001.php	11	0
+2	%d	1	%f	%d
+2	%d	0	%f	%d	filesize	0		%strace_buffer_size-001.php	12	1	'%s'
+2	%d	1	%f	%d
+2	%d	0	%f	%d	xdebug_flush_trace	0		%strace_buffer_size-001.php	13	0
+2	%d	1	%f	%d
+2	%d	0	%f	%d	var_dump	0		%strace_buffer_size-001.php	13	1	TRUE
+2	%d	1	%f	%d
+2	%d	0	%f	%d	clearstatcache	0		%strace_buffer_size-001.php	14	0
+2	%d	1	%f	%d
+2	%d	0	%f	%d	filesize	0		%strace_buffer_size-001.php	15	1	'%s'
+2	%d	1	%f	%d
+2	%d	0	%f	%d	var_dump	0		%strace_buffer_size-001.php	15	1	TRUE
+%A
+2	%d	0	%f	%d	xdebug_stop_trace	0		%strace_buffer_size-001.php	17	0
+			%f	%d
+TRACE END   [%s]
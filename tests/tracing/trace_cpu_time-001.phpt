@@ -0,0 +1,36 @@
+--TEST--
+Trace: CPU time in exit records of the computerized format (XDEBUG_TRACE_CPU_TIME)
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.trace_format=1
+xdebug.collect_return=0
+xdebug.collect_assignments=0
+--FILE--
+<?php
+$tf = xdebug_start_trace(sys_get_temp_dir() . '/' . uniqid('xdt', TRUE), XDEBUG_TRACE_CPU_TIME);
+
+function foo()
+{
+	return strrev("Hi");
+}
+
+foo();
+
+xdebug_stop_trace();
+
+echo file_get_contents($tf);
+unlink($tf);
+?>
+--EXPECTF--
+Version: %d.%s
+File format: %d
+TRACE START [%s]
+2	1	1	%f	%d	%f
+2	2	0	%f	%d	foo	1		%strace_cpu_time-001.php	9	0
+3	3	0	%f	%d	strrev	0		%strace_cpu_time-001.php	6	1	'Hi'
+3	3	1	%f	%d	%f
+2	2	1	%f	%d	%f
+2	4	0	%f	%d	xdebug_stop_trace	0		%strace_cpu_time-001.php	11	0
+			%f	%d
+TRACE END   [%s]
@@ -0,0 +1,57 @@
+--TEST--
+Trace: writing the trace to a FIFO with xdebug.output_sink
+--SKIPIF--
+<?php
+require __DIR__ . '/../utils.inc';
+check_reqs('!win');
+if (!function_exists('posix_mkfifo')) print "skip posix extension not available";
+?>
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.trace_format=0
+xdebug.collect_return=0
+xdebug.collect_assignments=0
+--FILE--
+<?php
+require dirname( __FILE__ ) . '/../../contrib/sink-collector.php';
+
+$fifo = sys_get_temp_dir() . '/' . uniqid('xdsink', TRUE);
+posix_mkfifo($fifo, 0600);
+$reader = fopen($fifo, 'r+');
+stream_set_blocking($reader, false);
+
+ini_set('xdebug.output_sink', $fifo);
+$tf = xdebug_start_trace(sys_get_temp_dir() . '/trace_output_sink-001');
+strrev("Hi");
+xdebug_stop_trace();
+
+$buffer = '';
+while (($data = fread($reader, 8192)) !== false && $data !== '') {
+	$buffer .= $data;
+}
+foreach (xdebug_sink_parse_frames($buffer) as $frame) {
+	switch ($frame['type']) {
+		case 'O': echo "open: {$frame['payload']}\n"; break;
+		case 'D': echo $frame['payload']; break;
+		case 'C': echo "close: ", unpack('J', $frame['payload'])[1], " bytes dropped\n"; break;
+	}
+}
+
+var_dump($tf === sys_get_temp_dir() . '/trace_output_sink-001.xt');
+var_dump(file_exists($tf));
+
+fclose($reader);
+unlink($fifo);
+?>
+--EXPECTF--
+open: %strace_output_sink-001.xt
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+%w%f %w%d     -> strrev($%s = 'Hi') %strace_output_sink-001.php:11
+%w%f %w%d     -> xdebug_stop_trace() %strace_output_sink-001.php:12
+%w%f %w%d
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
+
+close: 0 bytes dropped
+bool(true)
+bool(false)
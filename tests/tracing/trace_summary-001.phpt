@@ -0,0 +1,55 @@
+--TEST--
+Trace: summary format
+--INI--
+xdebug.mode=trace
+xdebug.start_with_request=no
+xdebug.trace_format=4
+xdebug.use_compression=0
+--FILE--
+<?php
+$tf = xdebug_start_trace(sys_get_temp_dir() . '/' . uniqid('xdt', TRUE));
+
+function foo($a)
+{
+	return strrev($a);
+}
+
+function fac($n)
+{
+	return $n <= 1 ? 1 : $n * fac($n - 1);
+}
+
+for ($i = 0; $i < 3; $i++) {
+	foo("Hi");
+}
+fac(4);
+xdebug_stop_trace();
+
+$lines = file($tf, FILE_IGNORE_NEW_LINES);
+unlink($tf);
+
+echo $lines[0], "\n", $lines[1], "\n", $lines[2], "\n", $lines[3], "\n";
+
+$rows = [];
+foreach (array_slice($lines, 4) as $line) {
+	if (preg_match('@^(\S+)\s+(\d+)\s+([0-9.]+)\s+(-?\d+)\s+([0-9.]+)\s+(-?\d+)$@', $line, $m)) {
+		$rows[$m[1]] = $m[2];
+	} else {
+		echo $line, "\n";
+	}
+}
+ksort($rows);
+foreach ($rows as $name => $calls) {
+	echo $name, ': ', $calls, "\n";
+}
+?>
+--EXPECTF--
+TRACE START [%d-%d-%d %d:%d:%d.%d]
+%w        Inclusive        Own
+function%w#calls  time     memory  time     memory
+------------------------------------------------
+TRACE END   [%d-%d-%d %d:%d:%d.%d]
+
+fac: 4
+foo: 3
+strrev: 3
@@ -55,6 +55,7 @@
 #include "develop/superglobals.h"
 #include "debugger/com.h"
 #include "gcstats/gc_stats.h"
+#include "lib/async_writer.h"
 #include "lib/usefulstuff.h"
 #include "lib/lib.h"
 #include "lib/llist.h"
@@ -165,6 +166,17 @@ static PHP_INI_MH(OnUpdateStartUponError)
 	return SUCCESS;
 }
 
+static PHP_INI_MH(OnUpdateVarDisplay)
+{
+	if (OnUpdateLong(entry, new_value, mh_arg1, mh_arg2, mh_arg3, stage) == FAILURE) {
+		return FAILURE;
+	}
+
+	xdebug_lib_var_display_settings_changed();
+
+	return SUCCESS;
+}
+
 static PHP_INI_MH(OnUpdateRemovedSetting)
 {
 	if (! (EG(error_reporting) & E_DEPRECATED)) {
@@ -277,18 +289,26 @@ PHP_INI_BEGIN()
 	STD_PHP_INI_ENTRY("xdebug.trigger_value",      "",                      PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateString, settings.library.trigger_value,    zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_ENTRY("xdebug.file_link_format",   "",                      PHP_INI_ALL,                   OnUpdateString, settings.library.file_link_format, zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_ENTRY("xdebug.filename_format",    "",                      PHP_INI_ALL,                   OnUpdateString, settings.library.filename_format,  zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.clock_source",       "default",               PHP_INI_SYSTEM,                OnUpdateString, settings.library.clock_source,     zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.async_writer",       "off",                   PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateString, settings.library.async_writer,     zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.output_sink",        "",                      PHP_INI_ALL,                   OnUpdateString, settings.library.output_sink,      zend_xdebug_globals, xdebug_globals)
 
 	STD_PHP_INI_ENTRY("xdebug.log",       "",           PHP_INI_ALL, OnUpdateString, settings.library.log,       zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_ENTRY("xdebug.log_level", XLOG_DEFAULT, PHP_INI_ALL, OnUpdateLong,   settings.library.log_level, zend_xdebug_globals, xdebug_globals)
 
 	/* Variable display settings */
-	STD_PHP_INI_ENTRY("xdebug.var_display_max_children", "128",     PHP_INI_ALL,    OnUpdateLong,   settings.library.display_max_children, zend_xdebug_globals, xdebug_globals)
-	STD_PHP_INI_ENTRY("xdebug.var_display_max_data",     "512",     PHP_INI_ALL,    OnUpdateLong,   settings.library.display_max_data,     zend_xdebug_globals, xdebug_globals)
-	STD_PHP_INI_ENTRY("xdebug.var_display_max_depth",    "3",       PHP_INI_ALL,    OnUpdateLong,   settings.library.display_max_depth,    zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.var_display_max_children", "128",     PHP_INI_ALL,    OnUpdateVarDisplay, settings.library.display_max_children, zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.var_display_max_data",     "512",     PHP_INI_ALL,    OnUpdateVarDisplay, settings.library.display_max_data,     zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.var_display_max_depth",    "3",       PHP_INI_ALL,    OnUpdateVarDisplay, settings.library.display_max_depth,    zend_xdebug_globals, xdebug_globals)
 
 	/* Base settings */
 	STD_PHP_INI_ENTRY("xdebug.max_nesting_level", "256",                PHP_INI_ALL,    OnUpdateLong,   settings.base.max_nesting_level, zend_xdebug_globals, xdebug_globals)
 
+	/* Coverage settings */
+	STD_PHP_INI_ENTRY("xdebug.coverage_cache_dir", "",                  PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateString, settings.coverage.coverage_cache_dir, zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_BOOLEAN("xdebug.coverage_merge_forks", "0",             PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateBool,   settings.coverage.coverage_merge_forks, zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.coverage_path_limit",  "4096",            PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateLong,   settings.coverage.coverage_path_limit,  zend_xdebug_globals, xdebug_globals)
+
 	/* Develop settings */
 	STD_PHP_INI_ENTRY("xdebug.cli_color",         "0",                  PHP_INI_ALL,    OnUpdateLong,   settings.develop.cli_color,         zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_BOOLEAN("xdebug.force_display_errors", "0",             PHP_INI_SYSTEM, OnUpdateBool,   settings.develop.force_display_errors, zend_xdebug_globals, xdebug_globals)
@@ -315,6 +335,13 @@ PHP_INI_BEGIN()
 	/* Profiler settings */
 	STD_PHP_INI_ENTRY("xdebug.profiler_output_name",      "cachegrind.out.%p",  PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateString, settings.profiler.profiler_output_name,          zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_BOOLEAN("xdebug.profiler_append",         "0",                  PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateBool,   settings.profiler.profiler_append,               zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_BOOLEAN("xdebug.profiler_aggregate_calls", "0",                 PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateBool,   settings.profiler.profiler_aggregate_calls,      zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.profiler_aggregate_requests", "0",                PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateLong,   settings.profiler.profiler_aggregate_requests,   zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.profiler_aggregate_interval", "0",                PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateLong,   settings.profiler.profiler_aggregate_interval,   zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.profiler_sample_frequency", "0",                  PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateLong,   settings.profiler.profiler_sample_frequency,     zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.profiler_format",           "0",                  PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateLong,   settings.profiler.profiler_format,               zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.profiler_events",           "",                   PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateString, settings.profiler.profiler_events,               zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_BOOLEAN("xdebug.profiler_cpu_time",       "0",                  PHP_INI_SYSTEM|PHP_INI_PERDIR, OnUpdateBool,   settings.profiler.profiler_cpu_time,             zend_xdebug_globals, xdebug_globals)
 
 	/* Xdebug Cloud */
 	STD_PHP_INI_ENTRY("xdebug.cloud_id", "", PHP_INI_SYSTEM, OnUpdateString, settings.debugger.cloud_id, zend_xdebug_globals, xdebug_globals)
@@ -336,6 +363,7 @@ PHP_INI_BEGIN()
 	/* Tracing settings */
 	STD_PHP_INI_ENTRY("xdebug.trace_output_name", "trace.%c",           PHP_INI_ALL,    OnUpdateString, settings.tracing.trace_output_name, zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_ENTRY("xdebug.trace_format",      "0",                  PHP_INI_ALL,    OnUpdateLong,   settings.tracing.trace_format,      zend_xdebug_globals, xdebug_globals)
+	STD_PHP_INI_ENTRY("xdebug.trace_buffer_size", "0",                  PHP_INI_ALL,    OnUpdateLong,   settings.tracing.trace_buffer_size, zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_ENTRY("xdebug.trace_options",     "0",                  PHP_INI_ALL,    OnUpdateLong,   settings.tracing.trace_options,     zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_BOOLEAN("xdebug.collect_assignments", "0",              PHP_INI_ALL,    OnUpdateBool,   settings.tracing.collect_assignments, zend_xdebug_globals, xdebug_globals)
 	STD_PHP_INI_BOOLEAN("xdebug.collect_return",  "0",                  PHP_INI_ALL,    OnUpdateBool,   settings.tracing.collect_return,    zend_xdebug_globals, xdebug_globals)
@@ -385,6 +413,9 @@ static void xdebug_init_base_globals(xdebug_base_globals_t *xg)
 	xg->filters_code_coverage     = NULL;
 	xg->filters_stack             = NULL;
 	xg->filters_tracing           = NULL;
+	xg->filter_cache_generation   = 0;
+	xg->filter_cache_owner        = 0;
+	xg->filter_cache_tag          = 0;
 
 	xg->php_version_compile_time = PHP_VERSION;
 	xg->php_version_run_time     = zend_get_module_version("standard");
@@ -425,6 +456,9 @@ static void php_xdebug_shutdown_globals(zend_xdebug_globals *xg)
 	if (XDEBUG_MODE_IS(XDEBUG_MODE_DEVELOP)) {
 		xdebug_deinit_develop_globals(&xg->globals.develop);
 	}
+	if (XDEBUG_MODE_IS(XDEBUG_MODE_PROFILING)) {
+		xdebug_deinit_profiler_globals(&xg->globals.profiler);
+	}
 }
 
 
@@ -528,6 +562,8 @@ PHP_MINIT_FUNCTION(xdebug)
 	}
 
 	xdebug_library_minit();
+	xdebug_nanotime_minit();
+	xdebug_async_writer_minit();
 	xdebug_base_minit(INIT_FUNC_ARGS_PASSTHRU);
 
 	if (XDEBUG_MODE_IS(XDEBUG_MODE_STEP_DEBUG)) {
@@ -686,6 +722,9 @@ PHP_RSHUTDOWN_FUNCTION(xdebug)
 		return SUCCESS;
 	}
 
+	if (XDEBUG_MODE_IS(XDEBUG_MODE_COVERAGE)) {
+		xdebug_coverage_rshutdown();
+	}
 	if (XDEBUG_MODE_IS(XDEBUG_MODE_GCSTATS)) {
 		xdebug_gcstats_rshutdown();
 	}
@@ -727,7 +766,7 @@ ZEND_DLEXPORT void xdebug_statement_call(zend_execute_data *frame)
 
 	lineno = EG(current_execute_data)->opline->lineno;
 
-	xdebug_coverage_count_line_if_active(op_array, op_array->filename, lineno);
+	xdebug_coverage_count_opcode_if_active(op_array, EG(current_execute_data)->opline);
 	xdebug_debugger_statement_call(op_array->filename, lineno);
 }
 
@@ -776,6 +815,15 @@ ZEND_DLEXPORT void xdebug_init_oparray(zend_op_array *op_array)
 	xdebug_coverage_init_oparray(op_array);
 }
 
+ZEND_DLEXPORT void xdebug_destroy_oparray(zend_op_array *op_array)
+{
+	if (XDEBUG_MODE_IS_OFF()) {
+		return;
+	}
+
+	xdebug_coverage_destroy_oparray(op_array);
+}
+
 #ifndef ZEND_EXT_API
 #define ZEND_EXT_API    ZEND_DLEXPORT
 #endif
@@ -798,7 +846,7 @@ ZEND_DLEXPORT zend_extension zend_extension_entry = {
 	NULL,           /* fcall_begin_handler_func_t */
 	NULL,           /* fcall_end_handler_func_t */
 	xdebug_init_oparray,   /* op_array_ctor_func_t */
-	NULL,           /* op_array_dtor_func_t */
+	xdebug_destroy_oparray, /* op_array_dtor_func_t */
 	STANDARD_ZEND_EXTENSION_PROPERTIES
 };
 